@@ -0,0 +1,483 @@
+#include "../include/MiniFileExplorer.h"
+#include "../include/FileUtils.h"
+#include "../include/TreeRemover.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * 基准测试程序（make bench）
+ *
+ * 在临时目录中生成可复现的合成目录树（固定随机种子），
+ * 通过 MiniFileExplorer::execute 直接调用命令并计时，
+ * 最后以 JSON 输出每项测试的吞吐量（条目/秒、MB/秒）和延迟分位数（p50/p99）。
+ *
+ * 目录树：
+ *   wide  一个目录中有大量小文件
+ *   deep  很深的目录链，每层几个文件
+ *   tiny  许多目录，每个目录中有许多小文件
+ *   huge  少量大文件
+ *
+ * 用法:
+ *   ./MiniFileExplorerBench [--scale N] [--iterations N] [--dir DIR] [--out FILE] [--keep]
+ *   --scale       目录树规模的倍数（默认 1）
+ *   --iterations  每项测试的重复次数（默认 20；stat / mv 为其 100 倍）
+ *   --dir         在哪个目录下创建临时目录（默认 $TMPDIR 或 /tmp）
+ *   --out         JSON 写入文件（默认标准输出）
+ *   --keep        结束后保留生成的目录树
+ */
+
+namespace {
+
+// ========== 工具 ==========
+
+// 固定种子的伪随机数（xorshift64*），同样的参数生成同样的目录树
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed ? seed : 1) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    // [0, bound)
+    uint64_t below(uint64_t bound) { return bound == 0 ? 0 : next() % bound; }
+
+private:
+    uint64_t state;
+};
+
+// 丢弃所有输出（计时时不把格式化结果写到终端）
+class NullBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// 给路径加引号，路径中有空格时命令也能正确解析
+std::string quote(const std::string& path) {
+    std::string result = "\"";
+    for (char c : path) {
+        if (c == '"' || c == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(c);
+    }
+    result.push_back('"');
+    return result;
+}
+
+// JSON 字符串转义
+std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result.push_back('\\');
+            result.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        } else {
+            result.push_back(c);
+        }
+    }
+    result.push_back('"');
+    return result;
+}
+
+// ========== 目录树生成 ==========
+
+struct TreeInfo {
+    std::string name;
+    uint64_t files = 0;
+    uint64_t dirs = 0;
+    uint64_t bytes = 0;
+};
+
+class TreeGenerator {
+public:
+    explicit TreeGenerator(uint64_t seed) : random(seed), data(1 << 20) {
+        for (char& c : data) {
+            c = static_cast<char>('a' + random.below(26));
+        }
+    }
+
+    bool makeDir(const std::string& path, TreeInfo& info) {
+        if (mkdir(path.c_str(), 0755) != 0) {
+            return false;
+        }
+        info.dirs++;
+        return true;
+    }
+
+    bool makeFile(const std::string& path, uint64_t size, TreeInfo& info) {
+        UniqueFd fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (!fd) {
+            return false;
+        }
+        uint64_t left = size;
+        while (left > 0) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, data.size()));
+            ssize_t written = write(fd.get(), data.data(), chunk);
+            if (written <= 0) {
+                return false;
+            }
+            left -= static_cast<uint64_t>(written);
+        }
+        info.files++;
+        info.bytes += size;
+        return true;
+    }
+
+    uint64_t below(uint64_t bound) { return random.below(bound); }
+
+private:
+    Random random;
+    std::vector<char> data;
+};
+
+// ========== 计时与统计 ==========
+
+struct Result {
+    std::string name;
+    std::string command;
+    uint64_t entries = 0;        // 每次操作处理的条目数
+    uint64_t bytes = 0;          // 每次操作处理的字节数
+    std::vector<double> micros;  // 每次操作的耗时（微秒）
+    uint64_t errors = 0;
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    rank = std::max<size_t>(rank, 1);
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+class Bench {
+public:
+    Bench(MiniFileExplorer& explorer, unsigned iterations) : explorer(explorer), iterations(iterations) {}
+
+    /**
+     * 执行一条命令若干次，记录每次的耗时
+     * @param prepare 每次执行前调用（不计时），返回要执行的命令
+     * @param cleanup 每次执行后调用（不计时）
+     */
+    void run(const std::string& name, uint64_t entries, uint64_t bytes, unsigned count,
+             const std::function<std::string(unsigned)>& prepare,
+             const std::function<void(unsigned)>& cleanup = nullptr) {
+        Result result;
+        result.name = name;
+        result.entries = entries;
+        result.bytes = bytes;
+        std::cerr << "  " << name << " ..." << std::flush;
+        for (unsigned i = 0; i < count; i++) {
+            std::string command = prepare(i);
+            if (i == 0) {
+                result.command = command;
+            }
+            auto start = std::chrono::steady_clock::now();
+            bool ok = explorer.execute(command);
+            auto end = std::chrono::steady_clock::now();
+            result.micros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            if (!ok) {
+                result.errors++;
+            }
+            if (cleanup) {
+                cleanup(i);
+            }
+        }
+        std::cerr << " done\n";
+        results.push_back(std::move(result));
+    }
+
+    void run(const std::string& name, uint64_t entries, uint64_t bytes, const std::string& command) {
+        run(name, entries, bytes, iterations, [&command](unsigned) { return command; });
+    }
+
+    void writeJson(std::ostream& out, const std::vector<TreeInfo>& trees, unsigned scale) const {
+        out << "{\n";
+        out << "  \"version\": 1,\n";
+        out << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n";
+        out << "  \"scale\": " << scale << ",\n";
+        out << "  \"iterations\": " << iterations << ",\n";
+        out << "  \"trees\": [\n";
+        for (size_t i = 0; i < trees.size(); i++) {
+            const TreeInfo& tree = trees[i];
+            out << "    {\"name\": " << jsonString(tree.name) << ", \"files\": " << tree.files
+                << ", \"dirs\": " << tree.dirs << ", \"bytes\": " << tree.bytes << "}"
+                << (i + 1 < trees.size() ? "," : "") << "\n";
+        }
+        out << "  ],\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            std::vector<double> sorted = result.micros;
+            std::sort(sorted.begin(), sorted.end());
+            double total = 0;
+            for (double value : sorted) {
+                total += value;
+            }
+            double mean = sorted.empty() ? 0 : total / static_cast<double>(sorted.size());
+            double seconds = mean / 1e6;
+
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "\"iterations\": %zu, \"errors\": %llu, \"entries\": %llu, \"bytes\": %llu, "
+                          "\"mean_us\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, \"min_us\": %.1f, "
+                          "\"max_us\": %.1f, \"entries_per_s\": %.0f, \"mb_per_s\": %.1f",
+                          sorted.size(), static_cast<unsigned long long>(result.errors),
+                          static_cast<unsigned long long>(result.entries),
+                          static_cast<unsigned long long>(result.bytes), mean, percentile(sorted, 0.50),
+                          percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.front(),
+                          sorted.empty() ? 0.0 : sorted.back(),
+                          seconds > 0 ? static_cast<double>(result.entries) / seconds : 0.0,
+                          seconds > 0 ? static_cast<double>(result.bytes) / seconds / (1 << 20) : 0.0);
+            out << "    {\"name\": " << jsonString(result.name) << ", \"command\": " << jsonString(result.command)
+                << ", " << line << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+private:
+    MiniFileExplorer& explorer;
+    unsigned iterations;
+    std::vector<Result> results;
+};
+
+bool parseUnsigned(const char* text, unsigned& value) {
+    char* end = nullptr;
+    unsigned long parsed = std::strtoul(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || parsed == 0 || parsed > 1000000) {
+        return false;
+    }
+    value = static_cast<unsigned>(parsed);
+    return true;
+}
+
+void removePath(const std::string& path) {
+    removeTree(AT_FDCWD, path);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned scale = 1;
+    unsigned iterations = 20;
+    std::string baseDir;
+    std::string outFile;
+    bool keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--scale" && hasValue && parseUnsigned(argv[i + 1], scale)) {
+            i++;
+        } else if (arg == "--iterations" && hasValue && parseUnsigned(argv[i + 1], iterations)) {
+            i++;
+        } else if (arg == "--dir" && hasValue) {
+            baseDir = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            outFile = argv[++i];
+        } else if (arg == "--keep") {
+            keep = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--scale N] [--iterations N] [--dir DIR] [--out FILE] [--keep]\n";
+            return 2;
+        }
+    }
+
+    if (baseDir.empty()) {
+        const char* tmp = std::getenv("TMPDIR");
+        baseDir = (tmp != nullptr && *tmp != '\0') ? tmp : "/tmp";
+    }
+    std::string pattern = baseDir + "/mfe-bench-XXXXXX";
+    std::vector<char> templateBuffer(pattern.begin(), pattern.end());
+    templateBuffer.push_back('\0');
+    if (mkdtemp(templateBuffer.data()) == nullptr) {
+        std::cerr << "Cannot create temporary directory in " << baseDir << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::string root = templateBuffer.data();
+
+    // ========== 生成目录树 ==========
+    std::cerr << "Generating trees in " << root << "\n";
+    TreeGenerator generator(0x5eed);
+    std::vector<TreeInfo> trees;
+    bool ok = true;
+
+    // wide：一个目录中有大量小文件
+    TreeInfo wide{"wide"};
+    const unsigned wideFiles = 50000 * scale;
+    ok = ok && generator.makeDir(root + "/wide", wide);
+    for (unsigned i = 0; ok && i < wideFiles; i++) {
+        ok = generator.makeFile(root + "/wide/f" + std::to_string(i), generator.below(512), wide);
+    }
+    trees.push_back(wide);
+
+    // deep：很深的目录链
+    TreeInfo deep{"deep"};
+    const unsigned depth = 200 * scale;
+    std::string path = root + "/deep";
+    ok = ok && generator.makeDir(path, deep);
+    for (unsigned level = 0; ok && level < depth; level++) {
+        for (unsigned i = 0; ok && i < 4; i++) {
+            ok = generator.makeFile(path + "/file" + std::to_string(i), generator.below(256), deep);
+        }
+        path += "/d" + std::to_string(level % 10);
+        ok = ok && generator.makeDir(path, deep);
+    }
+    trees.push_back(deep);
+
+    // tiny：许多目录，每个目录中有许多小文件
+    TreeInfo tiny{"tiny"};
+    const unsigned tinyDirs = 64 * scale;
+    ok = ok && generator.makeDir(root + "/tiny", tiny);
+    for (unsigned d = 0; ok && d < tinyDirs; d++) {
+        std::string dir = root + "/tiny/dir" + std::to_string(d);
+        ok = generator.makeDir(dir, tiny);
+        for (unsigned i = 0; ok && i < 256; i++) {
+            ok = generator.makeFile(dir + "/item" + std::to_string(generator.below(100000)) + "_" +
+                                    std::to_string(i), generator.below(1024), tiny);
+        }
+    }
+    trees.push_back(tiny);
+
+    // huge：少量大文件
+    TreeInfo huge{"huge"};
+    const uint64_t hugeSize = 32ULL * scale << 20;
+    ok = ok && generator.makeDir(root + "/huge", huge);
+    for (unsigned i = 0; ok && i < 4; i++) {
+        ok = generator.makeFile(root + "/huge/h" + std::to_string(i), hugeSize, huge);
+    }
+    trees.push_back(huge);
+
+    if (!ok) {
+        std::cerr << "Failed to generate trees: " << std::strerror(errno) << "\n";
+        if (!keep) {
+            removePath(root);
+        }
+        return 1;
+    }
+    sync();
+
+    // ========== 运行测试 ==========
+    std::cerr << "Running benchmarks\n";
+    NullBuffer nullBuffer;
+    std::streambuf* previous = std::cout.rdbuf(&nullBuffer);
+
+    MiniFileExplorer explorer(root);
+    Bench bench(explorer, iterations);
+    Random random(42);
+    const unsigned manyIterations = iterations * 100;
+    std::string wideDir = quote(root + "/wide");
+
+    // ls：第一次读取目录，之后来自目录缓存
+    explorer.execute("cd " + wideDir);
+    bench.run("ls/wide", wide.files, 0, "ls");
+    bench.run("ls-s/wide", wide.files, 0, "ls -s");
+    bench.run("ls-t/wide", wide.files, 0, "ls -t");
+    bench.run("ls-top50/wide", wide.files, 0, "ls -s -n 50");
+    bench.run("ls-stream/wide", wide.files, 0, "ls -f");
+
+    // stat：随机选择文件
+    bench.run("stat/wide", 1, 0, manyIterations, [&](unsigned) {
+        return "stat f" + std::to_string(random.below(wideFiles));
+    });
+
+    // mv：改名后再改回来（每次操作计一次）
+    bench.run("mv/wide", 1, 0, manyIterations, [&](unsigned i) {
+        unsigned file = i / 2 % wideFiles;
+        return i % 2 == 0 ? "mv f" + std::to_string(file) + " moved" : "mv moved f" + std::to_string(file);
+    });
+
+    // search / du：遍历整棵树
+    explorer.execute("cd " + quote(root));
+    bench.run("search/tiny", tiny.files + tiny.dirs, 0, "search DIR1 -i");
+    bench.run("search/all", wide.files + deep.files + deep.dirs + tiny.files + tiny.dirs, 0, "search item9");
+    bench.run("du/tiny", tiny.files + tiny.dirs, tiny.bytes, "du tiny");
+    bench.run("du/deep", deep.files + deep.dirs, deep.bytes, "du deep");
+    bench.run("du/wide", wide.files, wide.bytes, "du wide");
+
+    // dedup：只查找不替换
+    bench.run("dedup/tiny", tiny.files + tiny.dirs, tiny.bytes, "dedup tiny");
+
+    // snapshot：保存后与自己比较（没有变化，仍要解码、归并全部记录）
+    bench.run("snapshot-save/tiny", tiny.files + tiny.dirs, 0, "snapshot save tiny tiny.snap");
+    bench.run("snapshot-diff/tiny", 2 * (tiny.files + tiny.dirs), 0, "snapshot diff tiny.snap tiny.snap");
+
+    // grep：内容中不存在的关键词，每个文件都要完整扫描一遍
+    bench.run("grep/tiny", tiny.files, tiny.bytes, "grep zqxjzqxj tiny");
+    bench.run("grep/huge", huge.files, huge.bytes, "grep zqxjzqxj huge");
+
+    // cp：单个大文件、小文件很多的目录树（复制结果在计时之外删除）
+    unsigned copyIterations = std::max(1u, iterations / 4);
+    bench.run("cp/huge", 1, hugeSize, copyIterations,
+              [&](unsigned i) { return "cp huge/h" + std::to_string(i % 4) + " copy"; },
+              [&](unsigned) { removePath(root + "/copy"); });
+    bench.run("cp-r/tiny", tiny.files + tiny.dirs, tiny.bytes, copyIterations,
+              [&](unsigned) { return std::string("cp -r tiny tiny-copy"); },
+              [&](unsigned) { removePath(root + "/tiny-copy"); });
+
+    // sync：目标已是最新（只比较大小和 mtime），先在计时之外同步一次
+    explorer.execute("sync tiny tiny-mirror");
+    bench.run("sync-noop/tiny", tiny.files + tiny.dirs, 0, "sync tiny tiny-mirror");
+    removePath(root + "/tiny-mirror");
+
+    // touch：一条命令创建 10000 个文件（花括号展开，并行 openat）
+    bench.run("touch-10k", 10000, 0, copyIterations,
+              [&](unsigned) {
+                  mkdir((root + "/bulk").c_str(), 0755);
+                  return std::string("touch bulk/f{0..9999}");
+              },
+              [&](unsigned) { removePath(root + "/bulk"); });
+
+    // rm -r：每次先（不计时）复制出一份再删除
+    explorer.setAssumeYes(true);
+    bench.run("rm-r/tiny", tiny.files + tiny.dirs, 0, copyIterations,
+              [&](unsigned) {
+                  explorer.execute("cp -r tiny tiny-rm");
+                  return std::string("rm -r tiny-rm");
+              });
+
+    std::cout.rdbuf(previous);
+
+    // ========== 输出结果 ==========
+    if (outFile.empty()) {
+        bench.writeJson(std::cout, trees, scale);
+    } else {
+        std::ofstream out(outFile);
+        bench.writeJson(out, trees, scale);
+        std::cerr << "Results written to " << outFile << "\n";
+    }
+
+    if (keep) {
+        std::cerr << "Trees kept in " << root << "\n";
+    } else {
+        removePath(root);
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef COMMANDTABLE_H
+#define COMMANDTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * CommandTable - 编译期生成的完美哈希表（命令名 -> 处理函数）
+ *
+ * 构造函数是 constexpr 的：编译时搜索一个哈希种子，使所有命令名落在不同的槽位上。
+ * 查找时只计算一次哈希、比较一次字符串，与命令数量无关，代替逐个比较的 if/else 链。
+ * 找不到合适的种子（理论上不会发生）时编译失败。
+ *
+ * 用法:
+ *   using Handler = void (*)(const ArgList&);
+ *   static constexpr CommandTable<Handler, 2> table({{
+ *       {"cd", &doCd},
+ *       {"ls", &doLs},
+ *   }});
+ *   if (Handler handler = table.find(name)) { handler(args); }
+ */
+template <typename Handler, size_t N>
+class CommandTable {
+public:
+    struct Command {
+        std::string_view name;
+        Handler handler;
+    };
+
+    constexpr explicit CommandTable(const Command (&commands)[N]) : seed(findSeed(commands)) {
+        for (size_t i = 0; i < N; i++) {
+            slots[slotOf(commands[i].name, seed)] = commands[i];
+        }
+    }
+
+    /**
+     * 查找命令，找不到返回空的 Handler（nullptr）
+     */
+    constexpr Handler find(std::string_view name) const {
+        const Command& slot = slots[slotOf(name, seed)];
+        return slot.name == name && !name.empty() ? slot.handler : Handler();
+    }
+
+private:
+    // 槽位数：不小于命令数 2 倍的 2 的幂，容易找到无冲突的种子
+    static constexpr size_t tableSize() {
+        size_t size = 1;
+        while (size < 2 * N) {
+            size <<= 1;
+        }
+        return size;
+    }
+    static constexpr size_t kSize = tableSize();
+
+    // 带种子的 FNV-1a
+    static constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : name) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    static constexpr size_t slotOf(std::string_view name, uint32_t seed) {
+        return hash(name, seed) & (kSize - 1);
+    }
+
+    static constexpr uint32_t findSeed(const Command (&commands)[N]) {
+        for (uint32_t seed = 0; seed < 100000; seed++) {
+            bool used[kSize] = {};
+            bool ok = true;
+            for (size_t i = 0; i < N && ok; i++) {
+                size_t slot = slotOf(commands[i].name, seed);
+                ok = !used[slot];
+                used[slot] = true;
+            }
+            if (ok) {
+                return seed;
+            }
+        }
+        // 在常量求值中抛出异常会导致编译失败
+        throw "CommandTable: no perfect hash seed found";
+    }
+
+    uint32_t seed;
+    Command slots[kSize] = {};
+};
+
+#endif // COMMANDTABLE_H
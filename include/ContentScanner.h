@@ -0,0 +1,108 @@
+#ifndef CONTENTSCANNER_H
+#define CONTENTSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "NameMatcher.h"
+
+struct JobControl;
+
+/**
+ * ContentScanner - 在文件内容中查找关键词（grep 命令）
+ *
+ * 每个线程一个实例（读缓冲区和输出缓冲区在文件之间复用），共享同一个 NameMatcher：
+ * - 小文件（不超过 kReadLimit）直接 read 进缓冲区，省掉 mmap/munmap 的开销
+ * - 大文件 mmap 后按 kWindowSize 的窗口扫描，扫描过的窗口立即 MADV_DONTNEED，
+ *   常驻内存不随文件大小增长
+ * - 扫描期间文件被截断时，访问映射区末尾之后的页会产生 SIGBUS：扫描前登记映射区域，
+ *   信号处理函数发现地址落在其中就跳回 scanMapped，按文件已经变短处理（保留之前的结果）
+ * - 管道等不能 mmap 的文件按块 read，跨块的行保留到下一块；
+ *   超过 kMaxLineLength 的行按这个长度切开处理（跨切点的匹配会漏掉）
+ * - 查找整块数据用 NameMatcher 的 SIMD 首尾字节过滤，只有命中时才向前后找行边界、
+ *   用 memchr 补数行号，不逐行处理
+ * - 第一块数据中含有 '\0' 的文件视为二进制文件，跳过
+ *
+ * 结果按 "路径:行号:内容" 追加到 output()，同一文件的结果按行号顺序输出；
+ * 超过 kFlushSize 时调用 flush 回调（由调用者加锁写出并清空）。
+ *
+ * 用法:
+ *   NameMatcher matcher("timeout", false);
+ *   ContentScanner scanner(matcher, control, [&](std::string& text) { ... });
+ *   scanner.scanAt(dirFd, "server.log", "logs/server.log");
+ */
+class ContentScanner {
+public:
+    using Flush = std::function<void(std::string&)>;
+
+    // 不超过这个大小的文件直接 read
+    static constexpr size_t kReadLimit = 128 * 1024;
+    // mmap 的文件每次扫描的窗口大小
+    static constexpr size_t kWindowSize = 64 * 1024 * 1024;
+    // 判断二进制文件时检查的字节数
+    static constexpr size_t kBinaryProbe = 4096;
+    // 输出缓冲区超过这个大小时调用 flush
+    static constexpr size_t kFlushSize = 64 * 1024;
+    // 按块读取时一行最多保留这么多字节
+    static constexpr size_t kMaxLineLength = 16 * 1024 * 1024;
+
+    enum class Status { Scanned, Binary, Failed };
+
+    /**
+     * @param matcher 关键词（必须比本对象活得久）
+     * @param control 非空时在窗口之间检查取消请求、累加已扫描的字节数
+     * @param flush 输出缓冲区满时调用
+     */
+    ContentScanner(const NameMatcher& matcher, JobControl* control, Flush flush);
+
+    /**
+     * 扫描 dirFd 下的文件 name（必须以 '\0' 结尾）
+     * @param path 输出时显示的路径
+     * @return Failed 时 errno 保留失败原因
+     */
+    Status scanAt(int dirFd, const char* name, std::string_view path);
+
+    /**
+     * 扫描已打开的 fd（文件、管道等）
+     */
+    Status scanFd(int fd, std::string_view path);
+
+    std::string& output() { return out; }
+
+    uint64_t matchedLines() const { return lines; }
+    uint64_t matchedFiles() const { return files; }
+    uint64_t scannedBytes() const { return bytes; }
+
+private:
+    const NameMatcher& matcher;
+    JobControl* control;
+    Flush flush;
+
+    std::vector<char> buffer;  // read 使用的缓冲区
+    std::string out;
+    uint64_t lines = 0;
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+
+    // 当前文件的状态
+    std::string_view path;
+    uint64_t lineNumber = 1;   // 下一个未计数位置所在的行号
+    bool fileMatched = false;
+    size_t pendingLine;        // 正在追加的输出行在 out 中的起始位置，没有时为 npos
+
+    Status scanMapped(int fd, size_t size);
+    void scanWindows(const char* data, size_t size);
+    Status scanStream(int fd);
+
+    /**
+     * 扫描由完整行组成的一块数据（最后一行可以没有换行符，仅限文件末尾）
+     */
+    void scanLines(const char* data, size_t size);
+
+    static bool looksBinary(const char* data, size_t size);
+};
+
+#endif // CONTENTSCANNER_H
@@ -0,0 +1,74 @@
+#ifndef COPYENGINE_H
+#define COPYENGINE_H
+
+#include <cstdint>
+
+/**
+ * CopyEngine - 分级的文件数据复制
+ *
+ * 按从快到慢的顺序尝试，前一种不可用时自动退到下一种：
+ *   1. reflink (ioctl FICLONE)：btrfs / XFS 等支持写时复制的文件系统上，
+ *      只复制元数据，与文件大小无关，几乎瞬间完成
+ *   2. copy_file_range：数据在内核中复制，不经过用户态；
+ *      部分文件系统（NFS、同一设备上的 XFS 等）还可以在服务端/设备端完成
+ *   3. sendfile：同样在内核中复制，兼容更老的内核
+ *   4. read/write 循环：1 MiB 大缓冲区，配合 posix_fadvise 提示顺序读取，
+ *      并及时丢弃已读的页缓存，避免大文件复制挤掉其他缓存
+ *
+ * cp、mv（跨设备）等命令都通过这里复制文件内容。
+ */
+
+/**
+ * 实际使用的复制方式
+ */
+enum class CopyTier {
+    None,           // 没有复制任何数据（空文件）
+    Reflink,
+    CopyFileRange,
+    Sendfile,
+    ReadWrite
+};
+
+/**
+ * 复制方式的名称，用于输出，例如 "reflink"
+ */
+const char* copyTierName(CopyTier tier);
+
+/**
+ * 复制结果
+ */
+struct CopyResult {
+    bool ok = false;
+    int error = 0;                  // 失败时的 errno
+    CopyTier tier = CopyTier::None; // 最终完成复制所用的方式
+    uint64_t bytes = 0;             // 复制的字节数
+};
+
+/**
+ * 复制文件内容：从 inFd 的当前位置读到末尾，写到 outFd 的当前位置
+ * @param inFd 源文件（只读打开）
+ * @param outFd 目标文件（只写打开，通常是刚创建的空文件）
+ * @return 复制结果
+ */
+CopyResult copyFileData(int inFd, int outFd);
+
+/**
+ * 只尝试 reflink（共享整个文件的数据块），不退回到其他复制方式
+ * @param inFd 源文件（只读打开）
+ * @param outFd 目标文件（只写打开的空文件）
+ * @return 成功返回 0；否则返回 errno（文件系统不支持时通常是 EOPNOTSUPP / EXDEV / EINVAL）
+ */
+int reflinkFile(int inFd, int outFd);
+
+/**
+ * 复制一个普通文件：srcDirFd/srcName -> dstDirFd/dstName
+ *
+ * 目标文件以 O_EXCL 创建（已存在时失败，errno 为 EEXIST），权限与源文件相同；
+ * 复制失败时删除不完整的目标文件。
+ *
+ * @param preserveTimes 是否同时复制访问/修改时间
+ */
+CopyResult copyFileAt(int srcDirFd, const char* srcName, int dstDirFd, const char* dstName,
+                      bool preserveTimes = false);
+
+#endif // COPYENGINE_H
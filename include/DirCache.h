@@ -0,0 +1,105 @@
+#ifndef DIRCACHE_H
+#define DIRCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include "EntryTable.h"
+
+/**
+ * DirCache - 进程内的目录列表缓存
+ *
+ * 缓存每个目录的条目名称和 stat 结果（类型、大小、修改/访问时间，列式存储在 EntryTable 中），
+ * 同一个目录反复 ls / ls -s / ls -t 时直接从内存返回，不再读取目录。
+ * 读取文件不会产生会使缓存失效的事件（不监听 IN_ACCESS，否则每次读取都要丢弃缓存），
+ * 缓存中的访问时间可能已经过时；stat 命令因此总是直接 stat。
+ *
+ * 失效方式：
+ *   - 支持 inotify 时（第一次缓存目录时创建 inotify 实例），为每个缓存的目录添加 watch；目录中有条目创建、删除、改名、
+ *     内容或属性变化时，对应的缓存被丢弃。每次查询前非阻塞地读取一次 inotify 事件。
+ *   - 不支持 inotify（或 watch 数量达到上限）时，退回到比较目录的 mtime/ctime。
+ *     这种方式只能发现条目的增删改名，发现不了已有文件的内容变化；
+ *     并且 mtime 距构建时刻太近（同一个时间戳粒度内可能还有修改）的列表不会被信任。
+ *   - 两种方式都会比较目录的 dev/ino，路径被换成另一个目录时缓存失效。
+ *
+ * 内存占用有上限，超过时按 LRU 淘汰最久未使用的目录。
+ * 符号链接按其指向的目标 stat（与 ls 的显示一致），目标本身的变化不会使缓存失效。
+ *
+ * 用法:
+ *   DirCache cache;
+ *   int error = 0;
+ *   auto listing = cache.get("/data", error);
+ *   if (!listing) { ... error 为 errno ... }
+ *   for (size_t i = 0; i < listing->size(); i++) { listing->row(i) ... }
+ */
+class DirCache {
+public:
+    static constexpr size_t kDefaultMemoryLimit = 64 << 20;
+
+    explicit DirCache(size_t memoryLimit = kDefaultMemoryLimit);
+    ~DirCache();
+
+    DirCache(const DirCache&) = delete;
+    DirCache& operator=(const DirCache&) = delete;
+
+    /**
+     * 获取目录列表：缓存有效时直接返回，否则读取目录并放入缓存
+     * @param dir 规范化后的绝对路径
+     * @param error 失败时保存 errno
+     * @return 失败返回 nullptr
+     */
+    std::shared_ptr<const EntryTable> get(const std::string& dir, int& error);
+
+    /**
+     * 只返回已缓存且仍然有效的列表（不会为此读取目录）
+     * @param dir 规范化后的绝对路径
+     * @return 未缓存返回 nullptr
+     */
+    std::shared_ptr<const EntryTable> find(const std::string& dir);
+
+    /**
+     * 当前缓存占用的内存（估算值）
+     */
+    size_t memoryUsed() const;
+
+private:
+    struct Slot {
+        std::shared_ptr<const EntryTable> listing;
+        std::list<std::string>::iterator lruPosition;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        struct timespec mtime = {};
+        struct timespec ctime = {};
+        int watch = -1;          // inotify watch，-1 表示使用 mtime 校验
+        bool racy = false;       // 构建时 mtime 太新，不能仅凭 mtime 判断是否有效
+        size_t bytes = 0;
+    };
+
+    size_t memoryLimit;
+    size_t used = 0;
+    int inotifyFd = -1;
+    bool inotifyTried = false;    // 是否已经尝试创建 inotifyFd
+    std::unordered_map<std::string, Slot> slots;
+    std::unordered_map<int, std::string> watchToDir;
+    std::list<std::string> lru;   // 最近使用的在前
+    mutable std::mutex mutex;
+
+    // 读取并处理所有待处理的 inotify 事件
+    void drainEvents();
+    // 检查缓存是否仍然有效（调用前已 drainEvents）
+    bool stillValid(const std::string& dir, Slot& slot);
+    // 丢弃一个目录的缓存
+    void erase(const std::string& dir);
+    // 丢弃全部缓存（inotify 事件队列溢出时）
+    void clear();
+    // 淘汰最久未使用的目录，直到内存占用不超过上限
+    void evict();
+};
+
+#endif // DIRCACHE_H
@@ -0,0 +1,82 @@
+#ifndef DUCACHE_H
+#define DUCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TreeWalker.h"
+
+/**
+ * DuCache - du --incremental 使用的持久化目录大小缓存
+ *
+ * 保存在缓存目录中（见 cacheFilePath），按目录规范化路径（和 -x 选项）区分。
+ * 每个目录一条记录：名称、父目录、子目录范围、dev/ino、mtime，
+ * 以及该目录下直接文件（非目录条目）的总大小和数量；子树的合计在读取时累加得到。
+ *
+ * 文件格式（所有整数为本机字节序，各段按 8 字节对齐）：
+ *   CacheHeader
+ *   DirRecord[dirCount]     目录表：按广度优先顺序，同一目录的子目录连续存放
+ *   LinkRecord[linkCount]   多链接文件（st_nlink > 1）表：按所属目录连续存放
+ *   char[stringBytes]       字符串区：目录名称和根路径
+ *
+ * 更新方式：
+ *   - 没有可用的缓存时用 TreeWalker 并行完整遍历一次，并写入缓存
+ *   - 有缓存时从根开始逐层检查，同一层的目录由 parallelFor 并行处理：目录的 dev/ino/mtime
+ *     与缓存一致时，直接使用缓存中的文件合计和子目录列表，只对每个子目录 fstatat 一次；
+ *     不一致时才重新读取该目录（getdents + 每个条目一次 fstatat）。
+ *     条目都相对所在目录的 fd 访问
+ *   - 硬链接仍然只统计一次：每个目录记录它负责统计的多链接文件，
+ *     重新读取的目录中的多链接文件若已被某个复用的目录统计过则跳过；
+ *     原来负责统计的目录有变化、而这次没有再遇到的多链接文件，其他名称可能在复用的目录中，
+ *     这时改为完整遍历
+ *
+ * 局限：目录的 mtime 只在其中的条目增删、改名时变化，已有文件的内容（大小）变化
+ * 不会被发现；需要准确结果时去掉 --incremental 运行普通的 du。
+ * mtime 与记录时刻过于接近（同一个时间戳粒度内可能还有修改）的目录下次总是重新读取。
+ */
+class DuCache {
+public:
+    /**
+     * 一个直接子目录的合计
+     */
+    struct Subdir {
+        std::string name;
+        uint64_t bytes = 0;
+        uint64_t files = 0;
+    };
+
+    /**
+     * 更新结果
+     */
+    struct Result {
+        bool ok = false;
+        std::string error;          // 失败原因
+        bool cancelled = false;     // 因取消请求提前结束（缓存未写入）
+        bool fromScratch = false;   // 没有可用的缓存（或无法确定硬链接的归属），进行了完整遍历
+        uint64_t bytes = 0;         // 总大小
+        uint64_t files = 0;         // 文件数
+        uint64_t dirs = 0;          // 目录数（不含根）
+        uint64_t entries = 0;       // 实际读取（getdents + stat）的条目数
+        uint64_t rescanned = 0;     // 重新读取的目录数
+        uint64_t reused = 0;        // 使用缓存的目录数
+        uint64_t errors = 0;        // 无法读取的目录/条目数
+        unsigned threads = 1;       // 使用的线程数
+        std::vector<Subdir> subdirs;  // 根目录的直接子目录
+    };
+
+    /**
+     * 某个目录对应的缓存文件路径
+     * @param root 规范化后的绝对路径
+     * @param oneFileSystem 是否为 -x（不跨文件系统）的结果
+     */
+    static std::string cacheFileFor(const std::string& root, bool oneFileSystem);
+
+    /**
+     * 计算目录大小：有缓存时只重新读取变化的目录，完成后写回缓存
+     * @param root 规范化后的绝对路径
+     * @param options 使用其中的 threads / oneFileSystem / control
+     */
+    static Result update(const std::string& root, const WalkOptions& options);
+};
+
+#endif // DUCACHE_H
@@ -0,0 +1,109 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct JobControl;
+
+/**
+ * DuplicateFinder - 查找内容相同的文件（dedup 命令）
+ *
+ * 逐级缩小候选范围，越往后代价越高、需要处理的文件越少：
+ *   1. 按大小分组：TreeWalker 并行遍历时顺便 stat，大小唯一的文件直接排除，不读取内容
+ *   2. 部分哈希：大小相同的文件只读开头和结尾各 4 KiB，计算 XXH64；
+ *      不超过 8 KiB 的文件这一步已经读完全部内容
+ *   3. 完整哈希：部分哈希也相同的文件才完整读取并计算 XXH64
+ * 第 2、3 步由 parallelFor 的线程池对多个文件同时读取；读取前按 inode 排序，减少磁头/预读的跳跃。
+ * 比较以 inode 为单位：同一文件的多个硬链接只读取一次，它们的所有名称一起记录、一起替换
+ * （只替换其中一个名称时 inode 仍被其他名称引用，空间不会释放）。
+ * 链接数多于目录树中名称数的 inode 在树外还有硬链接，替换后也不会释放空间，优先把它当作原件。
+ *
+ * 哈希相同只说明内容"几乎肯定"相同；replaceDuplicates 在替换之前会逐字节比较。
+ */
+
+/**
+ * 查找选项
+ */
+struct DedupOptions {
+    unsigned threads = 0;           // 线程数，0 表示自动
+    bool oneFileSystem = false;     // true: 不进入其他文件系统的挂载点
+    uint64_t minSize = 1;           // 小于这个大小的文件不参与比较（默认跳过空文件）
+    JobControl* control = nullptr;  // 非空时报告进度（条目数、读取的字节数）并检查取消请求
+};
+
+/**
+ * 一个文件（inode）
+ */
+struct DuplicateFile {
+    std::vector<std::string> paths;  // 该 inode 在目录树中的所有名称（相对 baseFd，按字典序排列）
+    bool linkedOutside = false;      // 目录树以外还有硬链接（替换后空间不会释放）
+};
+
+/**
+ * 一组内容相同的文件
+ */
+struct DuplicateGroup {
+    uint64_t size = 0;                // 每个文件的大小
+    std::vector<DuplicateFile> files; // 第一个视为原件（优先选 linkedOutside 的，其次按路径字典序）
+    uint64_t reclaimableBytes = 0;    // 替换其余文件可以回收的空间（不含 linkedOutside 的文件）
+};
+
+/**
+ * 查找结果
+ */
+struct DedupResult {
+    bool ok = false;                      // 根目录是否成功打开
+    std::string error;                    // 根目录打开失败的原因
+    bool cancelled = false;               // 是否因取消请求而提前结束（结果不完整）
+    unsigned threads = 0;                 // 使用的线程数
+    uint64_t files = 0;                   // 参与比较的文件数（inode 数，已排除过小的文件）
+    uint64_t sizeCandidates = 0;          // 大小与其他文件相同的文件数（第 2 步处理的文件）
+    uint64_t fullyHashed = 0;             // 完整计算哈希的文件数（第 3 步处理的文件）
+    uint64_t bytesRead = 0;               // 第 2、3 步读取的数据量
+    uint64_t errors = 0;                  // 无法读取的文件/目录数
+    std::vector<DuplicateGroup> groups;   // 按可回收空间从大到小排列
+    uint64_t duplicateFiles = 0;          // 多余的副本数（每组除第一个以外的文件）
+    uint64_t duplicateNames = 0;          // 这些副本的名称数（替换时逐个替换）
+    uint64_t reclaimableBytes = 0;        // 删除多余副本可以回收的空间
+};
+
+/**
+ * 查找 baseFd/root 下内容相同的普通文件
+ */
+DedupResult findDuplicates(int baseFd, const std::string& root, const DedupOptions& options = DedupOptions());
+
+/**
+ * 替换方式
+ */
+enum class DedupLink {
+    HardLink,   // 多余的副本换成指向原件的硬链接（必须在同一文件系统）
+    Reflink     // 多余的副本换成原件的 reflink（写时复制，文件仍然独立；需要 btrfs / XFS 等）
+};
+
+/**
+ * 替换结果
+ */
+struct DedupReplaceResult {
+    uint64_t replaced = 0;      // 替换的名称数
+    uint64_t bytes = 0;         // 回收的空间（只计算所有链接都已替换、确实释放的 inode）
+    uint64_t skipped = 0;       // 查找之后内容/大小发生了变化而跳过的名称数
+    uint64_t mismatched = 0;    // 权限或所有者与原件不同、没有换成硬链接的名称数
+    uint64_t errors = 0;        // 替换失败的文件数
+    std::string firstError;     // 第一个失败的文件及原因
+};
+
+/**
+ * 把每组中除第一个以外的文件替换成第一个文件的硬链接 / reflink
+ *
+ * 每个文件先与原件逐字节比较，相同才替换；替换时先在同一目录中创建临时的链接，
+ * 再 rename 覆盖，任何时刻该路径都指向完整的文件。一个文件的所有名称都换成同一个新 inode，
+ * 原来互为硬链接的名称替换后仍互为硬链接。
+ * 硬链接共享原件的权限和所有者，两者不同的文件不替换（计入 mismatched）；
+ * reflink 保留副本原来的权限、所有者和时间。
+ */
+DedupReplaceResult replaceDuplicates(int baseFd, const std::vector<DuplicateGroup>& groups, DedupLink mode,
+                                     const DedupOptions& options = DedupOptions());
+
+#endif // DUPLICATEFINDER_H
@@ -0,0 +1,117 @@
+#ifndef ENTRYTABLE_H
+#define ENTRYTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * EntryTable - 列式存储的目录条目表（structure of arrays）
+ *
+ * 每个条目不再是一个带多个 std::string 的结构体，而是拆成几列紧凑的数组：
+ *   names      所有名称连续存放在一块缓冲区中（每个以 '\0' 结尾）
+ *   nameStart  每个名称在缓冲区中的起始位置
+ *   types      类型（1 字节）
+ *   sizes      大小（字节）
+ *   mtimes / atimes  修改/访问时间（纳秒）
+ *
+ * 一百万个条目只需要几次大块分配；排序时只对 (键, 下标) 排序，不移动条目本身；
+ * 大小、时间的字符串在输出时才生成。
+ *
+ * 用法:
+ *   EntryTable table;
+ *   EntryTable::Row row;
+ *   EntryTable::statAt(dirFd, name, row);
+ *   table.append(name, row);
+ *   for (uint32_t i : table.order(EntryTable::SortBy::Size, 50)) { table.row(i) ... }
+ */
+class EntryTable {
+public:
+    /**
+     * 条目类型（stat 跟随符号链接；stat 失败时为 Unknown，比如失效的符号链接）
+     */
+    enum class Type : uint8_t {
+        Unknown,
+        File,
+        Dir
+    };
+
+    /**
+     * 排序方式（都是降序：大的/新的在前）
+     */
+    enum class SortBy {
+        None,
+        Size,
+        Time
+    };
+
+    /**
+     * 一个条目的全部信息（name 指向表内的缓冲区，表修改之前有效）
+     */
+    struct Row {
+        std::string_view name;
+        Type type = Type::Unknown;
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+        int64_t atimeNs = 0;
+    };
+
+    /**
+     * 用一次 fstatat（跟随符号链接）填充 row 的类型、大小和时间（不设置名称）
+     * @return stat 失败时返回 false，此时 row.type 为 Unknown
+     */
+    static bool statAt(int dirFd, const char* name, Row& row);
+
+    /**
+     * 排序键：按大小时目录和未知条目视为 0，按时间时未知条目最旧
+     */
+    static int64_t sortKey(const Row& row, SortBy by);
+
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+
+    void reserve(size_t entries, size_t nameBytes);
+
+    /**
+     * 添加一个条目（名称复制到表内的缓冲区）
+     */
+    void append(std::string_view name, const Row& row);
+
+    /**
+     * 释放预留但未使用的空间（表不再增长时调用）
+     */
+    void shrinkToFit();
+
+    std::string_view name(size_t i) const {
+        return std::string_view(names.data() + nameStart[i], nameStart[i + 1] - nameStart[i] - 1);
+    }
+    const char* nameData(size_t i) const { return names.data() + nameStart[i]; }
+    Type type(size_t i) const { return types[i]; }
+    uint64_t fileSize(size_t i) const { return sizes[i]; }
+    int64_t mtimeNs(size_t i) const { return mtimes[i]; }
+    int64_t atimeNs(size_t i) const { return atimes[i]; }
+    Row row(size_t i) const { return Row{name(i), types[i], sizes[i], mtimes[i], atimes[i]}; }
+
+    /**
+     * 输出顺序（条目下标的排列）
+     * @param by 排序方式；None 时为文件系统顺序
+     * @param limit 只需要前 limit 个（0 表示全部）；排序时用大小为 limit 的堆，O(N log K)
+     */
+    std::vector<uint32_t> order(SortBy by, size_t limit = 0) const;
+
+    /**
+     * 占用的内存（字节）
+     */
+    size_t memoryBytes() const;
+
+private:
+    std::vector<char> names;
+    std::vector<uint32_t> nameStart = {0};   // 比条目数多 1 个，最后一个是缓冲区末尾
+    std::vector<Type> types;
+    std::vector<uint64_t> sizes;
+    std::vector<int64_t> mtimes;
+    std::vector<int64_t> atimes;
+};
+
+#endif // ENTRYTABLE_H
@@ -0,0 +1,225 @@
+#ifndef FILEUTILS_H
+#define FILEUTILS_H
+
+#include <cstddef>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/**
+ * FileUtils - 底层文件操作的公共工具
+ *
+ * 这里放的是多个命令共用的 POSIX 辅助类/函数，
+ * 比如自动关闭的文件描述符。
+ */
+
+/**
+ * UniqueFd - 独占的文件描述符（RAII）
+ *
+ * 析构时自动 close()，不可复制、可移动。
+ * 用法:
+ *   UniqueFd fd(openat(dirFd, name, O_RDONLY));
+ *   if (!fd) { ... 打开失败 ... }
+ */
+class UniqueFd {
+public:
+    UniqueFd() = default;
+    explicit UniqueFd(int fd) : fd(fd) {}
+    ~UniqueFd() { reset(); }
+
+    UniqueFd(const UniqueFd&) = delete;
+    UniqueFd& operator=(const UniqueFd&) = delete;
+
+    UniqueFd(UniqueFd&& other) noexcept : fd(other.release()) {}
+    UniqueFd& operator=(UniqueFd&& other) noexcept {
+        if (this != &other) {
+            reset(other.release());
+        }
+        return *this;
+    }
+
+    int get() const { return fd; }
+    explicit operator bool() const { return fd >= 0; }
+
+    /**
+     * 放弃所有权并返回 fd（调用者负责关闭）
+     */
+    int release() {
+        int old = fd;
+        fd = -1;
+        return old;
+    }
+
+    /**
+     * 关闭当前 fd，并接管新的 fd
+     */
+    void reset(int newFd = -1);
+
+private:
+    int fd = -1;
+};
+
+/**
+ * 目录中的一个条目（指向 DirReader 的缓冲区，下一次 next() 之前有效）
+ */
+struct DirEntryView {
+    const char* name;       // 以 '\0' 结尾的名称
+    size_t nameLength;      // 名称长度
+    unsigned char type;     // DT_REG / DT_DIR / DT_LNK / ...，DT_UNKNOWN 表示需要 stat 才能确定
+};
+
+/**
+ * DirReader - 批量读取目录条目
+ *
+ * Linux 上直接使用 getdents64 系统调用，一次读取一整块条目到调用者提供的缓冲区，
+ * 遍历时不会为每个条目分配内存；其他平台退回到 readdir。
+ * 自动跳过 "." 和 ".."，不负责关闭 fd。
+ *
+ * 用法:
+ *   DirReader reader(dirFd, buffer, bufferSize);
+ *   DirEntryView entry;
+ *   while (reader.next(entry)) { ... }
+ *   if (reader.error() != 0) { ... 读取出错 ... }
+ */
+class DirReader {
+public:
+    // 推荐的缓冲区大小：足够大以减少系统调用次数
+    static const size_t kBufferSize = 256 * 1024;
+
+    DirReader(int fd, char* buffer, size_t bufferSize);
+    ~DirReader();
+
+    DirReader(const DirReader&) = delete;
+    DirReader& operator=(const DirReader&) = delete;
+
+    /**
+     * 读取下一个条目
+     * @return 没有更多条目（或出错）时返回 false
+     */
+    bool next(DirEntryView& entry);
+
+    /**
+     * 读取出错时的 errno，正常结束为 0
+     */
+    int error() const { return err; }
+
+private:
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t pos = 0;
+    int err = 0;
+    bool eof = false;
+    void* dir = nullptr;  // 非 Linux 平台使用的 DIR*
+};
+
+/**
+ * MappedFile - 只读内存映射的文件（RAII）
+ *
+ * 用于直接读取磁盘上的索引/缓存文件，无需把整个文件读进内存。
+ * 空文件也能打开成功（size() == 0，data() == nullptr）。
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * 映射文件
+     * @param path 文件路径
+     * @return 成功返回 true；失败返回 false，errno 保留失败原因
+     */
+    bool open(const std::string& path);
+
+    /**
+     * 映射已经打开的文件（不接管 fd，映射建立后即可关闭 fd）
+     * @return 成功返回 true；失败返回 false，errno 保留失败原因
+     */
+    bool open(int fd);
+
+    /**
+     * 解除映射
+     */
+    void close();
+
+    const char* data() const { return static_cast<const char*>(addr); }
+    size_t size() const { return length; }
+    bool isOpen() const { return opened; }
+
+private:
+    void* addr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
+
+/**
+ * OutputBuffer - 带大缓冲区的输出流缓冲（写入文件描述符）
+ *
+ * 批处理模式下把 std::cout 的 rdbuf 换成它：输出先攒在内存里，
+ * 满了（或显式 flush）才一次 write()，而不是每行一次系统调用。
+ * 析构时自动写出剩余内容。
+ *
+ * 用法:
+ *   OutputBuffer buffer(STDOUT_FILENO);
+ *   std::streambuf* old = std::cout.rdbuf(&buffer);
+ *   ...
+ *   std::cout.rdbuf(old);
+ */
+class OutputBuffer : public std::streambuf {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    explicit OutputBuffer(int fd, size_t capacity = kDefaultCapacity);
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    int fd;
+    std::vector<char> storage;
+
+    // 把缓冲区内容全部写出，失败返回 false
+    bool drain();
+};
+
+/**
+ * 获取缓存文件路径（索引等持久化数据放在这里，而不是写进用户的目录）
+ *
+ * 目录为 $XDG_CACHE_HOME/minifileexplorer 或 ~/.cache/minifileexplorer，
+ * 不存在时自动创建。文件名由 kind 和 key 的哈希组成，
+ * 例如 cacheFilePath("index", "/data") -> ~/.cache/minifileexplorer/index-3f2a....bin
+ *
+ * @param kind 缓存种类（作为文件名前缀）
+ * @param key 区分不同缓存的键（通常是规范化后的目录路径）
+ * @return 缓存文件路径；无法确定缓存目录时返回空字符串
+ */
+std::string cacheFilePath(const std::string& kind, const std::string& key);
+
+/**
+ * 把内存中的数据写入文件：先写临时文件再 rename，
+ * 保证读者要么看到旧文件、要么看到完整的新文件
+ * @return 成功返回 true
+ */
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
+
+/**
+ * 把字节数格式化成便于阅读的字符串
+ *
+ * 示例:
+ *   formatBytes(512)        -> "512 B"
+ *   formatBytes(1536)       -> "1.5 KiB"
+ *   formatBytes(3221225472) -> "3.0 GiB"
+ */
+std::string formatBytes(unsigned long long bytes);
+
+#endif // FILEUTILS_H
@@ -0,0 +1,103 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * IoUring - 最小化的 io_uring 封装（直接使用系统调用，不依赖 liburing）
+ *
+ * 用于把大量小的 I/O 请求（打开、读、写、关闭文件）攒成一批，
+ * 一次 io_uring_enter 提交并等待全部完成，减少系统调用往返次数。
+ *
+ * 不支持 io_uring 的平台/内核（或被 seccomp 禁用时），supported() 返回 false，
+ * 调用者应退回到普通系统调用。
+ *
+ * 用法:
+ *   IoUring ring;
+ *   if (ring.init(64)) {
+ *       ring.prepOpenat(dirFd, "a.txt", O_RDONLY, 0, 1);
+ *       ring.prepOpenat(dirFd, "b.txt", O_RDONLY, 0, 2);
+ *       ring.submitAndWait(2);
+ *       uint64_t userData; int32_t res;
+ *       while (ring.popCompletion(userData, res)) { ... }
+ *   }
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * 当前内核是否支持 io_uring 以及需要的操作（openat/read/write/close），只检测一次
+     */
+    static bool supported();
+
+    /**
+     * 创建 ring
+     * @param entries 提交队列大小（一批最多提交的请求数）
+     * @return 失败返回 false
+     */
+    bool init(unsigned entries);
+
+    /**
+     * 可以继续添加的请求数
+     */
+    unsigned spaceLeft() const;
+
+    // ========== 添加请求（只放入队列，submitAndWait 时才真正提交） ==========
+    // userData 会原样出现在对应的完成事件中；link 为 true 时下一个请求要等本请求成功后才执行
+
+    bool prepOpenat(int dirFd, const char* path, int flags, unsigned mode, uint64_t userData);
+    bool prepClose(int fd, uint64_t userData);
+    bool prepRead(int fd, void* buffer, unsigned length, uint64_t offset, uint64_t userData, bool link = false);
+    bool prepWrite(int fd, const void* buffer, unsigned length, uint64_t offset, uint64_t userData,
+                   bool link = false);
+
+    /**
+     * 提交所有已添加的请求，并等待至少 waitCount 个完成
+     * @return 成功返回 true
+     */
+    bool submitAndWait(unsigned waitCount);
+
+    /**
+     * 取出一个完成事件
+     * @param userData 请求的 userData
+     * @param result 系统调用的返回值（失败时为 -errno）
+     * @return 没有完成事件时返回 false
+     */
+    bool popCompletion(uint64_t& userData, int32_t& result);
+
+private:
+    int ringFd = -1;
+
+    // 映射的共享内存
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    // 提交队列
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqEntries = 0;
+    unsigned pendingTail = 0;   // 已添加但尚未提交的请求写到的位置
+    unsigned toSubmit = 0;
+
+    // 完成队列
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    void* cqes = nullptr;
+
+    void* nextSqe();
+};
+
+#endif // IOURING_H
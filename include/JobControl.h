@@ -0,0 +1,29 @@
+#ifndef JOBCONTROL_H
+#define JOBCONTROL_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * JobControl - 长时间运行的操作与调用者之间共享的控制块
+ *
+ * 后台任务（见 JobManager）为每个任务创建一个，通过 WalkOptions / TreeCopyOptions
+ * 传给 TreeWalker、TreeCopier 等：
+ *   - 调用者设置 cancelled 请求取消，执行方在处理每个目录/条目/文件之前检查，
+ *     尽快停止（协作式取消，不会中断正在进行的单个系统调用）
+ *   - 执行方累加 entries / bytes，调用者随时读取以显示进度
+ * 所有成员都是原子的，可以被多个线程同时读写。
+ */
+struct JobControl {
+    std::atomic<bool> cancelled{false};
+    std::atomic<uint64_t> entries{0};   // 已处理的目录条目数
+    std::atomic<uint64_t> bytes{0};     // 已处理的数据量
+
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    void addEntries(uint64_t n) { entries.fetch_add(n, std::memory_order_relaxed); }
+    void addBytes(uint64_t n) { bytes.fetch_add(n, std::memory_order_relaxed); }
+};
+
+#endif // JOBCONTROL_H
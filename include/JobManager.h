@@ -0,0 +1,131 @@
+#ifndef JOBMANAGER_H
+#define JOBMANAGER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "JobControl.h"
+
+/**
+ * JobManager - 后台任务（命令末尾加 & 提交）
+ *
+ * - 固定数量的工作线程（第一次提交时才启动），任务按提交顺序执行，
+ *   多出来的任务排队等待；每个任务内部的 du / cp -r 等仍然是多线程的
+ * - 每个任务有自己的 JobControl：cancel 设置取消标志，jobs 读取进度（条目数、字节数）
+ * - 任务的输出写入自己的缓冲区，不直接写终端；主循环在显示提示符之前调用 drain，
+ *   把已完成的整行加上 "[编号] " 前缀输出，任务结束时再输出一行完成信息，
+ *   这样后台输出不会插到用户正在输入的命令行中间
+ * - 析构时取消所有任务并等待工作线程退出
+ *
+ * 除 Work 本身外，所有方法都只应在主线程调用。
+ */
+class JobManager {
+public:
+    /**
+     * 任务的执行函数，在工作线程中调用
+     * @param control 进度与取消请求
+     * @param output 任务的输出
+     * @return 任务是否成功
+     */
+    using Work = std::function<bool(JobControl& control, std::streambuf& output)>;
+
+    /**
+     * @param workers 工作线程数，0 表示自动（CPU 核数的 1/4，至少 2 个）
+     */
+    explicit JobManager(unsigned workers = 0);
+    ~JobManager();
+
+    JobManager(const JobManager&) = delete;
+    JobManager& operator=(const JobManager&) = delete;
+
+    /**
+     * 提交任务
+     * @param command 命令文本（用于显示）
+     * @return 任务编号（从 1 开始）
+     */
+    unsigned submit(const std::string& command, Work work);
+
+    /**
+     * 请求取消任务（排队中的任务不会再执行）
+     * @return 没有该任务时返回 false
+     */
+    bool cancel(unsigned id);
+
+    /**
+     * 等待任务结束，并输出它剩余的输出和完成信息
+     * @return 没有该任务时返回 false
+     */
+    bool wait(unsigned id, std::ostream& out);
+
+    /**
+     * 等待所有任务结束
+     */
+    void waitAll(std::ostream& out);
+
+    /**
+     * 输出各任务新产生的整行输出，以及已结束任务的完成信息（之后任务从列表中移除）
+     */
+    void drain(std::ostream& out);
+
+    /**
+     * 输出任务列表：状态、进度、速率
+     */
+    void list(std::ostream& out);
+
+    bool empty();
+
+private:
+    enum class State { Queued, Running, Done, Failed, Cancelled };
+
+    // 任务的输出缓冲区（工作线程写入，主线程读取）
+    class Output : public std::streambuf {
+    public:
+        // 取出所有完整的行（最后一个 '\n' 之前的内容）；final 为 true 时取出全部
+        std::string takeLines(bool final);
+
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+
+    private:
+        std::mutex mutex;
+        std::string text;
+    };
+
+    struct Job {
+        unsigned id = 0;
+        std::string command;
+        Work work;
+        JobControl control;
+        Output output;
+        State state = State::Queued;  // 由 JobManager::mutex 保护
+        int64_t startNs = 0;          // 开始执行的时间
+        int64_t endNs = 0;            // 结束的时间
+    };
+
+    unsigned workerCount;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable queued;    // 有新任务或需要退出
+    std::condition_variable finished;  // 有任务结束
+    std::deque<std::shared_ptr<Job>> pending;
+    std::vector<std::shared_ptr<Job>> jobs;  // 所有尚未报告完成的任务，按编号排序
+    unsigned nextId = 1;
+    bool stopping = false;
+
+    void workerLoop();
+    std::shared_ptr<Job> find(unsigned id);
+    void report(Job& job, bool final, std::ostream& out);
+    static bool isFinished(State state);
+    static const char* stateName(State state);
+};
+
+#endif // JOBMANAGER_H
@@ -4,6 +4,12 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <ostream>
+#include <string_view>
+#include "DirCache.h"
+#include "JobManager.h"
+#include "Tokenizer.h"
+#include "WorkingDirectory.h"
 
 /**
  * MiniFileExplorer - 迷你文件管理器主类
@@ -15,8 +21,13 @@
  * - 文件/目录删除 (rm, rmdir)
  * - 文件信息查询 (stat)
  * - 文件搜索 (search)
+ * - 文件内容搜索 (grep)
  * - 文件复制/移动 (cp, mv)
+ * - 增量同步 (sync)
  * - 目录大小计算 (du)
+ * - 重复文件查找 (dedup)
+ * - 目录树快照与比较 (snapshot)
+ * - 后台任务 (命令末尾加 &，jobs / wait / cancel)
  */
 class MiniFileExplorer {
 public:
@@ -28,18 +39,101 @@ public:
     
     /**
      * 主循环 - 程序的核心，持续接收用户命令并执行
+     * @return 有命令失败时返回 1，否则返回 0（可作为进程退出码）
      */
-    void run();
+    int run();
+
+    /**
+     * 批处理模式 - 不显示提示符，依次执行脚本中的命令，输出批量写出
+     * 命令之间用换行或 ';' 分隔，'#' 开头的行是注释
+     * @param script 命令来源（-c 的字符串或 -f 的文件）
+     * @param stopOnError 为 true 时遇到第一个失败的命令就停止
+     * @return 有命令失败时返回 1，否则返回 0
+     */
+    int runBatch(std::istream& script, bool stopOnError);
+
+    /**
+     * 执行一行命令（不显示提示符），输出写入构造时 std::cout 的缓冲区
+     * 供嵌入调用（如基准测试程序 bench/Benchmark.cpp）使用
+     * @return 有命令失败时返回 false
+     */
+    bool execute(std::string_view line) { return handleCommand(line); }
+
+    /**
+     * 需要确认的操作（如 rm）是否直接视为回答 "y"
+     */
+    void setAssumeYes(bool yes) { assumeYes = yes; }
 
 private:
-    // 当前工作目录路径
+    /**
+     * 后台任务使用的构造函数：在 cwd 中执行命令，输出写入 output，
+     * 通过 control 报告进度、响应取消请求；需要确认的操作除非 assumeYes 否则视为取消
+     */
+    MiniFileExplorer(WorkingDirectory cwd, JobControl& control, std::streambuf& output, bool assumeYes);
+
+    // 所有命令的输出（前台为 std::cout 的缓冲区，批处理时换成 OutputBuffer，后台任务为任务自己的缓冲区）
+    std::ostream out;
+
+    // 当前目录：相对路径的操作都通过 workingDir.fd() 的 *at() 系统调用进行，
+    // currentPath 是它的规范化路径（显示、目录缓存、索引查找使用）
+    WorkingDirectory workingDir;
     std::filesystem::path currentPath;
 
+    // 目录列表缓存（ls / stat 共用）
+    DirCache dirCache;
+
+    // 运行状态
+    bool running = true;        // exit 命令后变为 false
+    bool interactive = true;    // 批处理模式下为 false
+    bool assumeYes = false;     // 跳过二次确认
+    bool commandFailed = false; // 当前命令是否失败
+    bool stopOnError = false;   // 批处理 -e：遇到失败的命令就停止
+    bool scriptOnStdin = false; // 批处理的脚本来自标准输入（-f -），确认时不能再读取回答
+
+    // 命令行切分器（缓冲区在命令之间复用）
+    Tokenizer tokenizer;
+
+    // 后台任务（前台实例使用）；本实例是后台任务时 control 指向任务的控制块
+    JobManager jobs;
+    JobControl* control = nullptr;
+
+    /**
+     * 输出错误信息，并把当前命令标记为失败
+     * 用法: fail() << "File not found: " << name << '\n';
+     */
+    std::ostream& fail();
+
+    /**
+     * 二次确认：输出问题并读取一行回答，仅 "y" 视为确认
+     */
+    bool confirm(const std::string& question);
+
+    /**
+     * 把用户输入的路径转换为绝对路径
+     * 绝对路径直接使用，相对路径基于当前目录
+     * @param name 用户输入的路径
+     */
+    std::filesystem::path resolvePath(std::string_view name) const;
+
+    /**
+     * 本实例作为后台任务运行且已被取消
+     */
+    bool cancelled() const { return control != nullptr && control->isCancelled(); }
+
+    /**
+     * 把一条命令提交为后台任务
+     * @param name 命令名
+     * @param command 命令文本（不含末尾的 &）
+     */
+    void submitJob(std::string_view name, std::string_view command);
+
     /**
-     * 处理用户输入的命令
+     * 处理用户输入的一行（可以包含多条用 ';' 分隔的命令）
+     * 命令名通过编译期生成的完美哈希表查找（见 CommandTable）
      * @param line 用户输入的完整命令字符串
+     * @return 有命令失败时返回 false
      */
-    void handleCommand(const std::string& line);
+    bool handleCommand(std::string_view line);
 
     // ========== 命令处理方法 ==========
     
@@ -48,92 +142,138 @@ private:
      * 用法: cd [路径]
      * 示例: cd ../.. 或 cd ./test 或 cd ~
      */
-    void cmdCd(const std::vector<std::string>& args);
+    void cmdCd(const ArgList& args);
     
     /**
      * ls 命令 - 列出当前目录内容
      * 用法: ls [选项]
-     * 选项: -s (按大小排序), -t (按时间排序)
+     * 选项: -s (按大小排序), -t (按时间排序), -n N (只显示 N 条), --offset M (跳过 M 条),
+     *       -f (按目录顺序流式输出，内存占用与目录大小无关)
      */
-    void cmdLs(const std::vector<std::string>& args);
+    void cmdLs(const ArgList& args);
     
     /**
-     * touch 命令 - 创建空文件
-     * 用法: touch [文件名]
+     * touch 命令 - 创建空文件（多个名字时并行创建）
+     * 用法: touch [文件名...]，支持花括号展开：touch f{0..99}
      */
-    void cmdTouch(const std::vector<std::string>& args);
+    void cmdTouch(const ArgList& args);
     
     /**
-     * mkdir 命令 - 创建目录
-     * 用法: mkdir [目录名]
+     * mkdir 命令 - 创建目录（多个名字时并行创建）
+     * 用法: mkdir [-p] [目录名...]，支持花括号展开：mkdir -p d{1..9}/{a,b}
      */
-    void cmdMkdir(const std::vector<std::string>& args);
+    void cmdMkdir(const ArgList& args);
     
     /**
-     * rm 命令 - 删除文件
-     * 用法: rm [文件名]
+     * rm 命令 - 删除文件，或并行删除整个目录树（TreeRemover）
+     * 用法: rm [文件名] 或 rm -r [-j N] [目录名]
      */
-    void cmdRm(const std::vector<std::string>& args);
+    void cmdRm(const ArgList& args);
     
     /**
      * rmdir 命令 - 删除空目录
      * 用法: rmdir [目录名]
      */
-    void cmdRmdir(const std::vector<std::string>& args);
+    void cmdRmdir(const ArgList& args);
     
     /**
      * stat 命令 - 显示文件/目录详细信息
      * 用法: stat [文件名/目录名]
      */
-    void cmdStat(const std::vector<std::string>& args);
+    void cmdStat(const ArgList& args);
     
     /**
-     * search 命令 - 搜索文件/目录
-     * 用法: search [关键词]
+     * search 命令 - 搜索文件/目录（有索引时查询索引）
+     * 用法: search [关键词] [选项]
+     * 选项: -i (忽略大小写)
      */
-    void cmdSearch(const std::vector<std::string>& args);
+    void cmdSearch(const ArgList& args);
+
+    /**
+     * grep 命令 - 在文件内容中查找关键词（并行遍历，大文件 mmap）
+     * 用法: grep [选项] [关键词] [文件或目录名]
+     * 选项: -i (忽略大小写), -j N (使用 N 个线程)
+     */
+    void cmdGrep(const ArgList& args);
+
+    /**
+     * index 命令 - 建立/查看文件名索引
+     * 用法: index build [目录名] 或 index info [目录名]
+     */
+    void cmdIndex(const ArgList& args);
+
+    /**
+     * snapshot 命令 - 保存/比较目录树快照（见 TreeSnapshot）
+     * 用法: snapshot save <目录名> <文件> [-j N] [-x]、snapshot diff <旧文件> <新文件> 或 snapshot info <文件>
+     */
+    void cmdSnapshot(const ArgList& args);
+    
+    /**
+     * cp 命令 - 复制文件（依次尝试 reflink、copy_file_range、sendfile、read/write）
+     * 用法: cp [源文件] [目标路径] 或 cp -r [-j N] [源目录] [目标路径]
+     */
+    void cmdCp(const ArgList& args);
     
     /**
-     * cp 命令 - 复制文件
-     * 用法: cp [源文件] [目标路径]
+     * mv 命令 - 移动/重命名文件或目录（同设备原子重命名，跨设备复制后删除）
+     * 用法: mv [源] [目标] 或 mv [源1] [源2] ... [目标目录]
      */
-    void cmdCp(const std::vector<std::string>& args);
+    void cmdMv(const ArgList& args);
+
+    /**
+     * sync 命令 - 增量同步目录树（只处理变化的文件和块，见 TreeSync）
+     * 用法: sync [源目录] [目标目录]
+     * 选项: -j N (使用 N 个线程)
+     */
+    void cmdSync(const ArgList& args);
     
     /**
-     * mv 命令 - 移动/重命名文件或目录
-     * 用法: mv [源] [目标]
+     * du 命令 - 计算目录大小（并行遍历，含各子目录大小）
+     * 用法: du [目录名] [选项]
+     * 选项: -j N (使用 N 个线程), -x (不跨越文件系统), --incremental (只重新读取变化的目录)
+     */
+    void cmdDu(const ArgList& args);
+
+    /**
+     * dedup 命令 - 查找内容相同的文件，可选替换成硬链接 / reflink（见 DuplicateFinder）
+     * 用法: dedup [目录名] [选项]
+     * 选项: -j N, -x, --min-size N, --link, --reflink
      */
-    void cmdMv(const std::vector<std::string>& args);
+    void cmdDedup(const ArgList& args);
     
     /**
-     * du 命令 - 计算目录大小
-     * 用法: du [目录名]
+     * stats 命令 - 查看/控制命令耗时和系统调用统计
+     * 用法: stats [on | off | reset | json [文件名]]
      */
-    void cmdDu(const std::vector<std::string>& args);
+    void cmdStats(const ArgList& args);
     
+    /**
+     * jobs 命令 - 列出后台任务及其进度
+     */
+    void cmdJobs(const ArgList& args);
+
+    /**
+     * wait 命令 - 等待后台任务结束并显示其输出
+     * 用法: wait [任务编号]（不指定时等待所有任务）
+     */
+    void cmdWait(const ArgList& args);
+
+    /**
+     * cancel 命令 - 取消后台任务
+     * 用法: cancel [任务编号]
+     */
+    void cmdCancel(const ArgList& args);
+
     /**
      * help 命令 - 显示帮助信息
      */
-    void printHelp();
+    void cmdHelp(const ArgList& args);
     
     /**
      * exit 命令 - 退出程序
      */
-    void cmdExit();
+    void cmdExit(const ArgList& args);
 };
 
-/**
- * 工具函数：将命令字符串分割成参数列表
- * 
- * 示例:
- *   split("cd ../test")  -> {"cd", "../test"}
- *   split("ls -s")       -> {"ls", "-s"}
- *   split("touch a.txt") -> {"touch", "a.txt"}
- * 
- * @param line 完整的命令字符串
- * @return 分割后的参数向量，第一个元素是命令名
- */
-std::vector<std::string> split(const std::string& line);
-
 #endif // MINIFILEEXPLORER_H
 
@@ -0,0 +1,61 @@
+#ifndef NAMEMATCHER_H
+#define NAMEMATCHER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * NameMatcher - 向量化的子串匹配
+ *
+ * 关键词在构造时预处理一次，之后对任意多的名称（或文件内容）做子串查找。
+ * 算法：用 SIMD 同时比较一块数据中所有位置的"首字节"和"尾字节"，
+ * 两者都相等的位置才逐字节比较中间部分，绝大多数位置一次就被排除。
+ *
+ * - x86-64：运行时检测 CPU，优先 AVX2（32 字节/次），否则 SSE2（16 字节/次）
+ * - 其他平台：标量实现
+ * - 忽略大小写时只折叠 ASCII 字母
+ *
+ * 用法:
+ *   NameMatcher matcher("report", true);
+ *   if (matcher.matches(name, length)) { ... }
+ */
+class NameMatcher {
+public:
+    /**
+     * @param needle 要查找的关键词
+     * @param ignoreCase 是否忽略大小写
+     */
+    NameMatcher(std::string_view needle, bool ignoreCase);
+
+    /**
+     * text 中是否包含关键词
+     */
+    bool matches(const char* text, size_t length) const {
+        return find(text, length) != npos;
+    }
+
+    bool matches(std::string_view text) const {
+        return find(text.data(), text.size()) != npos;
+    }
+
+    /**
+     * 查找关键词第一次出现的位置
+     * @return 位置下标；未找到返回 npos
+     */
+    size_t find(const char* text, size_t length) const;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+private:
+    // 关键词（忽略大小写时已转为小写）
+    std::string needle;
+    bool ignoreCase;
+
+    using FindFunction = size_t (*)(const NameMatcher&, const char*, size_t);
+    FindFunction findImpl;
+
+    friend struct NameMatcherKernels;
+};
+
+#endif // NAMEMATCHER_H
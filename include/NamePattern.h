@@ -0,0 +1,78 @@
+#ifndef NAMEPATTERN_H
+#define NAMEPATTERN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * NamePattern - 编译成 DFA 的名称模式（glob 或正则表达式）
+ *
+ * 模式在构造时编译一次：解析 -> Thompson NFA -> 子集构造得到 DFA，
+ * 256 个字节先按模式中出现的字符集合划分成等价类，转移表只有"状态数 x 等价类数"项。
+ * 之后每个名称只需逐字节查表，不回溯、不分配内存；进入死状态时立即返回。
+ *
+ * 语法：
+ *   - Glob（整个名称匹配，与 find -name 相同）：* ? [abc] [a-z] [!x] [^x]，\ 转义
+ *   - 正则（名称中任意位置匹配，^ / $ 锚定整个模式的开头/结尾，不能与最外层的 | 同时使用）：
+ *     . [...] [^...] * + ? | ( ) \d \w \s，\ 转义其他字符；不支持反向引用和 {m,n}
+ * 忽略大小写时只折叠 ASCII 字母。
+ *
+ * 用法:
+ *   NamePattern pattern;
+ *   std::string error;
+ *   if (!pattern.compile("*.log", NamePattern::Syntax::Glob, false, error)) { ... }
+ *   if (pattern.matches(name, length)) { ... }
+ */
+class NamePattern {
+public:
+    enum class Syntax { Glob, Regex };
+
+    // DFA 状态数上限，超过时编译失败（模式过于复杂）
+    static constexpr size_t kMaxStates = 4096;
+
+    /**
+     * 编译模式
+     * @param error 失败时保存原因
+     * @return 语法错误或状态数超过上限时返回 false
+     */
+    bool compile(std::string_view pattern, Syntax syntax, bool ignoreCase, std::string& error);
+
+    /**
+     * 名称是否匹配
+     */
+    bool matches(const char* text, size_t length) const {
+        uint32_t state = start;
+        for (size_t i = 0; i < length; i++) {
+            state = table[state * classCount + byteClass[static_cast<unsigned char>(text[i])]];
+            if (state == kDead) {
+                return false;
+            }
+            if (acceptEarly && accepting[state]) {
+                return true;
+            }
+        }
+        return accepting[state] != 0;
+    }
+
+    bool matches(std::string_view text) const { return matches(text.data(), text.size()); }
+
+    /**
+     * DFA 状态数（含死状态）
+     */
+    size_t stateCount() const { return accepting.size(); }
+
+private:
+    static constexpr uint32_t kDead = 0;
+
+    uint8_t byteClass[256] = {};      // 字节 -> 等价类
+    uint32_t classCount = 1;
+    std::vector<uint32_t> table{0};   // [状态 * classCount + 等价类] -> 下一个状态
+    std::vector<uint8_t> accepting{0};
+    uint32_t start = kDead;
+    bool acceptEarly = false;         // 未锚定结尾：一旦到达接受状态即可返回
+};
+
+#endif // NAMEPATTERN_H
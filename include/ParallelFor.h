@@ -0,0 +1,79 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// 每次领取的下标数
+const size_t kParallelChunk = 64;
+// threads 为 0 时最多使用的线程数
+const unsigned kParallelMaxThreads = 8;
+
+/**
+ * 处理 count 个下标时实际使用的线程数
+ */
+inline unsigned parallelThreadCount(size_t count, unsigned threads) {
+    if (threads == 0) {
+        threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), kParallelMaxThreads);
+    }
+    // 每个线程至少分到几块，否则创建线程的开销比节省的时间还多
+    size_t useful = (count + 4 * kParallelChunk - 1) / (4 * kParallelChunk);
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, useful)));
+}
+
+/**
+ * parallelFor - 把 [0, count) 分成小块，由一个小线程池并行处理
+ *
+ * 适合大量互相独立、每个只需一两次系统调用的操作（touch / mkdir 成千上万个名字）：
+ * 线程每次从共享的原子计数器领取 kParallelChunk 个下标，处理快的线程自然多领，
+ * 不需要预先均分。调用线程本身也参与处理（编号 0）；数量较少时直接在调用线程中完成，
+ * 不创建线程。
+ *
+ * @param threads 线程数（含调用线程），0 表示 CPU 核数（最多 kParallelMaxThreads）
+ * @param fn 处理函数 fn(unsigned worker, size_t index)，worker 在 [0, 实际线程数) 中，
+ *           可用于无锁的每线程累加；会被多个线程并发调用
+ * @return 实际使用的线程数
+ *
+ * 用法:
+ *   std::vector<Counter> counters(kParallelMaxThreads);
+ *   parallelFor(names.size(), 0, [&](unsigned worker, size_t i) { ... counters[worker] ... });
+ */
+template <typename Fn>
+unsigned parallelFor(size_t count, unsigned threads, Fn&& fn) {
+    threads = parallelThreadCount(count, threads);
+    if (threads == 1) {
+        for (size_t i = 0; i < count; i++) {
+            fn(0u, i);
+        }
+        return 1;
+    }
+
+    std::atomic<size_t> next{0};
+    auto work = [&](unsigned worker) {
+        while (true) {
+            size_t begin = next.fetch_add(kParallelChunk, std::memory_order_relaxed);
+            if (begin >= count) {
+                return;
+            }
+            size_t end = std::min(count, begin + kParallelChunk);
+            for (size_t i = begin; i < end; i++) {
+                fn(worker, i);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& t : pool) {
+        t.join();
+    }
+    return threads;
+}
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,96 @@
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "FileUtils.h"
+
+/**
+ * PathIndex - 持久化的文件名三元组（trigram）索引
+ *
+ * 由 "index build <dir>" 生成，保存在缓存目录中（见 cacheFilePath），
+ * search 命令通过 mmap 直接查询，不需要遍历磁盘。
+ *
+ * 文件格式（所有整数为本机字节序，各段按 8 字节对齐）：
+ *   IndexHeader
+ *   DirRecord[dirCount]         目录表：相对路径、mtime、该目录的条目范围
+ *   EntryRecord[entryCount]     条目表：同一目录的条目连续存放
+ *   TrigramRecord[trigramCount] 三元组表：按 key 升序，可二分查找
+ *   uint32_t[postingCount]      倒排表：每个三元组对应的条目编号（升序）
+ *   char[stringBytes]           字符串区：目录路径和条目名称
+ *
+ * 三元组按小写字母计算，因此同一份索引同时支持区分/不区分大小写的查询。
+ * 目录表记录了每个目录的 mtime，重建索引时 mtime 未变的目录直接复用旧条目，
+ * 只重新读取发生变化的目录。
+ */
+class PathIndex {
+public:
+    /**
+     * 建立索引的结果
+     */
+    struct BuildResult {
+        bool ok = false;
+        std::string error;        // 失败原因
+        std::string file;         // 索引文件路径
+        uint64_t dirs = 0;        // 目录总数（含根）
+        uint64_t entries = 0;     // 条目总数
+        uint64_t rescanned = 0;   // 重新读取的目录数
+        uint64_t reused = 0;      // 从旧索引复用的目录数
+    };
+
+    /**
+     * 查询时每个匹配的回调
+     * @param path 相对索引根目录的路径
+     * @param isDir 是否为目录
+     */
+    using MatchCallback = std::function<void(const std::string& path, bool isDir)>;
+
+    /**
+     * 某个目录对应的索引文件路径
+     * @param root 规范化后的绝对路径
+     */
+    static std::string indexFileFor(const std::string& root);
+
+    /**
+     * 为目录建立（或刷新）索引
+     * @param root 规范化后的绝对路径
+     */
+    static BuildResult build(const std::string& root);
+
+    /**
+     * 打开索引文件
+     * @return 文件不存在或格式不正确时返回 false
+     */
+    bool open(const std::string& file);
+
+    /**
+     * 索引的根目录（建立索引时的绝对路径）
+     */
+    std::string_view root() const;
+
+    uint64_t dirCount() const;
+    uint64_t entryCount() const;
+
+    /**
+     * 建立索引的时间（Unix 时间戳）
+     */
+    int64_t builtAt() const;
+
+    /**
+     * 查询名称中包含 keyword 的条目
+     * @param keyword 关键词
+     * @param ignoreCase 是否忽略大小写（仅 ASCII）
+     * @param subtree 只返回该子目录（相对索引根，空表示全部）下的条目
+     * @param onMatch 匹配回调
+     * @return 匹配的条目数
+     */
+    uint64_t search(std::string_view keyword, bool ignoreCase, std::string_view subtree,
+                    const MatchCallback& onMatch) const;
+
+private:
+    MappedFile file;
+};
+
+#endif // PATHINDEX_H
@@ -0,0 +1,93 @@
+#ifndef SEARCHFILTER_H
+#define SEARCHFILTER_H
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <vector>
+#include "NameMatcher.h"
+#include "NamePattern.h"
+#include "Tokenizer.h"
+#include "TreeWalker.h"
+
+/**
+ * SearchFilter - search 命令的过滤条件（解析一次，编译成按代价排序的检查计划）
+ *
+ * 支持的条件（全部同时满足才输出）：
+ *   关键词          名称包含关键词（SIMD 子串匹配，见 NameMatcher）
+ *   -i              关键词、-name、-regex 忽略大小写
+ *   -name GLOB      名称与 glob 完整匹配（编译成 DFA，见 NamePattern）
+ *   -regex RE       名称中有与正则匹配的部分（DFA）
+ *   -type f|d|l     普通文件 / 目录 / 符号链接
+ *   -size [+|-]N    大小大于 / 小于 / 等于 N 字节，N 可带 K/M/G/T 后缀（1024 进制）
+ *   -mtime [+|-]N   修改时间距今大于 / 小于 / 等于 N 天（按整天向下取整，与 find 相同）
+ *   -maxdepth N     最多深入 N 层（当前目录下的直接条目为第 1 层）
+ *   -prune GLOB     名称匹配的目录整个跳过，不进入、不输出
+ *
+ * 检查顺序由代价决定：
+ *   1. -prune / -maxdepth 下推给 TreeWalker：被剪掉的子树根本不会被打开
+ *   2. 只用 getdents 结果就能判断的条件：-type（d_type 已知时）、关键词、-name、-regex
+ *   3. 需要 stat 的条件：-size、-mtime（以及 d_type 未知时的 -type）
+ * 因此 search -name '*.log' -size +1G 只对名称匹配的条目调用 stat。
+ */
+class SearchFilter {
+public:
+    /**
+     * 解析 search 的参数
+     * @param error 失败时保存原因（未知选项、缺少参数、模式语法错误等）
+     */
+    bool parse(const ArgList& args, std::string& error);
+
+    /**
+     * 是否指定了任何条件（关键词或谓词）
+     */
+    bool empty() const { return keywordText.empty() && !hasPredicates; }
+
+    /**
+     * 是否只有关键词（可以直接查询文件名索引）
+     */
+    bool keywordOnly() const { return !keywordText.empty() && !hasPredicates; }
+
+    const std::string& keyword() const { return keywordText; }
+    bool ignoreCase() const { return ignoreCaseFlag; }
+
+    /**
+     * 把能下推到遍历器的条件写入 options（-maxdepth）；条目默认不预先 stat
+     */
+    void apply(WalkOptions& options) const;
+
+    /**
+     * 对一个条目求值（会被多个线程并发调用）
+     * @param descend 返回是否进入该目录（被 -prune 的目录为 false）
+     * @return 是否满足所有条件
+     */
+    bool matches(WalkEntry& entry, bool& descend) const;
+
+private:
+    // 数值比较：+N 大于，-N 小于，N 等于
+    struct Comparison {
+        enum class Op { Greater, Less, Equal };
+        Op op = Op::Equal;
+        int64_t value = 0;
+
+        bool test(int64_t actual) const {
+            return op == Op::Greater ? actual > value : op == Op::Less ? actual < value : actual == value;
+        }
+    };
+
+    std::string keywordText;
+    bool ignoreCaseFlag = false;
+    bool hasPredicates = false;
+
+    std::optional<NameMatcher> keywordMatcher;
+    std::vector<NamePattern> namePatterns;
+    std::vector<NamePattern> prunePatterns;
+    unsigned char type = 0;                // 0 表示不限
+    std::optional<Comparison> size;
+    std::optional<Comparison> mtimeDays;
+    int maxDepth = -1;
+    std::time_t now = 0;                   // -mtime 的基准时间（解析时确定）
+};
+
+#endif // SEARCHFILTER_H
@@ -0,0 +1,124 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+/**
+ * Stats - 热点路径的低开销统计（stats 命令）
+ *
+ * 两部分：
+ *   - 计数器：访问的目录条目数、复制的字节数、stat/open/getdents 系统调用次数。
+ *     每个线程有自己的槽位（按缓存行对齐，线程之间没有伪共享），
+ *     只有本线程写入，不需要原子的读-改-写指令；读取时把所有槽位相加。
+ *     线程退出后槽位留给下一个线程复用，计数不会丢失。
+ *   - 命令统计：handleCommand 为每条命令记录调用次数、耗时直方图（按 2 的幂分桶），
+ *     以及执行期间各计数器的增量。
+ *
+ * 关闭时（默认）每个计数点只多一次读取全局标志和一个预测正确的分支。
+ * 后台任务与前台命令同时运行时，它们的计数会计入当时正在执行的前台命令。
+ *
+ * 用法:
+ *   Stats::add(Stats::StatCalls);
+ *   Stats::add(Stats::Bytes, result.bytes);
+ *   {
+ *       Stats::CommandTimer timer("ls");   // 析构时记录耗时和计数器增量
+ *       ...
+ *   }
+ */
+class Stats {
+public:
+    enum Counter {
+        Entries,        // 读取到的目录条目
+        Bytes,          // 复制/移动/扫描（grep）的数据量
+        StatCalls,      // stat / fstatat / lstat
+        OpenCalls,      // open / openat
+        GetdentsCalls,  // getdents64 / readdir
+        kCounterCount
+    };
+
+    struct Totals {
+        uint64_t counters[kCounterCount] = {};
+    };
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enable) { active.store(enable, std::memory_order_relaxed); }
+
+    /**
+     * 本线程的计数器加 n（关闭时什么也不做）
+     */
+    static void add(Counter counter, uint64_t n = 1) {
+        if (!enabled()) {
+            return;
+        }
+        Slot* slot = current != nullptr ? current : acquireSlot();
+        std::atomic<uint64_t>& value = slot->counters[counter];
+        // 只有本线程写入：普通的读 + 写即可，原子类型只是为了让其他线程读取时没有数据竞争
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /**
+     * 所有线程的计数器之和（自上次 reset 以来）
+     */
+    static Totals totals();
+
+    /**
+     * 记录一次命令执行
+     * @param name 命令名
+     * @param nanoseconds 耗时
+     * @param delta 执行期间各计数器的增量
+     */
+    static void recordCommand(std::string_view name, uint64_t nanoseconds, const Totals& delta);
+
+    /**
+     * 清空命令统计和计数器
+     */
+    static void reset();
+
+    /**
+     * 输出表格（stats 命令）
+     */
+    static void print(std::ostream& out);
+
+    /**
+     * 输出 JSON
+     */
+    static void writeJson(std::ostream& out);
+
+    /**
+     * 在作用域内为一条命令计时；关闭时构造和析构都不做任何事
+     */
+    class CommandTimer {
+    public:
+        explicit CommandTimer(std::string_view name);
+        ~CommandTimer();
+
+        CommandTimer(const CommandTimer&) = delete;
+        CommandTimer& operator=(const CommandTimer&) = delete;
+
+    private:
+        std::string_view name;
+        bool armed;
+        uint64_t start = 0;
+        Totals before;
+    };
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> counters[kCounterCount] = {};
+        bool inUse = false;
+    };
+
+    // 线程退出时把槽位还回去
+    struct SlotOwner;
+
+    static Slot* acquireSlot();
+
+    static inline std::atomic<bool> active{false};
+    static inline thread_local Slot* current = nullptr;
+};
+
+#endif // STATS_H
@@ -0,0 +1,58 @@
+#ifndef TIMEFORMATTER_H
+#define TIMEFORMATTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+
+/**
+ * TimeFormatter - 快速把时间戳格式化为本地时间 "YYYY-MM-DD HH:MM:SS"
+ *
+ * 逐条调用 localtime + strftime 时，localtime 每次都要加时区锁并重新检查 TZ 环境变量，
+ * 在大目录的 ls 中占了大部分时间。这里按"本地日期"缓存：
+ *   - 第一次遇到某一天时调用一次 localtime_r，记下这一天 00:00:00 对应的时间戳、
+ *     当天的 UTC 偏移和格式化好的日期前缀 "YYYY-MM-DD "
+ *   - 同一天的其他时间戳只需要一次减法，时分秒用两位数字表直接写入缓冲区
+ * 夏令时切换的那一天（一天不是 24 小时）不缓存，每次都调用 localtime_r。
+ *
+ * 缓存是每个线程独立的（thread_local），并行遍历的线程可以直接使用，不需要加锁。
+ * 进程运行期间修改 TZ 不会生效。
+ *
+ * 用法:
+ *   char buffer[TimeFormatter::kBufferSize];
+ *   TimeFormatter::format(st.st_mtim.tv_sec, buffer);
+ *   std::string text = TimeFormatter::format(st.st_mtim.tv_sec);
+ */
+class TimeFormatter {
+public:
+    static constexpr size_t kLength = 19;              // "YYYY-MM-DD HH:MM:SS"
+    static constexpr size_t kBufferSize = kLength + 1; // 含结尾的 '\0'
+
+    /**
+     * 格式化到调用者的缓冲区（至少 kBufferSize 字节，以 '\0' 结尾）
+     * @return 写入的字符数；时间无法表示时写入 "-" 并返回 1
+     */
+    static size_t format(std::time_t seconds, char* buffer);
+
+    static std::string format(std::time_t seconds);
+
+    /**
+     * 格式化 std::filesystem 的时间（文件时钟与系统时钟的差值只计算一次）
+     */
+    static std::string format(const std::filesystem::file_time_type& fileTime);
+
+    /**
+     * 纳秒时间戳转换为秒（向下取整，1970 年以前的时间也正确）
+     */
+    static std::time_t fromNanoseconds(int64_t ns) {
+        int64_t seconds = ns / 1000000000;
+        if (ns % 1000000000 < 0) {
+            seconds--;
+        }
+        return static_cast<std::time_t>(seconds);
+    }
+};
+
+#endif // TIMEFORMATTER_H
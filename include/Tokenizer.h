@@ -0,0 +1,119 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * ArgList - 参数列表的只读视图（不拥有数据，类似 C++20 的 std::span）
+ *
+ * 命令处理函数通过它访问参数，去掉命令名不需要移动或复制任何元素。
+ */
+class ArgList {
+public:
+    ArgList() = default;
+    ArgList(const std::string_view* items, size_t count) : items(items), count(count) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const std::string_view& operator[](size_t i) const { return items[i]; }
+    const std::string_view& front() const { return items[0]; }
+    const std::string_view& back() const { return items[count - 1]; }
+    const std::string_view* begin() const { return items; }
+    const std::string_view* end() const { return items + count; }
+
+    /**
+     * 去掉前 n 个参数后的视图
+     */
+    ArgList dropFront(size_t n = 1) const {
+        return n >= count ? ArgList(items + count, 0) : ArgList(items + n, count - n);
+    }
+
+    /**
+     * 去掉后 n 个参数后的视图
+     */
+    ArgList dropBack(size_t n = 1) const {
+        return n >= count ? ArgList(items, 0) : ArgList(items, count - n);
+    }
+
+private:
+    const std::string_view* items = nullptr;
+    size_t count = 0;
+};
+
+/**
+ * Tokenizer - 把命令行切分成参数（不为每个参数分配内存）
+ *
+ * 规则（与 shell 类似）：
+ *   - 空白字符分隔参数
+ *   - 反斜杠转义下一个字符：  my\ file.txt   -> "my file.txt"
+ *   - 单引号内的内容原样保留：'a b\c'        -> "a b\c"
+ *   - 双引号内只有 \" 和 \\ 是转义："a \"b\""  -> "a "b""
+ *   - 引号可以和普通字符相连：  a"b c"d        -> "ab cd"
+ *   - 引号之外的 ';' 结束一条命令（同一行可以有多条命令）
+ *
+ * 没有引号和转义的参数直接指向输入行本身；需要去掉引号/转义的参数写入内部的缓冲区。
+ * 缓冲区和参数数组在多次调用之间复用，稳定运行时不再分配内存。
+ * 返回的参数在下一次 tokenize 之前有效，且输入行在此期间必须保持不变。
+ *
+ * 用法:
+ *   Tokenizer tokenizer;
+ *   size_t used = 0;
+ *   if (tokenizer.tokenize(line, used) == Tokenizer::Status::Ok) {
+ *       ArgList args = tokenizer.args();   // args[0] 是命令名
+ *   }
+ *   // used 之后是同一行中的下一条命令
+ */
+class Tokenizer {
+public:
+    enum class Status {
+        Ok,
+        UnterminatedQuote,   // 引号没有闭合
+        TrailingBackslash    // 行末的反斜杠后面没有字符
+    };
+
+    /**
+     * 切分一条命令（到 ';' 或行尾为止）
+     * @param line 输入行
+     * @param used 返回消耗的字符数（含结尾的 ';'）
+     */
+    Status tokenize(std::string_view line, size_t& used);
+
+    ArgList args() const { return ArgList(tokens.data(), tokens.size()); }
+
+    /**
+     * 第 i 个参数是否原样来自输入行（不含引号和转义），
+     * 用来区分 & 与 \&、'&' 这类加了引号的普通参数
+     */
+    bool verbatim(size_t i) const;
+
+    /**
+     * 同上，按参数本身判断（token 是 args() 中的元素，或是它去掉前缀得到的 ArgList 中的元素）
+     */
+    bool verbatim(std::string_view token) const;
+
+private:
+    std::vector<std::string_view> tokens;
+    std::string unescaped;   // 去掉引号/转义后的参数内容
+};
+
+/**
+ * 花括号展开（touch / mkdir 使用，与 bash 相同）
+ *   f{a,b,c}      -> fa fb fc
+ *   f{0..3}       -> f0 f1 f2 f3（也可以递减：{3..0}）
+ *   f{08..10}     -> f08 f09 f10（任一端有前导 0 时按最长的一端补 0）
+ *   {a..c}        -> a b c（单个字母）
+ *   d{1..2}/f{a,b} -> d1/fa d1/fb d2/fa d2/fb（多个花括号按笛卡尔积展开，可以嵌套）
+ * 不构成展开的花括号（如 {a}、{1..x}、不配对）原样保留。
+ * 加了引号或转义的参数（Tokenizer::verbatim 为 false）由调用者原样保留，不交给这里展开。
+ *
+ * @param pattern 要展开的参数
+ * @param out 展开结果追加到末尾（按 bash 的顺序）
+ * @param limit out 的总数上限
+ * @return 超过上限时返回 false（out 中保留已展开的部分）
+ */
+bool expandBraces(std::string_view pattern, std::vector<std::string>& out, size_t limit);
+
+#endif // TOKENIZER_H
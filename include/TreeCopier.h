@@ -0,0 +1,63 @@
+#ifndef TREECOPIER_H
+#define TREECOPIER_H
+
+#include <cstdint>
+#include <string>
+
+struct JobControl;
+
+/**
+ * TreeCopier - 流水线式的目录树复制（cp -r）
+ *
+ * 复制大量小文件时，瓶颈是每个文件的系统调用往返，而不是带宽。
+ * 这里把工作分成两级流水线，中间用有界队列连接：
+ *
+ *   遍历线程：读取源目录（getdents64），用 mkdirat 创建目标目录、
+ *            复制符号链接，把普通文件放入队列
+ *      ↓ BoundedQueue（队列满时遍历线程等待，内存占用有上限；队列中的文件让所在目录保持打开，
+ *        因此同时打开的目录数另有上限，约为 RLIMIT_NOFILE 的 1/8）
+ *   复制线程 × N：
+ *     - 支持 io_uring 时，每次取一批文件，打开/关闭以及小文件的读写
+ *       都攒成一批一次提交；大文件交给 CopyEngine（copy_file_range 等）
+ *     - 否则退回到普通的线程池，每个文件单独 openat + CopyEngine
+ *
+ * 所有操作都相对源/目标目录的 fd 进行（openat / mkdirat），不会重复解析完整路径。
+ * 文件和目录的权限、访问/修改时间都会保留；目录的权限和时间在全部内容复制完后再设置，
+ * 这样只读目录也能正常复制，目录 mtime 也不会被后续写入改掉。
+ */
+
+/**
+ * 复制选项
+ */
+struct TreeCopyOptions {
+    unsigned threads = 0;    // 复制线程数，0 表示自动（CPU 核数，至少 4）
+    bool useIoUring = true;  // 是否尝试使用 io_uring
+    JobControl* control = nullptr;  // 非空时报告进度（条目数、字节数）并检查取消请求
+};
+
+/**
+ * 复制结果统计
+ */
+struct TreeCopyStats {
+    bool ok = false;           // 根目录是否成功创建（个别文件失败见 errors）
+    std::string error;         // 根目录失败的原因
+    std::string firstError;    // 第一个出错的条目及原因
+    const char* backend = "";  // 实际使用的后端："io_uring" 或 "thread pool"
+    unsigned threads = 0;      // 复制线程数
+    uint64_t files = 0;        // 复制的普通文件数
+    uint64_t dirs = 0;         // 创建的目录数（含根）
+    uint64_t symlinks = 0;     // 复制的符号链接数
+    uint64_t bytes = 0;        // 复制的数据量
+    uint64_t skipped = 0;      // 跳过的特殊文件数（设备、FIFO、socket）
+    uint64_t errors = 0;       // 失败的条目数
+    bool cancelled = false;    // 是否因取消请求而提前结束（目标目录树不完整）
+};
+
+/**
+ * 复制目录树：srcBaseFd/src -> dstBaseFd/dst
+ * @param dst 目标目录，必须不存在（会被创建）
+ */
+TreeCopyStats copyTree(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst,
+                       const TreeCopyOptions& options = TreeCopyOptions());
+
+#endif // TREECOPIER_H
@@ -0,0 +1,49 @@
+#ifndef TREEREMOVER_H
+#define TREEREMOVER_H
+
+#include <cstdint>
+#include <string>
+
+struct JobControl;
+
+/**
+ * TreeRemover - 并行删除目录树（rm -r，以及 mv 跨设备移动目录后删除源）
+ *
+ * 删除大量小文件时，瓶颈是每个文件一次 unlinkat 的往返，而不是磁盘带宽。
+ * 这里用 TreeWalker 多线程遍历：
+ *   - 每个线程读取自己拿到的目录（getdents64），对其中的非目录条目直接 unlinkat(dirfd, name)
+ *   - 子目录作为新任务分发给其他线程
+ *   - 一个目录的全部子项都处理完后（TreeWalker 的后序回调），由最后完成的线程
+ *     unlinkat(父目录 fd, name, AT_REMOVEDIR)，目录自底向上逐级删除
+ * 所有操作都相对已打开的目录 fd 进行，不跟随符号链接（链接本身被删除）。
+ * 某个条目删除失败时继续删除其他条目，只有包含它的各级目录会保留下来。
+ */
+
+/**
+ * 删除选项
+ */
+struct TreeRemoveOptions {
+    unsigned threads = 0;           // 线程数，0 表示使用 CPU 核数
+    JobControl* control = nullptr;  // 非空时报告进度（条目数）并检查取消请求
+};
+
+/**
+ * 删除结果统计
+ */
+struct TreeRemoveStats {
+    bool ok = false;           // 是否全部删除（含根目录）
+    std::string firstError;    // 第一个出错的条目及原因
+    unsigned threads = 0;      // 使用的线程数
+    uint64_t files = 0;        // 删除的非目录条目数（文件、符号链接等）
+    uint64_t dirs = 0;         // 删除的目录数（含根）
+    uint64_t errors = 0;       // 删除失败或无法读取的条目数
+    bool cancelled = false;    // 是否因取消请求而提前结束（目录树只删除了一部分）
+};
+
+/**
+ * 删除 baseFd/root 及其全部内容（root 必须是目录，不能是指向目录的符号链接）
+ */
+TreeRemoveStats removeTree(int baseFd, const std::string& root,
+                           const TreeRemoveOptions& options = TreeRemoveOptions());
+
+#endif // TREEREMOVER_H
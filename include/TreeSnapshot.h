@@ -0,0 +1,129 @@
+#ifndef TREESNAPSHOT_H
+#define TREESNAPSHOT_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "FileUtils.h"
+#include "TreeWalker.h"
+
+/**
+ * TreeSnapshot - 目录树快照（snapshot save / diff 命令）
+ *
+ * 快照只记录元数据，不复制文件内容：每个条目一条记录（相对路径、大小、mtime、mode、dev/ino），
+ * 两份快照比较即可知道这段时间内目录树的变化。
+ *
+ * 文件格式（头部整数为本机字节序）：
+ *   SnapshotHeader
+ *   char[rootLength]        保存时目录的规范化路径
+ *   记录区                  按路径字节序升序排列的变长记录，每条：
+ *     varint shared         与上一条路径相同的前缀长度
+ *     varint suffixLength   其余部分的长度，后面紧跟这么多字节
+ *     varint mode / size / mtimeNsec / dev / ino，zigzag varint mtimeSec
+ *
+ * 路径按前缀压缩，同一目录下的条目只存名称的不同部分；一条记录通常只有二三十字节。
+ *
+ * diff 把两个文件 mmap 后同时顺序解码、按路径归并，内存只与变化的条目数有关，
+ * 与快照大小无关。只在一边出现的条目先暂存，最后按 dev/ino 配对：
+ * 同一个 inode 在旧快照中被删除、在新快照中被添加，视为改名。
+ * 非目录还要求大小和 mtime 不变（改名不会改变它们），这样 inode 被删除后立即被新文件重用时
+ * 按删除 + 添加报告；目录只要求 inode 和类型相同。
+ */
+class TreeSnapshot {
+public:
+    /**
+     * 一个条目（path 指向解码缓冲区，只在回调期间有效）
+     */
+    struct Entry {
+        std::string_view path;  // 相对快照根的路径
+        uint32_t mode = 0;      // st_mode（含文件类型）
+        uint64_t size = 0;
+        int64_t mtimeSec = 0;
+        int64_t mtimeNsec = 0;
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+    };
+
+    /**
+     * 变化类型
+     */
+    enum class Change {
+        Added,      // 只在新快照中（回调的 newEntry 有效）
+        Removed,    // 只在旧快照中（oldEntry 有效）
+        Modified,   // 路径相同，类型、大小、mtime、mode 或 inode 不同（目录的 mtime 不算）
+        Renamed     // 同一 inode 换了路径（两者都有效；非目录的大小和 mtime 相同）
+    };
+
+    /**
+     * 保存结果
+     */
+    struct SaveResult {
+        bool ok = false;
+        std::string error;        // 失败原因
+        bool cancelled = false;   // 因取消请求提前结束（快照未写入）
+        uint64_t entries = 0;     // 记录的条目数（不含根）
+        uint64_t bytes = 0;       // 快照文件大小
+        uint64_t errors = 0;      // 无法读取的目录/条目数（不在快照中）
+        unsigned threads = 1;     // 使用的线程数
+    };
+
+    /**
+     * 比较结果
+     */
+    struct DiffResult {
+        bool ok = false;
+        std::string error;        // 失败原因（快照损坏）
+        uint64_t oldEntries = 0;  // 旧快照的条目数
+        uint64_t newEntries = 0;  // 新快照的条目数
+        uint64_t added = 0;
+        uint64_t removed = 0;
+        uint64_t modified = 0;
+        uint64_t renamed = 0;     // 不含随父目录一起改名的条目
+    };
+
+    /**
+     * 每个变化的回调
+     * 顺序：先是修改（按路径），然后是改名（按新路径）、添加、删除（按路径）。
+     * 目录改名时只报告目录本身，其中随之改名的条目不再逐个报告。
+     */
+    using ChangeCallback = std::function<void(Change change, const Entry& oldEntry, const Entry& newEntry)>;
+
+    /**
+     * 遍历 baseFd/dir（TreeWalker 并行遍历，lstat 每个条目），把快照写入 file
+     * @param root 记录在快照中的目录路径（规范化路径，仅用于显示）
+     * @param options 使用其中的 threads / oneFileSystem / control
+     */
+    static SaveResult save(int baseFd, const std::string& dir, const std::string& root, const std::string& file,
+                           const WalkOptions& options);
+
+    /**
+     * 打开快照文件
+     * @return 文件不存在或格式不正确时返回 false
+     */
+    bool open(const std::string& file);
+
+    /**
+     * 保存时目录的路径
+     */
+    std::string_view root() const;
+
+    uint64_t entryCount() const;
+
+    /**
+     * 保存快照的时间（Unix 时间戳）
+     */
+    int64_t savedAt() const;
+
+    /**
+     * 比较两份快照
+     * @param before 旧快照
+     * @param after 新快照
+     */
+    static DiffResult diff(const TreeSnapshot& before, const TreeSnapshot& after, const ChangeCallback& onChange);
+
+private:
+    MappedFile file;
+};
+
+#endif // TREESNAPSHOT_H
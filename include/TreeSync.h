@@ -0,0 +1,66 @@
+#ifndef TREESYNC_H
+#define TREESYNC_H
+
+#include <cstdint>
+#include <string>
+
+struct JobControl;
+
+/**
+ * TreeSync - 增量同步目录树（sync 命令，类似 rsync 的本地模式）
+ *
+ * 让目标目录与源目录一致，只处理发生了变化的部分：
+ *   1. TreeWalker 并行遍历源目录：创建目标中缺少的目录，更新不同的符号链接，收集普通文件
+ *   2. parallelFor 的线程池同时处理多个文件：
+ *      - 目标文件的大小和 mtime 都与源文件相同：跳过，不读取内容
+ *      - 目标文件不存在，或源/目标文件小于 1 MiB：用 CopyEngine 完整复制
+ *      - 否则先让临时文件 reflink 目标文件，成功时按块差异更新（rsync 算法）：把目标文件
+ *        切成固定大小的块，计算每块的滚动校验和（弱）与 XXH64（强）；在源文件上逐字节
+ *        滑动窗口查找相同的块，只写入内容或位置有变化的部分；文件系统不支持 reflink 时完整复制
+ *   3. 最后设置目录的权限和时间（从最深的目录开始）
+ *
+ * 文件总是先写到同一目录下的临时文件，设置权限和时间后再 rename 覆盖，
+ * 任何时刻目标路径上都是完整的旧文件或新文件。
+ *
+ * 只存在于目标中的条目保留不删除；硬链接在目标中成为独立的文件。
+ * 块以 64 位的 XXH64 判断相同，不做逐字节比较。
+ */
+
+/**
+ * 同步选项
+ */
+struct TreeSyncOptions {
+    unsigned threads = 0;           // 线程数，0 表示自动
+    JobControl* control = nullptr;  // 非空时报告进度（条目数、处理的字节数）并检查取消请求
+};
+
+/**
+ * 同步结果
+ */
+struct TreeSyncStats {
+    bool ok = false;             // 源目录是否成功打开、目标根目录是否可用
+    std::string error;           // 根目录失败的原因
+    std::string firstError;      // 第一个出错的条目及原因
+    bool cancelled = false;      // 是否因取消请求而提前结束
+    unsigned threads = 0;        // 使用的线程数
+    uint64_t files = 0;          // 源目录中的普通文件数
+    uint64_t unchanged = 0;      // 大小和 mtime 相同而跳过的文件数
+    uint64_t copied = 0;         // 完整复制的文件数
+    uint64_t patched = 0;        // 按块差异更新的文件数
+    uint64_t dirs = 0;           // 新创建的目录数
+    uint64_t symlinks = 0;       // 新建或更新的符号链接数
+    uint64_t skipped = 0;        // 跳过的特殊文件数（设备、FIFO、socket）
+    uint64_t errors = 0;         // 失败的条目数
+    uint64_t copiedBytes = 0;    // 完整复制的数据量
+    uint64_t literalBytes = 0;   // 差异更新中实际写入的数据量（新内容和移动了位置的块）
+    uint64_t reusedBytes = 0;    // 差异更新中与目标文件共享、没有写入的数据量
+};
+
+/**
+ * 同步目录树：srcBaseFd/src -> dstBaseFd/dst
+ * @param dst 目标目录，不存在时创建
+ */
+TreeSyncStats syncTree(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst,
+                       const TreeSyncOptions& options = TreeSyncOptions());
+
+#endif // TREESYNC_H
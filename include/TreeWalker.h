@@ -0,0 +1,136 @@
+#ifndef TREEWALKER_H
+#define TREEWALKER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+
+struct JobControl;
+
+/**
+ * TreeWalker - 并行目录树遍历器
+ *
+ * 供 du / search 等需要遍历整棵目录树的命令复用：
+ * - 多线程 work-stealing：每个线程有自己的任务队列，空闲时从别的线程"偷"任务
+ * - 所有系统调用都相对父目录的 fd 进行（openat / fstatat），不会反复从 / 解析路径
+ * - 用 getdents64 批量读取目录（见 DirReader），遍历时不为每个条目分配内存
+ * - 只需要名称时可以关闭 stat（statEntries = false），类型直接取自 d_type
+ * - 同一文件的多个硬链接按 (设备号, inode) 只算一次
+ * - 可选不跨文件系统（类似 du -x）
+ * - 可选的 JobControl：报告进度（条目数），收到取消请求后尽快停止
+ * - 可选的后序回调：目录及其全部子项处理完后调用（rm -r 用它自底向上删除目录）
+ */
+
+/**
+ * 遍历选项
+ */
+struct WalkOptions {
+    unsigned threads = 0;            // 线程数，0 表示使用 CPU 核数
+    bool oneFileSystem = false;      // true: 不进入其他文件系统的挂载点
+    bool countHardLinksOnce = true;  // true: 硬链接只在第一次遇到时 firstLink = true
+    int maxDepth = -1;               // 最大深度（根下直接子项深度为 1），-1 表示不限制
+    bool statEntries = true;         // false: 不预先 stat，回调中需要时再调用 WalkEntry::stat()
+    JobControl* control = nullptr;   // 非空时报告进度并检查取消请求
+    // 非空时，某个目录未能完整读取（无法打开、读取中途出错或其中有条目无法 stat）时调用，
+    // 参数为该目录的 tag（访问它时回调中设置的值，根目录为 0）和 errno；会被多个线程并发调用
+    std::function<void(uint64_t tag, int error)> dirError;
+};
+
+/**
+ * 遍历到的一个条目（文件、目录、符号链接等）
+ *
+ * 注意：name / parentPath 只在回调期间有效，需要保存时请自行复制。
+ * name 指向目录读取缓冲区，后面紧跟 '\0'。
+ */
+struct WalkEntry {
+    int dirFd;                   // 所在目录的 fd，可用于 openat / fstatat
+    std::string_view name;       // 条目名称
+    std::string_view parentPath; // 所在目录相对遍历根的路径（根目录下为空）
+    int depth;                   // 深度，根下直接子项为 1
+    unsigned worker;             // 当前线程编号 [0, threadCount)，可用于无锁的每线程累加
+    bool isDir;                  // 是否为目录
+    unsigned char type;          // DT_REG / DT_DIR / DT_LNK / ...（来自 d_type，stat 之后以 st_mode 为准），
+                                 // DT_UNKNOWN 表示需要 stat 才能确定
+    bool firstLink;              // 硬链接去重后是否为第一次出现（非硬链接或未 stat 时总是 true）
+    uint64_t tag;                // 从父目录继承的标记，目录回调中修改后会传给其子项
+
+    // 以下由 TreeWalker 内部维护
+    struct stat *statBuffer;     // stat 结果的存放位置
+    int statState;               // 0: 尚未 stat，1: 成功，-1: 失败
+
+    /**
+     * lstat 结果（不跟随符号链接）
+     * statEntries 为 true 时已经预先获取；否则第一次调用时才执行 fstatat
+     * @return 失败时返回 nullptr
+     */
+    const struct stat *stat();
+
+    /**
+     * 条目相对遍历根的路径，例如 "src/main.cpp"
+     */
+    std::string relativePath() const;
+
+    /**
+     * 把相对路径追加到 out 末尾（不额外分配临时字符串）
+     */
+    void appendRelativePath(std::string& out) const;
+};
+
+/**
+ * 遍历结果统计
+ */
+struct WalkStats {
+    bool rootOk = false;       // 根目录是否成功打开并读完
+    int rootErrno = 0;         // 根目录失败时的 errno（打开、fstat 或读取失败；开始前已取消为 ECANCELED）
+    uint64_t files = 0;        // 非目录条目数
+    uint64_t dirs = 0;         // 目录数（不含根）
+    uint64_t errors = 0;       // 无法读取的目录/条目数
+    bool cancelled = false;    // 是否因取消请求而提前结束（结果不完整）
+};
+
+class TreeWalker {
+public:
+    /**
+     * 访问回调，会被多个线程并发调用
+     * 对目录返回 false 表示不进入该目录；对文件返回值被忽略
+     */
+    using Visitor = std::function<bool(WalkEntry&)>;
+
+    /**
+     * 后序回调，会被多个线程并发调用
+     * 目录中的所有条目（含各级子目录）都处理完后，由最后完成的线程调用一次；
+     * entry.dirFd 是其父目录的 fd（根目录为 baseFd，name 为 root 路径，depth 为 0）。
+     * 只对实际进入过的目录调用（visit 返回 false、超过 maxDepth 的不调用）；取消后不再调用
+     */
+    using Leaver = std::function<void(WalkEntry&)>;
+
+    explicit TreeWalker(const WalkOptions& options = WalkOptions());
+
+    /**
+     * 实际使用的线程数
+     */
+    unsigned threadCount() const { return threads; }
+
+    /**
+     * 遍历目录树（阻塞直到完成）
+     * @param baseFd 解析 root 时使用的目录 fd（AT_FDCWD 表示进程当前目录）
+     * @param root 根目录路径（绝对路径或相对 baseFd 的路径）
+     * @param visit 访问回调
+     * @return 遍历统计
+     */
+    WalkStats walk(int baseFd, const std::string& root, const Visitor& visit) const;
+
+    /**
+     * 遍历目录树，并在每个目录处理完后调用 leave（后序）
+     * 目录完成之前它的父目录 fd 保持打开，供 leave 使用
+     */
+    WalkStats walk(int baseFd, const std::string& root, const Visitor& visit, const Leaver& leave) const;
+
+private:
+    WalkOptions options;
+    unsigned threads;
+};
+
+#endif // TREEWALKER_H
@@ -0,0 +1,90 @@
+#ifndef WORKINGDIRECTORY_H
+#define WORKINGDIRECTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sys/types.h>
+#include "FileUtils.h"
+
+/**
+ * WorkingDirectory - 文件管理器的当前目录
+ *
+ * 持有当前目录的 O_PATH fd（不可读写，只用作 *at() 系统调用的起点）和它的规范化路径：
+ *   - 所有相对路径的操作都用 openat / fstatat / mkdirat / unlinkat ... 相对这个 fd 进行，
+ *     内核只解析用户输入的那几级路径，不再每次从 / 开始重新解析
+ *   - 当前目录被改名或移动后，fd 仍然指向同一个目录，不会出现检查和使用之间路径
+ *     被替换成另一个目录的问题（TOCTOU）
+ *
+ * cd 只需要一次 openat 和一次 fstat。规范化路径（用于显示和目录缓存的键）
+ * 来自一个小缓存：按字面规范化后的绝对路径 -> (规范化路径, 设备号, inode)，
+ * 命中且 dev/ino 与刚打开的 fd 一致时直接使用，否则通过 /proc/self/fd 读取 fd 的真实路径。
+ * 因为总是与打开的 fd 比较，缓存的内容过期（目录被替换、经过符号链接的 ..）也不会出错。
+ *
+ * 用法:
+ *   WorkingDirectory cwd;
+ *   int error = cwd.open("/data");
+ *   error = cwd.change("../logs");       // 0 或 errno（ENOENT / ENOTDIR / EACCES ...）
+ *   fstatat(cwd.fd(), "a.txt", &st, 0);  // 相对当前目录
+ */
+class WorkingDirectory {
+public:
+    static constexpr size_t kCacheCapacity = 64;
+
+    WorkingDirectory() = default;
+
+    WorkingDirectory(WorkingDirectory&&) = default;
+    WorkingDirectory& operator=(WorkingDirectory&&) = default;
+
+    /**
+     * 打开目录作为当前目录（相对路径基于进程的工作目录）
+     * @return 成功返回 0，失败返回 errno，当前目录不变
+     */
+    int open(const std::string& path);
+
+    /**
+     * 切换到 target（相对路径基于当前目录）
+     * @return 成功返回 0，失败返回 errno，当前目录不变
+     */
+    int change(std::string_view target);
+
+    /**
+     * 复制一份（dup 当前目录的 fd，缓存为空），供后台任务使用：
+     * 之后前台 cd 不影响任务，任务也不会因为目录改名而找不到它
+     * @return 失败（fd 用尽）时返回的对象无效
+     */
+    WorkingDirectory clone() const;
+
+    int fd() const { return dirFd.get(); }
+    explicit operator bool() const { return static_cast<bool>(dirFd); }
+
+    /**
+     * 当前目录的规范化路径（不含符号链接、. 和 ..）
+     */
+    const std::string& path() const { return current; }
+
+private:
+    struct CacheEntry {
+        std::string canonical;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        uint64_t lastUse = 0;
+    };
+
+    UniqueFd dirFd;
+    std::string current;
+    std::unordered_map<std::string, CacheEntry> cache;  // 字面规范化的绝对路径 -> 规范化路径
+    uint64_t useCounter = 0;
+
+    /**
+     * 接管新打开的目录 fd：确认是目录，确定它的规范化路径
+     * @param lexical 字面规范化的绝对路径（缓存的键）
+     */
+    int adopt(UniqueFd fd, const std::string& lexical);
+
+    void remember(const std::string& lexical, const std::string& canonical, dev_t dev, ino_t ino);
+};
+
+#endif // WORKINGDIRECTORY_H
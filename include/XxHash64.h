@@ -0,0 +1,42 @@
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * XxHash64 - 64 位非加密哈希（与 xxHash 的 XXH64 算法及结果相同）
+ *
+ * 每次处理 32 字节（4 路并行累加），在普通 CPU 上可以达到每秒数 GB，
+ * 远快于读盘速度，适合比较文件内容（dedup）。不能防止刻意构造的碰撞。
+ *
+ * 用法:
+ *   uint64_t h = XxHash64::hash(data, length);
+ *
+ *   XxHash64 hasher;               // 分块计算，结果与一次性计算相同
+ *   hasher.update(block1, n1);
+ *   hasher.update(block2, n2);
+ *   uint64_t h = hasher.digest();
+ */
+class XxHash64 {
+public:
+    explicit XxHash64(uint64_t seed = 0);
+
+    void update(const void* data, size_t length);
+
+    /**
+     * 目前为止所有数据的哈希值（不改变状态，之后仍可继续 update）
+     */
+    uint64_t digest() const;
+
+    static uint64_t hash(const void* data, size_t length, uint64_t seed = 0);
+
+private:
+    uint64_t seed;
+    uint64_t acc[4];
+    uint64_t totalLength = 0;
+    unsigned char pending[32];   // 不足 32 字节的尾部
+    size_t pendingSize = 0;
+};
+
+#endif // XXHASH64_H
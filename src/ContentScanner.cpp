@@ -0,0 +1,300 @@
+#include "../include/ContentScanner.h"
+#include "../include/FileUtils.h"
+#include "../include/JobControl.h"
+#include "../include/Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 管道等按块读取时的初始缓冲区大小（一行比它长时按需扩大）
+const size_t kStreamBufferSize = 256 * 1024;
+
+size_t countNewlines(const char* data, size_t size) {
+    size_t count = 0;
+    const char* end = data + size;
+    while (data < end) {
+        const void* found = std::memchr(data, '\n', static_cast<size_t>(end - data));
+        if (found == nullptr) {
+            break;
+        }
+        count++;
+        data = static_cast<const char*>(found) + 1;
+    }
+    return count;
+}
+
+// 当前线程正在扫描的映射区域，SIGBUS 的地址落在 [begin, end) 中时跳回 jump
+struct MappedGuard {
+    sigjmp_buf jump;
+    const char* begin;
+    const char* end;
+};
+
+thread_local MappedGuard* activeGuard = nullptr;
+
+void onSigbus(int sig, siginfo_t* info, void*) {
+    MappedGuard* guard = activeGuard;
+    const char* address = static_cast<const char*>(info->si_addr);
+    if (guard != nullptr && address >= guard->begin && address < guard->end) {
+        activeGuard = nullptr;
+        siglongjmp(guard->jump, 1);
+    }
+    // 与扫描无关的 SIGBUS：恢复默认处理，返回后重新执行出错的指令时终止进程
+    signal(sig, SIG_DFL);
+}
+
+void installSigbusHandler() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = onSigbus;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGBUS, &action, nullptr);
+    });
+}
+
+} // namespace
+
+ContentScanner::ContentScanner(const NameMatcher& matcher, JobControl* control, Flush flush)
+    : matcher(matcher), control(control), flush(std::move(flush)), pendingLine(std::string::npos) {}
+
+ContentScanner::Status ContentScanner::scanAt(int dirFd, const char* name, std::string_view path) {
+    Stats::add(Stats::OpenCalls);
+    UniqueFd fd(openat(dirFd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY));
+    if (!fd) {
+        return Status::Failed;
+    }
+    return scanFd(fd.get(), path);
+}
+
+ContentScanner::Status ContentScanner::scanFd(int fd, std::string_view path) {
+    this->path = path;
+    lineNumber = 1;
+    fileMatched = false;
+
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstat(fd, &st) != 0) {
+        return Status::Failed;
+    }
+
+    Status status = Status::Scanned;
+    size_t size = static_cast<size_t>(st.st_size);
+    if (!S_ISREG(st.st_mode)) {
+        status = scanStream(fd);
+    } else if (size > kReadLimit) {
+        status = scanMapped(fd, size);
+    } else if (size > 0) {
+        // 小文件：一次 read 读完，文件在此期间变短时以实际读到的为准
+        buffer.resize(std::max(buffer.size(), size));
+        size_t used = 0;
+        while (used < size) {
+            ssize_t n = read(fd, buffer.data() + used, size - used);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return Status::Failed;
+            }
+            if (n == 0) {
+                break;
+            }
+            used += static_cast<size_t>(n);
+        }
+        if (looksBinary(buffer.data(), used)) {
+            return Status::Binary;
+        }
+        scanLines(buffer.data(), used);
+        bytes += used;
+        Stats::add(Stats::Bytes, used);
+        if (control != nullptr) {
+            control->addBytes(used);
+        }
+    }
+
+    if (fileMatched) {
+        files++;
+    }
+    return status;
+}
+
+ContentScanner::Status ContentScanner::scanMapped(int fd, size_t size) {
+    MappedFile mapped;
+    if (!mapped.open(fd)) {
+        return Status::Failed;
+    }
+    // 文件在 fstat 之后被截断时以映射的长度为准；length 在 sigsetjmp 之后不再修改，跳回时的值确定
+    const size_t length = std::min(size, mapped.size());
+    const char* data = mapped.data();
+
+    // 扫描期间文件被截断：已经输出的结果保留，去掉写了一半的行，按扫描完成处理
+    installSigbusHandler();
+    MappedGuard guard;
+    guard.begin = data;
+    guard.end = data + mapped.size();
+    if (sigsetjmp(guard.jump, 1) != 0) {
+        if (pendingLine != std::string::npos) {
+            out.resize(pendingLine);
+            pendingLine = std::string::npos;
+        }
+        return Status::Scanned;
+    }
+    activeGuard = &guard;
+    if (looksBinary(data, length)) {
+        activeGuard = nullptr;
+        return Status::Binary;
+    }
+    scanWindows(data, length);
+    activeGuard = nullptr;
+    return Status::Scanned;
+}
+
+void ContentScanner::scanWindows(const char* data, size_t size) {
+    madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+
+    // 按窗口扫描，每个窗口延伸到下一个换行符为止，不会把一行拆到两个窗口；
+    // 扫描完的页立即解除映射关系（页缓存仍然保留），常驻内存不超过一个窗口
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t pos = 0;
+    size_t dropped = 0;
+    while (pos < size) {
+        if (control != nullptr && control->isCancelled()) {
+            break;
+        }
+        size_t end = std::min(pos + kWindowSize, size);
+        if (end < size) {
+            const void* newline = std::memchr(data + end, '\n', size - end);
+            end = newline != nullptr ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+        }
+        scanLines(data + pos, end - pos);
+        bytes += end - pos;
+        Stats::add(Stats::Bytes, end - pos);
+        if (control != nullptr) {
+            control->addBytes(end - pos);
+        }
+        pos = end;
+
+        size_t aligned = pos / pageSize * pageSize;
+        if (aligned > dropped) {
+            madvise(const_cast<char*>(data) + dropped, aligned - dropped, MADV_DONTNEED);
+            dropped = aligned;
+        }
+    }
+}
+
+ContentScanner::Status ContentScanner::scanStream(int fd) {
+    buffer.resize(std::max(buffer.size(), kStreamBufferSize));
+    size_t carry = 0;   // 缓冲区开头尚未结束的一行
+    bool first = true;
+
+    while (true) {
+        if (control != nullptr && control->isCancelled()) {
+            break;
+        }
+        if (carry == buffer.size()) {
+            if (carry >= kMaxLineLength) {
+                // 过长的行：把已有的部分当作一段处理后丢弃，不再继续扩大缓冲区
+                scanLines(buffer.data(), carry);
+                carry = 0;
+            } else {
+                buffer.resize(std::min(buffer.size() * 2, kMaxLineLength));
+            }
+        }
+        ssize_t n = read(fd, buffer.data() + carry, buffer.size() - carry);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return Status::Failed;
+        }
+        if (n == 0) {
+            // 最后一行没有换行符
+            scanLines(buffer.data(), carry);
+            break;
+        }
+        size_t total = carry + static_cast<size_t>(n);
+        bytes += static_cast<size_t>(n);
+        Stats::add(Stats::Bytes, static_cast<size_t>(n));
+        if (control != nullptr) {
+            control->addBytes(static_cast<size_t>(n));
+        }
+        if (first) {
+            first = false;
+            if (looksBinary(buffer.data(), total)) {
+                return Status::Binary;
+            }
+        }
+
+        const void* newline = memrchr(buffer.data(), '\n', total);
+        if (newline == nullptr) {
+            carry = total;
+            continue;
+        }
+        size_t complete = static_cast<size_t>(static_cast<const char*>(newline) - buffer.data()) + 1;
+        scanLines(buffer.data(), complete);
+        carry = total - complete;
+        std::memmove(buffer.data(), buffer.data() + complete, carry);
+    }
+    return Status::Scanned;
+}
+
+void ContentScanner::scanLines(const char* data, size_t size) {
+    size_t pos = 0;      // 下一行的开头
+    size_t counted = 0;  // lineNumber 对应的位置
+    while (pos < size) {
+        // 在剩下的整块数据中查找，而不是逐行查找
+        size_t hit = matcher.find(data + pos, size - pos);
+        if (hit == NameMatcher::npos) {
+            break;
+        }
+        size_t at = pos + hit;
+        const void* previous = memrchr(data + pos, '\n', at - pos);
+        size_t lineStart = previous != nullptr ? static_cast<size_t>(static_cast<const char*>(previous) - data) + 1 : pos;
+        const void* next = std::memchr(data + at, '\n', size - at);
+        size_t lineEnd = next != nullptr ? static_cast<size_t>(static_cast<const char*>(next) - data) : size;
+
+        // 行号只在命中时才补数
+        lineNumber += countNewlines(data + counted, lineStart - counted);
+        counted = lineStart;
+
+        char digits[24];
+        char* digitsEnd = std::to_chars(digits, digits + sizeof(digits), lineNumber).ptr;
+        // 先预留空间：从映射区复制时遇到 SIGBUS 不会留下重新分配到一半的缓冲区
+        pendingLine = out.size();
+        size_t needed = out.size() + path.size() + static_cast<size_t>(digitsEnd - digits) + (lineEnd - lineStart) + 3;
+        if (out.capacity() < needed) {
+            out.reserve(std::max(needed, out.capacity() * 2));
+        }
+        out.append(path);
+        out.push_back(':');
+        out.append(digits, static_cast<size_t>(digitsEnd - digits));
+        out.push_back(':');
+        out.append(data + lineStart, lineEnd - lineStart);
+        out.push_back('\n');
+        pendingLine = std::string::npos;
+        lines++;
+        fileMatched = true;
+        if (out.size() >= kFlushSize) {
+            flush(out);
+        }
+
+        pos = lineEnd + 1;
+    }
+    lineNumber += countNewlines(data + counted, size - counted);
+}
+
+bool ContentScanner::looksBinary(const char* data, size_t size) {
+    return std::memchr(data, '\0', std::min(size, kBinaryProbe)) != nullptr;
+}
@@ -0,0 +1,220 @@
+#include "../include/CopyEngine.h"
+#include "../include/FileUtils.h"
+#include "../include/Stats.h"
+#include <cerrno>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>      // FICLONE
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+
+// 每次系统调用最多复制的字节数（copy_file_range / sendfile 单次上限约 2 GiB）
+const size_t kChunkSize = 1u << 30;
+
+// read/write 循环使用的缓冲区大小
+const size_t kBufferSize = 1u << 20;
+
+// 这些错误表示"这种方式在这里不可用"，应该换下一种方式，而不是复制失败
+bool unsupported(int error) {
+    return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP ||
+           error == ENOTSUP || error == EBADF || error == ETXTBSY || error == EPERM;
+}
+
+// 尝试用某种内核复制方式复制到末尾。
+// 返回 1 表示已复制完成，0 表示该方式不可用（且尚未复制任何数据），-1 表示出错
+template <typename Step>
+int copyWith(Step step, CopyResult& result) {
+    bool started = false;
+    while (true) {
+        ssize_t n = step(kChunkSize);
+        if (n > 0) {
+            result.bytes += static_cast<uint64_t>(n);
+            started = true;
+            continue;
+        }
+        if (n == 0) {
+            return 1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (!started && unsupported(errno)) {
+            return 0;
+        }
+        result.error = errno;
+        return -1;
+    }
+}
+
+} // namespace
+
+const char* copyTierName(CopyTier tier) {
+    switch (tier) {
+        case CopyTier::Reflink: return "reflink";
+        case CopyTier::CopyFileRange: return "copy_file_range";
+        case CopyTier::Sendfile: return "sendfile";
+        case CopyTier::ReadWrite: return "read/write";
+        default: return "none";
+    }
+}
+
+namespace {
+
+CopyResult copyWithBestTier(int inFd, int outFd) {
+    CopyResult result;
+
+#ifdef __linux__
+    // ========== 第 1 级：reflink ==========
+    // 只在目标为空、从头复制时使用（FICLONE 复制的是整个文件）
+    if (lseek(inFd, 0, SEEK_CUR) == 0 && lseek(outFd, 0, SEEK_CUR) == 0) {
+        struct stat st;
+        if (ioctl(outFd, FICLONE, inFd) == 0 && fstat(inFd, &st) == 0) {
+            result.ok = true;
+            result.tier = CopyTier::Reflink;
+            result.bytes = static_cast<uint64_t>(st.st_size);
+            return result;
+        }
+    }
+
+    // ========== 第 2 级：copy_file_range ==========
+    result.tier = CopyTier::CopyFileRange;
+    int status = copyWith([&](size_t chunk) {
+        return copy_file_range(inFd, nullptr, outFd, nullptr, chunk, 0);
+    }, result);
+
+    // ========== 第 3 级：sendfile ==========
+    if (status == 0) {
+        result.tier = CopyTier::Sendfile;
+        status = copyWith([&](size_t chunk) {
+            return sendfile(outFd, inFd, nullptr, chunk);
+        }, result);
+    }
+
+    if (status != 0) {
+        result.ok = status > 0;
+        if (result.ok && result.bytes == 0) {
+            result.tier = CopyTier::None;
+        }
+        return result;
+    }
+#endif
+
+    // ========== 第 4 级：read/write 循环 ==========
+    result.tier = CopyTier::ReadWrite;
+    off_t start = lseek(inFd, 0, SEEK_CUR);
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(inFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+    uint64_t sinceAdvice = 0;
+    while (true) {
+        ssize_t n = read(inFd, buffer.get(), kBufferSize);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result.error = errno;
+            return result;
+        }
+        if (n == 0) {
+            break;
+        }
+        char* p = buffer.get();
+        ssize_t left = n;
+        while (left > 0) {
+            ssize_t written = write(outFd, p, static_cast<size_t>(left));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                result.error = errno;
+                return result;
+            }
+            p += written;
+            left -= written;
+        }
+        result.bytes += static_cast<uint64_t>(n);
+
+#ifdef POSIX_FADV_DONTNEED
+        // 每复制 64 MiB 就告诉内核源文件已读部分不再需要，避免大文件占满页缓存
+        sinceAdvice += static_cast<uint64_t>(n);
+        if (sinceAdvice >= (64u << 20)) {
+            posix_fadvise(inFd, start, static_cast<off_t>(result.bytes), POSIX_FADV_DONTNEED);
+            sinceAdvice = 0;
+        }
+#endif
+    }
+    (void)start;
+    (void)sinceAdvice;
+
+    result.ok = true;
+    if (result.bytes == 0) {
+        result.tier = CopyTier::None;
+    }
+    return result;
+}
+
+} // namespace
+
+CopyResult copyFileData(int inFd, int outFd) {
+    CopyResult result = copyWithBestTier(inFd, outFd);
+    Stats::add(Stats::Bytes, result.bytes);
+    return result;
+}
+
+int reflinkFile(int inFd, int outFd) {
+#ifdef __linux__
+    return ioctl(outFd, FICLONE, inFd) == 0 ? 0 : errno;
+#else
+    (void)inFd;
+    (void)outFd;
+    return EOPNOTSUPP;
+#endif
+}
+
+CopyResult copyFileAt(int srcDirFd, const char* srcName, int dstDirFd, const char* dstName,
+                      bool preserveTimes) {
+    CopyResult result;
+
+    Stats::add(Stats::OpenCalls, 2);
+    UniqueFd in(openat(srcDirFd, srcName, O_RDONLY | O_CLOEXEC));
+    if (!in) {
+        result.error = errno;
+        return result;
+    }
+    struct stat st;
+    if (fstat(in.get(), &st) != 0) {
+        result.error = errno;
+        return result;
+    }
+
+    UniqueFd out(openat(dstDirFd, dstName, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777));
+    if (!out) {
+        result.error = errno;
+        return result;
+    }
+
+    result = copyFileData(in.get(), out.get());
+    if (result.ok) {
+        // 创建时的权限受 umask 影响，这里显式设置成与源文件一致
+        fchmod(out.get(), st.st_mode & 07777);
+        if (preserveTimes) {
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+            futimens(out.get(), times);
+        }
+    }
+    out.reset();
+
+    if (!result.ok) {
+        // 不留下不完整的文件
+        unlinkat(dstDirFd, dstName, 0);
+    }
+    return result;
+}
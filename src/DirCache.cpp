@@ -0,0 +1,225 @@
+#include "../include/DirCache.h"
+#include "../include/FileUtils.h"
+#include "../include/Stats.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// 目录内容或条目属性发生变化、目录本身被删除/移走时都要失效
+const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB |
+                            IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+bool sameTime(const struct timespec& a, const struct timespec& b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+} // namespace
+
+DirCache::DirCache(size_t memoryLimit) : memoryLimit(memoryLimit) {}
+
+DirCache::~DirCache() {
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+}
+
+size_t DirCache::memoryUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+void DirCache::drainEvents() {
+#ifdef __linux__
+    if (inotifyFd < 0 || watchToDir.empty()) {
+        return;
+    }
+    alignas(struct inotify_event) char buffer[16384];
+    while (true) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // EAGAIN：没有更多事件
+            return;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 丢失了事件，无法知道哪些目录变了
+                clear();
+                continue;
+            }
+            auto it = watchToDir.find(event->wd);
+            if (it != watchToDir.end()) {
+                std::string dir = it->second;
+                erase(dir);
+            }
+        }
+    }
+#endif
+}
+
+bool DirCache::stillValid(const std::string& dir, Slot& slot) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || st.st_dev != slot.dev || st.st_ino != slot.ino) {
+        return false;
+    }
+    if (slot.watch >= 0) {
+        // 有 inotify watch：没有收到事件就说明没有变化
+        return true;
+    }
+    return !slot.racy && sameTime(st.st_mtim, slot.mtime) && sameTime(st.st_ctim, slot.ctime);
+}
+
+void DirCache::erase(const std::string& dir) {
+    auto it = slots.find(dir);
+    if (it == slots.end()) {
+        return;
+    }
+    Slot& slot = it->second;
+#ifdef __linux__
+    if (slot.watch >= 0) {
+        watchToDir.erase(slot.watch);
+        inotify_rm_watch(inotifyFd, slot.watch);
+    }
+#endif
+    used -= slot.bytes;
+    lru.erase(slot.lruPosition);
+    slots.erase(it);
+}
+
+void DirCache::clear() {
+    while (!lru.empty()) {
+        std::string dir = lru.back();
+        erase(dir);
+    }
+}
+
+void DirCache::evict() {
+    while (used > memoryLimit && !lru.empty()) {
+        std::string dir = lru.back();
+        erase(dir);
+    }
+}
+
+std::shared_ptr<const EntryTable> DirCache::find(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex);
+    drainEvents();
+
+    auto it = slots.find(dir);
+    if (it == slots.end()) {
+        return nullptr;
+    }
+    if (!stillValid(dir, it->second)) {
+        erase(dir);
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second.lruPosition);
+    return it->second.listing;
+}
+
+std::shared_ptr<const EntryTable> DirCache::get(const std::string& dir, int& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    drainEvents();
+
+    auto it = slots.find(dir);
+    if (it != slots.end()) {
+        if (stillValid(dir, it->second)) {
+            lru.splice(lru.begin(), lru, it->second.lruPosition);
+            return it->second.listing;
+        }
+        erase(dir);
+    }
+
+    // ========== 读取目录 ==========
+    // 先添加 watch 再读取，读取过程中发生的修改也会产生事件
+    int watch = -1;
+#ifdef __linux__
+    // inotify 实例在第一次缓存目录时才创建：后台任务等从不 ls 的实例不占用 inotify 实例（每个用户有上限）
+    if (!inotifyTried) {
+        inotifyTried = true;
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+    if (inotifyFd >= 0) {
+        watch = inotify_add_watch(inotifyFd, dir.c_str(), kWatchMask);
+        if (watch >= 0 && watchToDir.count(watch) > 0) {
+            // 同一个目录已经以另一个路径被监视（比如经过符号链接）：这个路径改用 mtime 校验
+            watch = -1;
+        }
+    }
+#endif
+    struct timespec buildTime;
+    clock_gettime(CLOCK_REALTIME, &buildTime);
+
+    Stats::add(Stats::OpenCalls);
+    UniqueFd dirFd(open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    struct stat dirStat;
+    if (!dirFd || fstat(dirFd.get(), &dirStat) != 0) {
+        error = errno;
+#ifdef __linux__
+        if (watch >= 0) {
+            inotify_rm_watch(inotifyFd, watch);
+        }
+#endif
+        return nullptr;
+    }
+
+    auto listing = std::make_shared<EntryTable>();
+    std::vector<char> buffer(DirReader::kBufferSize);
+    DirReader reader(dirFd.get(), buffer.data(), buffer.size());
+    DirEntryView view;
+    EntryTable::Row row;
+    while (reader.next(view)) {
+        EntryTable::statAt(dirFd.get(), view.name, row);
+        listing->append(std::string_view(view.name, view.nameLength), row);
+    }
+    if (reader.error() != 0) {
+        error = reader.error();
+#ifdef __linux__
+        if (watch >= 0) {
+            inotify_rm_watch(inotifyFd, watch);
+        }
+#endif
+        return nullptr;
+    }
+    listing->shrinkToFit();
+    size_t bytes = sizeof(Slot) + dir.size() * 2 + listing->memoryBytes();
+
+    // 单个目录就超过上限：不缓存
+    if (bytes > memoryLimit) {
+#ifdef __linux__
+        if (watch >= 0) {
+            inotify_rm_watch(inotifyFd, watch);
+        }
+#endif
+        return listing;
+    }
+
+    lru.push_front(dir);
+    Slot& slot = slots[dir];
+    slot.listing = listing;
+    slot.lruPosition = lru.begin();
+    slot.dev = dirStat.st_dev;
+    slot.ino = dirStat.st_ino;
+    slot.mtime = dirStat.st_mtim;
+    slot.ctime = dirStat.st_ctim;
+    slot.watch = watch;
+    // 时间戳有粒度：mtime 和构建时刻在同一秒内时，之后的修改可能不改变 mtime
+    slot.racy = dirStat.st_mtim.tv_sec >= buildTime.tv_sec - 1 || dirStat.st_ctim.tv_sec >= buildTime.tv_sec - 1;
+    slot.bytes = bytes;
+    if (watch >= 0) {
+        watchToDir[watch] = dir;
+    }
+    used += bytes;
+    evict();
+    return listing;
+}
+
@@ -0,0 +1,690 @@
+#include "../include/DuCache.h"
+#include "../include/FileUtils.h"
+#include "../include/JobControl.h"
+#include "../include/ParallelFor.h"
+#include "../include/Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'M', 'F', 'E', 'D', 'U', 'C', '1', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kNone = 0xFFFFFFFFu;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t builtAt;
+    uint64_t rootOffset;
+    uint64_t rootLength;
+    uint64_t dirCount;
+    uint64_t linkCount;
+    uint64_t stringBytes;
+    uint64_t dirsOffset;
+    uint64_t linksOffset;
+    uint64_t stringsOffset;
+};
+
+struct DirRecord {
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t parent;       // 父目录编号，根目录为 kNone
+    uint32_t firstChild;   // 第一个子目录的编号（子目录连续存放）
+    uint32_t childCount;
+    uint64_t firstLink;    // 本目录负责统计的第一个多链接文件
+    uint32_t linkCount;
+    uint32_t reserved;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtimeSec;      // 目录 mtime，-1 表示下次总是重新读取
+    int64_t mtimeNsec;
+    uint64_t ownBytes;     // 直接文件（非目录条目）的总大小
+    uint64_t ownFiles;     // 直接文件数
+};
+
+struct LinkRecord {
+    uint64_t dev;
+    uint64_t ino;
+};
+
+struct LinkKey {
+    uint64_t dev;
+    uint64_t ino;
+    bool operator==(const LinkKey& other) const { return dev == other.dev && ino == other.ino; }
+};
+
+struct LinkKeyHash {
+    size_t operator()(const LinkKey& key) const {
+        return std::hash<uint64_t>()(key.ino * 0x9E3779B97F4A7C15ULL ^ key.dev);
+    }
+};
+
+void alignTo8(std::string& buffer) {
+    buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7), '\0');
+}
+
+template <typename T>
+void appendArray(std::string& buffer, const std::vector<T>& items) {
+    alignTo8(buffer);
+    buffer.append(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+}
+
+// 已打开的缓存文件中各段的指针
+struct CacheView {
+    const CacheHeader* header = nullptr;
+    const DirRecord* dirs = nullptr;
+    const LinkRecord* links = nullptr;
+    const char* strings = nullptr;
+
+    bool load(const char* data, size_t size) {
+        if (data == nullptr || size < sizeof(CacheHeader)) {
+            return false;
+        }
+        header = reinterpret_cast<const CacheHeader*>(data);
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+            header->version != kVersion || header->headerSize != sizeof(CacheHeader)) {
+            return false;
+        }
+        auto fits = [size](uint64_t offset, uint64_t count, uint64_t itemSize) {
+            return offset <= size && count <= (size - offset) / itemSize;
+        };
+        if (!fits(header->dirsOffset, header->dirCount, sizeof(DirRecord)) ||
+            !fits(header->linksOffset, header->linkCount, sizeof(LinkRecord)) ||
+            !fits(header->stringsOffset, header->stringBytes, 1) ||
+            header->rootOffset + header->rootLength > header->stringBytes ||
+            header->dirCount == 0 || header->dirCount >= kNone) {
+            return false;
+        }
+        dirs = reinterpret_cast<const DirRecord*>(data + header->dirsOffset);
+        links = reinterpret_cast<const LinkRecord*>(data + header->linksOffset);
+        strings = data + header->stringsOffset;
+
+        // 增量更新会按记录中的编号和范围访问，先全部检查一遍
+        for (uint64_t i = 0; i < header->dirCount; i++) {
+            const DirRecord& d = dirs[i];
+            if (d.nameOffset + d.nameLength > header->stringBytes ||
+                static_cast<uint64_t>(d.firstChild) + d.childCount > header->dirCount ||
+                (d.childCount > 0 && d.firstChild <= i) ||
+                d.firstLink + d.linkCount > header->linkCount) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view root() const {
+        return std::string_view(strings + header->rootOffset, header->rootLength);
+    }
+
+    std::string_view name(const DirRecord& d) const {
+        return std::string_view(strings + d.nameOffset, d.nameLength);
+    }
+};
+
+// 构建过程中的一个目录
+struct Node {
+    std::string name;
+    uint32_t parent = kNone;
+    uint32_t firstChild = 0;
+    uint32_t childCount = 0;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    int64_t mtimeSec = -1;
+    int64_t mtimeNsec = 0;
+    uint64_t ownBytes = 0;
+    uint64_t ownFiles = 0;
+    uint32_t old = kNone;  // 对应的旧记录编号（增量更新时）
+};
+
+// 由某个目录负责统计的多链接文件
+struct OwnedLink {
+    LinkKey key;
+    uint32_t owner;
+};
+
+// 重新读取的目录中的多链接文件，全部目录检查完后再决定由谁统计
+struct PendingLink {
+    LinkKey key;
+    uint64_t size;
+    uint32_t owner;
+};
+
+// 增量更新时找到的一个子目录
+struct ChildDir {
+    std::string name;
+    struct stat st;
+    ptrdiff_t oldId;  // 对应的旧记录编号，没有时为 -1
+};
+
+// 增量更新时一个目录的检查结果，由工作线程填写
+struct DirScan {
+    bool entered = false;     // -x 时其他文件系统的挂载点不进入
+    bool reused = false;      // mtime 未变，复用缓存中的合计
+    bool opened = false;      // 重新读取时成功打开，mtime 有效
+    bool incomplete = false;  // 有条目或子目录无法读取
+    int64_t mtimeSec = 0;
+    int64_t mtimeNsec = 0;
+    uint64_t ownBytes = 0;
+    uint64_t ownFiles = 0;
+    uint64_t entries = 0;
+    uint64_t errors = 0;
+    std::vector<ChildDir> children;
+    std::vector<PendingLink> pending;
+};
+
+Node makeNode(std::string_view name, uint32_t parent, const struct stat& st) {
+    Node node;
+    node.name.assign(name);
+    node.parent = parent;
+    node.dev = static_cast<uint64_t>(st.st_dev);
+    node.ino = static_cast<uint64_t>(st.st_ino);
+    node.mtimeSec = static_cast<int64_t>(st.st_mtim.tv_sec);
+    node.mtimeNsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+    return node;
+}
+
+class DuBuilder {
+public:
+    DuBuilder(const std::string& root, const WalkOptions& options, DuCache::Result& result)
+        : root(root), options(options), result(result) {}
+
+    // ========== 没有缓存：并行完整遍历 ==========
+    bool scanFull() {
+        result.fromScratch = true;
+        struct stat rootStat;
+        Stats::add(Stats::StatCalls);
+        if (stat(root.c_str(), &rootStat) != 0) {
+            result.error = std::strerror(errno);
+            return false;
+        }
+        nodes.push_back(makeNode(std::string_view(), kNone, rootStat));
+
+        // 每个目录分配一个编号（tag），文件按 tag 累加到各线程自己的数组中
+        WalkOptions walkOptions = options;
+        walkOptions.statEntries = true;
+        struct alignas(64) WorkerTotals {
+            std::vector<uint64_t> bytes;
+            std::vector<uint64_t> files;
+            std::vector<OwnedLink> links;
+        };
+        std::mutex nodesMutex;
+        // 未能完整读取的目录（tag 即目录编号），它们的合计不完整，不能写入有效的 mtime
+        std::vector<uint32_t> incomplete;
+        walkOptions.dirError = [&](uint64_t tag, int) {
+            std::lock_guard<std::mutex> lock(nodesMutex);
+            incomplete.push_back(static_cast<uint32_t>(tag));
+        };
+        TreeWalker walker(walkOptions);
+        std::vector<WorkerTotals> totals(walker.threadCount());
+
+        WalkStats stats = walker.walk(AT_FDCWD, root, [&](WalkEntry& entry) {
+            const struct stat* st = entry.stat();
+            if (entry.isDir) {
+                std::lock_guard<std::mutex> lock(nodesMutex);
+                uint64_t id = nodes.size();
+                nodes.push_back(makeNode(entry.name, static_cast<uint32_t>(entry.tag), *st));
+                entry.tag = id;
+                return true;
+            }
+            if (!entry.firstLink) {
+                return true;
+            }
+            WorkerTotals& mine = totals[entry.worker];
+            if (mine.bytes.size() <= entry.tag) {
+                mine.bytes.resize(entry.tag + 1, 0);
+                mine.files.resize(entry.tag + 1, 0);
+            }
+            mine.bytes[entry.tag] += static_cast<uint64_t>(st->st_size);
+            mine.files[entry.tag]++;
+            if (st->st_nlink > 1) {
+                mine.links.push_back({{static_cast<uint64_t>(st->st_dev), static_cast<uint64_t>(st->st_ino)},
+                                      static_cast<uint32_t>(entry.tag)});
+            }
+            return true;
+        });
+
+        if (!stats.rootOk) {
+            result.error = std::strerror(stats.rootErrno);
+            return false;
+        }
+        result.cancelled = stats.cancelled;
+        result.entries = stats.files + stats.dirs;
+        result.errors = stats.errors;
+        result.threads = walker.threadCount();
+        result.rescanned = nodes.size();
+        if (nodes.size() >= kNone) {
+            result.error = "too many directories";
+            return false;
+        }
+
+        for (uint32_t id : incomplete) {
+            markIncomplete(id);
+        }
+        for (auto& mine : totals) {
+            for (size_t tag = 0; tag < mine.bytes.size(); tag++) {
+                nodes[tag].ownBytes += mine.bytes[tag];
+                nodes[tag].ownFiles += mine.files[tag];
+            }
+            links.insert(links.end(), mine.links.begin(), mine.links.end());
+        }
+        layoutBreadthFirst();
+        return true;
+    }
+
+    // ========== 有缓存：只重新读取变化的目录 ==========
+    bool scanIncremental(const CacheView& old) {
+        UniqueFd rootFd(::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        Stats::add(Stats::OpenCalls);
+        struct stat rootStat;
+        if (!rootFd || fstat(rootFd.get(), &rootStat) != 0) {
+            result.error = std::strerror(errno);
+            return false;
+        }
+        nodes.push_back(makeNode(std::string_view(), kNone, rootStat));
+        if (sameDir(old.dirs[0], nodes[0])) {
+            nodes[0].old = 0;
+        }
+        std::vector<std::string> paths{"."};
+
+        std::unordered_set<LinkKey, LinkKeyHash> reusedLinks;
+        std::vector<PendingLink> pending;
+        std::vector<bool> reusedOld(old.header->dirCount, false);
+        std::vector<std::vector<char>> buffers(options.threads != 0 ? options.threads : kParallelMaxThreads);
+        JobControl* control = options.control;
+
+        // nodes 本身就是广度优先的待处理队列：同一层的目录由 parallelFor 并行检查（各自写入 DirScan），
+        // 再按顺序合并，子目录连续追加到 nodes 末尾，成为下一层
+        for (size_t begin = 0; begin < nodes.size();) {
+            size_t end = nodes.size();
+            std::vector<DirScan> scans(end - begin);
+            unsigned used = parallelFor(scans.size(), options.threads, [&](unsigned worker, size_t k) {
+                if (control != nullptr && control->isCancelled()) {
+                    return;
+                }
+                std::vector<char>& buffer = buffers[worker];
+                if (buffer.empty()) {
+                    buffer.resize(DirReader::kBufferSize);
+                }
+                scanDir(static_cast<uint32_t>(begin + k), rootFd.get(), old, paths[begin + k], buffer, scans[k]);
+            });
+            result.threads = std::max(result.threads, used);
+            if (control != nullptr && control->isCancelled()) {
+                result.cancelled = true;
+                return true;
+            }
+            for (size_t k = 0; k < scans.size(); k++) {
+                merge(static_cast<uint32_t>(begin + k), scans[k], old, paths, reusedLinks, pending, reusedOld);
+                if (nodes.size() >= kNone) {
+                    result.error = "too many directories";
+                    return false;
+                }
+            }
+            begin = end;
+        }
+
+        // 重新读取的目录中的多链接文件：已由复用的目录统计过的跳过，其余的只统计一次
+        std::unordered_set<LinkKey, LinkKeyHash> counted;
+        for (const auto& link : pending) {
+            if (reusedLinks.count(link.key) > 0 || !counted.insert(link.key).second) {
+                continue;
+            }
+            nodes[link.owner].ownBytes += link.size;
+            nodes[link.owner].ownFiles++;
+            links.push_back({link.key, link.owner});
+        }
+
+        // 没有复用的旧目录原来负责统计的多链接文件，这次没有被统计：它的其他名称可能在某个复用的目录中
+        // （缓存只记录每个目录负责统计的多链接文件），无法确定时改为完整遍历
+        for (uint64_t i = 0; i < old.header->dirCount; i++) {
+            if (reusedOld[i]) {
+                continue;
+            }
+            const DirRecord& od = old.dirs[i];
+            for (uint64_t l = 0; l < od.linkCount; l++) {
+                const LinkRecord& link = old.links[od.firstLink + l];
+                if (counted.count(LinkKey{link.dev, link.ino}) == 0) {
+                    nodes.clear();
+                    links.clear();
+                    result.reused = 0;
+                    return scanFull();
+                }
+            }
+        }
+        return true;
+    }
+
+    // 累加子树合计，填写结果
+    void summarize() {
+        std::vector<uint64_t> bytes(nodes.size());
+        std::vector<uint64_t> files(nodes.size());
+        for (size_t i = nodes.size(); i-- > 0;) {
+            bytes[i] += nodes[i].ownBytes;
+            files[i] += nodes[i].ownFiles;
+            if (nodes[i].parent != kNone) {
+                bytes[nodes[i].parent] += bytes[i];
+                files[nodes[i].parent] += files[i];
+            }
+        }
+        result.bytes = bytes[0];
+        result.files = files[0];
+        result.dirs = nodes.size() - 1;
+        for (uint32_t c = 0; c < nodes[0].childCount; c++) {
+            uint32_t child = nodes[0].firstChild + c;
+            result.subdirs.push_back({nodes[child].name, bytes[child], files[child]});
+        }
+    }
+
+    bool write(const std::string& file, int64_t scanStart) {
+        // 按所属目录排列多链接文件
+        std::stable_sort(links.begin(), links.end(),
+            [](const OwnedLink& a, const OwnedLink& b) { return a.owner < b.owner; });
+        std::vector<LinkRecord> linkRecords;
+        linkRecords.reserve(links.size());
+        for (const auto& link : links) {
+            linkRecords.push_back({link.key.dev, link.key.ino});
+        }
+
+        std::string strings;
+        std::vector<DirRecord> dirs(nodes.size());
+        size_t nextLink = 0;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const Node& n = nodes[i];
+            DirRecord& d = dirs[i];
+            std::memset(&d, 0, sizeof(d));
+            d.nameOffset = strings.size();
+            d.nameLength = static_cast<uint32_t>(n.name.size());
+            strings.append(n.name);
+            d.parent = n.parent;
+            d.firstChild = n.firstChild;
+            d.childCount = n.childCount;
+            d.firstLink = nextLink;
+            while (nextLink < links.size() && links[nextLink].owner == i) {
+                nextLink++;
+            }
+            d.linkCount = static_cast<uint32_t>(nextLink - d.firstLink);
+            d.dev = n.dev;
+            d.ino = n.ino;
+            // mtime 距本次开始不到 1 秒：同一个时间戳粒度内可能还有修改，下次不信任
+            d.mtimeSec = n.mtimeSec >= scanStart - 1 ? -1 : n.mtimeSec;
+            d.mtimeNsec = n.mtimeNsec;
+            d.ownBytes = n.ownBytes;
+            d.ownFiles = n.ownFiles;
+        }
+
+        CacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.headerSize = sizeof(CacheHeader);
+        header.builtAt = static_cast<int64_t>(std::time(nullptr));
+        header.rootOffset = strings.size();
+        header.rootLength = root.size();
+        strings.append(root);
+        header.dirCount = dirs.size();
+        header.linkCount = linkRecords.size();
+        header.stringBytes = strings.size();
+
+        std::string buffer(sizeof(CacheHeader), '\0');
+        alignTo8(buffer);
+        header.dirsOffset = buffer.size();
+        appendArray(buffer, dirs);
+        alignTo8(buffer);
+        header.linksOffset = buffer.size();
+        appendArray(buffer, linkRecords);
+        alignTo8(buffer);
+        header.stringsOffset = buffer.size();
+        buffer.append(strings);
+        std::memcpy(&buffer[0], &header, sizeof(header));
+
+        if (!writeFileAtomic(file, buffer.data(), buffer.size())) {
+            result.error = std::string("cannot write cache: ") + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& root;
+    const WalkOptions& options;
+    DuCache::Result& result;
+    std::vector<Node> nodes;
+    std::vector<OwnedLink> links;
+
+    // 目录的合计不完整：它和各级父目录都不记录有效的 mtime，下次整条路径都重新读取
+    void markIncomplete(uint32_t id) {
+        for (; id != kNone && nodes[id].mtimeSec != -1; id = nodes[id].parent) {
+            nodes[id].mtimeSec = -1;
+        }
+    }
+
+    static bool sameDir(const DirRecord& record, const Node& node) {
+        return record.dev == node.dev && record.ino == node.ino;
+    }
+
+    void addChild(std::string_view name, uint32_t parent, const struct stat& st, ptrdiff_t oldId,
+                  const CacheView& old, std::vector<std::string>& paths, std::string path) {
+        nodes.push_back(makeNode(name, parent, st));
+        if (oldId >= 0 && sameDir(old.dirs[oldId], nodes.back())) {
+            nodes.back().old = static_cast<uint32_t>(oldId);
+        }
+        paths.push_back(std::move(path));
+    }
+
+    // 检查一个目录，在 parallelFor 的线程中运行：只读 nodes 和旧缓存，结果写入 scan。
+    // 目录用相对根的路径打开一次，其中的条目都相对这个目录 fstatat，只解析一级名称
+    void scanDir(uint32_t id, int rootFd, const CacheView& old, const std::string& path, std::vector<char>& buffer,
+                 DirScan& scan) const {
+        const Node& node = nodes[id];
+        // -x：与 TreeWalker 一致，其他文件系统的挂载点本身计入目录数，但不进入
+        if (options.oneFileSystem && node.dev != nodes[0].dev) {
+            return;
+        }
+        scan.entered = true;
+        uint32_t oldId = node.old;
+        scan.reused = oldId != kNone && old.dirs[oldId].mtimeSec == node.mtimeSec &&
+                      old.dirs[oldId].mtimeNsec == node.mtimeNsec;
+        const DirRecord* od = oldId != kNone ? &old.dirs[oldId] : nullptr;
+        if (scan.reused && od->childCount == 0) {
+            return;
+        }
+
+        Stats::add(Stats::OpenCalls);
+        UniqueFd dirFd(openat(rootFd, path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        struct stat dirStat;
+        if (!dirFd || (!scan.reused && fstat(dirFd.get(), &dirStat) != 0)) {
+            scan.incomplete = true;
+            scan.errors++;
+            return;
+        }
+
+        if (scan.reused) {
+            // 目录没有变化：复用文件合计和子目录列表，每个子目录只 fstatat 一次
+            for (uint32_t c = 0; c < od->childCount; c++) {
+                uint32_t child = od->firstChild + c;
+                ChildDir dir{std::string(old.name(old.dirs[child])), {}, static_cast<ptrdiff_t>(child)};
+                Stats::add(Stats::StatCalls);
+                if (fstatat(dirFd.get(), dir.name.c_str(), &dir.st, AT_SYMLINK_NOFOLLOW) != 0 ||
+                    !S_ISDIR(dir.st.st_mode)) {
+                    // 父目录 mtime 未变但子目录不见了：只可能是检查期间被修改，下次重新读取父目录
+                    scan.incomplete = true;
+                    scan.errors++;
+                    continue;
+                }
+                scan.children.push_back(std::move(dir));
+            }
+            return;
+        }
+
+        // 目录有变化（或是新目录）：重新读取。使用读取之前的 mtime，读取期间的修改会让下次重新读取
+        scan.opened = true;
+        scan.mtimeSec = static_cast<int64_t>(dirStat.st_mtim.tv_sec);
+        scan.mtimeNsec = static_cast<int64_t>(dirStat.st_mtim.tv_nsec);
+
+        // 旧记录中的子目录，按名称找到后可以继续复用
+        std::unordered_map<std::string_view, uint32_t> oldChildren;
+        if (od != nullptr) {
+            for (uint32_t c = 0; c < od->childCount; c++) {
+                oldChildren.emplace(old.name(old.dirs[od->firstChild + c]), od->firstChild + c);
+            }
+        }
+
+        DirReader reader(dirFd.get(), buffer.data(), buffer.size());
+        DirEntryView entry;
+        uint64_t seen = 0;
+        while (reader.next(entry)) {
+            seen++;
+            struct stat st;
+            Stats::add(Stats::StatCalls);
+            if (fstatat(dirFd.get(), entry.name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                scan.incomplete = true;
+                scan.errors++;
+                continue;
+            }
+            std::string_view name(entry.name, entry.nameLength);
+            if (S_ISDIR(st.st_mode)) {
+                auto it = oldChildren.find(name);
+                scan.children.push_back(
+                    {std::string(name), st, it != oldChildren.end() ? static_cast<ptrdiff_t>(it->second) : -1});
+            } else if (st.st_nlink > 1) {
+                scan.pending.push_back({{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino)},
+                                        static_cast<uint64_t>(st.st_size), id});
+            } else {
+                scan.ownBytes += static_cast<uint64_t>(st.st_size);
+                scan.ownFiles++;
+            }
+        }
+        if (reader.error() != 0) {
+            scan.incomplete = true;
+            scan.errors++;
+        }
+        scan.entries = seen;
+        if (options.control != nullptr) {
+            options.control->addEntries(seen);
+        }
+    }
+
+    // 按目录顺序合并一个 DirScan：子目录追加到 nodes 末尾（同一目录的子目录连续）
+    void merge(uint32_t id, DirScan& scan, const CacheView& old, std::vector<std::string>& paths,
+               std::unordered_set<LinkKey, LinkKeyHash>& reusedLinks, std::vector<PendingLink>& pending,
+               std::vector<bool>& reusedOld) {
+        nodes[id].firstChild = static_cast<uint32_t>(nodes.size());
+        if (!scan.entered) {
+            return;
+        }
+        if (scan.reused) {
+            const DirRecord& od = old.dirs[nodes[id].old];
+            reusedOld[nodes[id].old] = true;
+            nodes[id].ownBytes = od.ownBytes;
+            nodes[id].ownFiles = od.ownFiles;
+            for (uint64_t l = 0; l < od.linkCount; l++) {
+                const LinkRecord& link = old.links[od.firstLink + l];
+                LinkKey key{link.dev, link.ino};
+                reusedLinks.insert(key);
+                links.push_back({key, id});
+            }
+            result.reused++;
+        } else {
+            if (scan.opened) {
+                nodes[id].mtimeSec = scan.mtimeSec;
+                nodes[id].mtimeNsec = scan.mtimeNsec;
+            }
+            nodes[id].ownBytes = scan.ownBytes;
+            nodes[id].ownFiles = scan.ownFiles;
+            pending.insert(pending.end(), scan.pending.begin(), scan.pending.end());
+            result.rescanned++;
+        }
+        for (const ChildDir& child : scan.children) {
+            addChild(child.name, id, child.st, child.oldId, old, paths, paths[id] + "/" + child.name);
+        }
+        nodes[id].childCount = static_cast<uint32_t>(nodes.size()) - nodes[id].firstChild;
+        result.entries += scan.entries;
+        result.errors += scan.errors;
+        if (scan.incomplete) {
+            markIncomplete(id);
+        }
+    }
+
+    // 把并行遍历得到的目录（编号按访问顺序）重新排列成广度优先顺序，使每个目录的子目录连续
+    void layoutBreadthFirst() {
+        std::vector<uint32_t> childStart(nodes.size() + 1, 0);
+        for (size_t i = 1; i < nodes.size(); i++) {
+            childStart[nodes[i].parent + 1]++;
+        }
+        for (size_t i = 0; i < nodes.size(); i++) {
+            childStart[i + 1] += childStart[i];
+        }
+        std::vector<uint32_t> children(nodes.size());
+        std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+        for (size_t i = 1; i < nodes.size(); i++) {
+            children[fill[nodes[i].parent]++] = static_cast<uint32_t>(i);
+        }
+
+        std::vector<uint32_t> order{0};
+        std::vector<uint32_t> newId(nodes.size(), 0);
+        for (size_t k = 0; k < order.size(); k++) {
+            uint32_t i = order[k];
+            for (uint32_t c = childStart[i]; c < childStart[i + 1]; c++) {
+                newId[children[c]] = static_cast<uint32_t>(order.size());
+                order.push_back(children[c]);
+            }
+        }
+
+        std::vector<Node> sorted;
+        sorted.reserve(nodes.size());
+        for (uint32_t i : order) {
+            Node node = std::move(nodes[i]);
+            node.parent = node.parent == kNone ? kNone : newId[node.parent];
+            node.childCount = childStart[i + 1] - childStart[i];
+            node.firstChild = node.childCount > 0 ? newId[children[childStart[i]]] : 0;
+            sorted.push_back(std::move(node));
+        }
+        nodes = std::move(sorted);
+        for (auto& link : links) {
+            link.owner = newId[link.owner];
+        }
+    }
+};
+
+} // namespace
+
+std::string DuCache::cacheFileFor(const std::string& root, bool oneFileSystem) {
+    return cacheFilePath("du", oneFileSystem ? root + "\n-x" : root);
+}
+
+DuCache::Result DuCache::update(const std::string& root, const WalkOptions& options) {
+    Result result;
+    std::string file = cacheFileFor(root, options.oneFileSystem);
+    if (file.empty()) {
+        result.error = "cannot determine cache directory";
+        return result;
+    }
+    int64_t scanStart = static_cast<int64_t>(std::time(nullptr));
+
+    // 已有同一目录的缓存时增量更新，否则完整遍历
+    MappedFile oldFile;
+    CacheView oldView;
+    bool usable = oldFile.open(file) && oldView.load(oldFile.data(), oldFile.size()) && oldView.root() == root;
+
+    DuBuilder builder(root, options, result);
+    bool scanned = usable ? builder.scanIncremental(oldView) : builder.scanFull();
+    if (!scanned || result.cancelled) {
+        return result;
+    }
+    builder.summarize();
+    if (!builder.write(file, scanStart)) {
+        return result;
+    }
+    result.ok = true;
+    return result;
+}
@@ -0,0 +1,470 @@
+#include "../include/DuplicateFinder.h"
+#include "../include/CopyEngine.h"
+#include "../include/FileUtils.h"
+#include "../include/JobControl.h"
+#include "../include/ParallelFor.h"
+#include "../include/Stats.h"
+#include "../include/TreeWalker.h"
+#include "../include/XxHash64.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 部分哈希读取的开头/结尾大小
+const size_t kPartialBlock = 4096;
+
+// 完整哈希和逐字节比较时每次读取的大小
+const size_t kReadChunk = 1 << 20;
+
+// 一个参与比较的文件
+struct FileRecord {
+    std::string path;        // 相对 baseFd 的路径（同一 inode 字典序最小的名称）
+    uint64_t size;
+    dev_t dev;
+    ino_t ino;
+    nlink_t nlink;           // 遍历时的链接数
+    std::vector<std::string> links;  // 同一 inode 在目录树中的其他名称
+    uint64_t hash = 0;       // 部分哈希，之后是完整哈希
+    bool complete = false;   // hash 是否已覆盖整个文件
+    bool failed = false;     // 读取失败或大小已变化
+};
+
+// 每个线程的读取缓冲区和计数，按缓存行对齐
+struct alignas(64) HashWorker {
+    std::vector<char> buffer;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+};
+
+bool cancelled(const DedupOptions& options) {
+    return options.control != nullptr && options.control->isCancelled();
+}
+
+// 从 offset 开始读满 length 字节（文件变短时返回实际读到的字节数），出错返回 -1
+ssize_t readFully(int fd, char* buffer, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+// 第 2 步：开头和结尾各 kPartialBlock 字节（小文件读取全部内容）
+void partialHash(int baseFd, FileRecord& file, HashWorker& worker, const DedupOptions& options) {
+    Stats::add(Stats::OpenCalls);
+    UniqueFd fd(openat(baseFd, file.path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    if (!fd) {
+        file.failed = true;
+        return;
+    }
+    char* buffer = worker.buffer.data();
+    bool whole = file.size <= 2 * kPartialBlock;
+    size_t head = whole ? static_cast<size_t>(file.size) : kPartialBlock;
+    ssize_t n = readFully(fd.get(), buffer, head, 0);
+    if (n != static_cast<ssize_t>(head)) {
+        file.failed = true;
+        return;
+    }
+    size_t total = head;
+    if (!whole) {
+        off_t tailOffset = static_cast<off_t>(file.size - kPartialBlock);
+        n = readFully(fd.get(), buffer + head, kPartialBlock, tailOffset);
+        if (n != static_cast<ssize_t>(kPartialBlock)) {
+            file.failed = true;
+            return;
+        }
+        total += kPartialBlock;
+    }
+    file.hash = XxHash64::hash(buffer, total);
+    file.complete = whole;
+    worker.bytes += total;
+    if (options.control != nullptr) {
+        options.control->addBytes(total);
+    }
+}
+
+// 第 3 步：完整读取
+void fullHash(int baseFd, FileRecord& file, HashWorker& worker, const DedupOptions& options) {
+    Stats::add(Stats::OpenCalls);
+    UniqueFd fd(openat(baseFd, file.path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    if (!fd) {
+        file.failed = true;
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    XxHash64 hasher;
+    uint64_t offset = 0;
+    while (true) {
+        if (cancelled(options)) {
+            file.failed = true;
+            return;
+        }
+        ssize_t n = readFully(fd.get(), worker.buffer.data(), worker.buffer.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            file.failed = true;
+            return;
+        }
+        if (n == 0) {
+            break;
+        }
+        hasher.update(worker.buffer.data(), static_cast<size_t>(n));
+        offset += static_cast<uint64_t>(n);
+        if (options.control != nullptr) {
+            options.control->addBytes(static_cast<uint64_t>(n));
+        }
+    }
+    worker.bytes += offset;
+    if (offset != file.size) {
+        // 遍历之后文件大小发生了变化
+        file.failed = true;
+        return;
+    }
+    file.hash = hasher.digest();
+    file.complete = true;
+}
+
+// 按 (大小, 哈希) 排序后，把相邻且相同的文件分成一组，只保留有 2 个以上文件的组
+template <typename Key>
+void keepGroups(std::vector<FileRecord>& files, const Key& key) {
+    std::sort(files.begin(), files.end(), [&](const FileRecord& a, const FileRecord& b) { return key(a) < key(b); });
+    std::vector<FileRecord> kept;
+    for (size_t begin = 0; begin < files.size();) {
+        size_t end = begin + 1;
+        while (end < files.size() && key(files[end]) == key(files[begin])) {
+            end++;
+        }
+        if (end - begin >= 2) {
+            for (size_t i = begin; i < end; i++) {
+                kept.push_back(std::move(files[i]));
+            }
+        }
+        begin = end;
+    }
+    files.swap(kept);
+}
+
+// 对 files 中的每个文件并行执行 hash（按 inode 排序后读取），去掉读取失败的文件
+template <typename HashFn>
+void hashAll(std::vector<FileRecord>& files, const DedupOptions& options, uint64_t& bytes, uint64_t& errors,
+             const HashFn& hash) {
+    std::sort(files.begin(), files.end(), [](const FileRecord& a, const FileRecord& b) {
+        return a.dev != b.dev ? a.dev < b.dev : a.ino < b.ino;
+    });
+    std::vector<HashWorker> workers(parallelThreadCount(files.size(), options.threads));
+    parallelFor(files.size(), options.threads, [&](unsigned worker, size_t i) {
+        if (cancelled(options)) {
+            files[i].failed = true;
+            return;
+        }
+        HashWorker& state = workers[worker];
+        if (state.buffer.empty()) {
+            state.buffer.resize(kReadChunk);
+        }
+        hash(files[i], state);
+        if (files[i].failed) {
+            state.errors++;
+        }
+    });
+    for (const auto& worker : workers) {
+        bytes += worker.bytes;
+        errors += worker.errors;
+    }
+    files.erase(std::remove_if(files.begin(), files.end(), [](const FileRecord& f) { return f.failed; }),
+                files.end());
+}
+
+// 逐字节比较两个已打开的文件
+bool sameContent(int a, int b, std::vector<char>& bufferA, std::vector<char>& bufferB) {
+    uint64_t offset = 0;
+    while (true) {
+        ssize_t na = readFully(a, bufferA.data(), bufferA.size(), static_cast<off_t>(offset));
+        ssize_t nb = readFully(b, bufferB.data(), bufferB.size(), static_cast<off_t>(offset));
+        if (na < 0 || nb < 0 || na != nb) {
+            return false;
+        }
+        if (na == 0) {
+            return true;
+        }
+        if (std::memcmp(bufferA.data(), bufferB.data(), static_cast<size_t>(na)) != 0) {
+            return false;
+        }
+        offset += static_cast<uint64_t>(na);
+    }
+}
+
+} // namespace
+
+DedupResult findDuplicates(int baseFd, const std::string& root, const DedupOptions& options) {
+    DedupResult result;
+
+    // ========== 第 1 步：并行遍历，记录普通文件的大小 ==========
+    // 记录每个硬链接的名称，遍历结束后再按 inode 合并
+    WalkOptions walkOptions;
+    walkOptions.threads = options.threads;
+    walkOptions.countHardLinksOnce = false;
+    walkOptions.oneFileSystem = options.oneFileSystem;
+    walkOptions.control = options.control;
+    TreeWalker walker(walkOptions);
+    result.threads = walker.threadCount();
+
+    std::string prefix = root == "." ? std::string() : root;
+    if (!prefix.empty() && prefix.back() != '/') {
+        prefix.push_back('/');
+    }
+    std::vector<std::vector<FileRecord>> perWorker(walker.threadCount());
+    WalkStats walkStats = walker.walk(baseFd, root, [&](WalkEntry& entry) {
+        if (entry.isDir) {
+            return true;
+        }
+        const struct stat* st = entry.stat();
+        if (st == nullptr || !S_ISREG(st->st_mode) || static_cast<uint64_t>(st->st_size) < options.minSize) {
+            return true;
+        }
+        FileRecord file{prefix, static_cast<uint64_t>(st->st_size), st->st_dev, st->st_ino, st->st_nlink, {}};
+        entry.appendRelativePath(file.path);
+        perWorker[entry.worker].push_back(std::move(file));
+        return true;
+    });
+    if (!walkStats.rootOk) {
+        result.error = std::strerror(walkStats.rootErrno);
+        return result;
+    }
+    result.ok = true;
+    result.errors = walkStats.errors;
+
+    std::vector<FileRecord> names;
+    for (auto& list : perWorker) {
+        std::move(list.begin(), list.end(), std::back_inserter(names));
+        std::vector<FileRecord>().swap(list);
+    }
+    // 同一 inode 的名称合并成一条记录，之后只读取一次
+    std::sort(names.begin(), names.end(), [](const FileRecord& a, const FileRecord& b) {
+        return a.dev != b.dev ? a.dev < b.dev : a.ino != b.ino ? a.ino < b.ino : a.path < b.path;
+    });
+    std::vector<FileRecord> files;
+    for (auto& name : names) {
+        if (!files.empty() && files.back().dev == name.dev && files.back().ino == name.ino) {
+            files.back().links.push_back(std::move(name.path));
+        } else {
+            files.push_back(std::move(name));
+        }
+    }
+    std::vector<FileRecord>().swap(names);
+    result.files = files.size();
+
+    // 大小唯一的文件不可能有重复
+    keepGroups(files, [](const FileRecord& f) { return f.size; });
+    result.sizeCandidates = files.size();
+
+    // ========== 第 2 步：部分哈希 ==========
+    hashAll(files, options, result.bytesRead, result.errors, [&](FileRecord& file, HashWorker& worker) {
+        partialHash(baseFd, file, worker, options);
+    });
+    keepGroups(files, [](const FileRecord& f) { return std::make_pair(f.size, f.hash); });
+
+    // ========== 第 3 步：完整哈希（小文件在第 2 步已经读完）==========
+    std::vector<FileRecord> needFull;
+    std::vector<FileRecord> done;
+    for (auto& file : files) {
+        (file.complete ? done : needFull).push_back(std::move(file));
+    }
+    result.fullyHashed = needFull.size();
+    hashAll(needFull, options, result.bytesRead, result.errors, [&](FileRecord& file, HashWorker& worker) {
+        fullHash(baseFd, file, worker, options);
+    });
+    std::move(needFull.begin(), needFull.end(), std::back_inserter(done));
+    keepGroups(done, [](const FileRecord& f) { return std::make_pair(f.size, f.hash); });
+    Stats::add(Stats::Bytes, result.bytesRead);
+
+    // ========== 整理成组 ==========
+    for (size_t begin = 0; begin < done.size();) {
+        size_t end = begin + 1;
+        while (end < done.size() && done[end].size == done[begin].size && done[end].hash == done[begin].hash) {
+            end++;
+        }
+        DuplicateGroup group;
+        group.size = done[begin].size;
+        for (size_t i = begin; i < end; i++) {
+            DuplicateFile file;
+            file.linkedOutside = done[i].nlink > done[i].links.size() + 1;
+            file.paths.push_back(std::move(done[i].path));
+            std::move(done[i].links.begin(), done[i].links.end(), std::back_inserter(file.paths));
+            group.files.push_back(std::move(file));
+        }
+        // 树外还有链接的文件反正不能释放，优先作为原件
+        std::sort(group.files.begin(), group.files.end(), [](const DuplicateFile& a, const DuplicateFile& b) {
+            return a.linkedOutside != b.linkedOutside ? a.linkedOutside : a.paths.front() < b.paths.front();
+        });
+        for (size_t i = 1; i < group.files.size(); i++) {
+            result.duplicateNames += group.files[i].paths.size();
+            if (!group.files[i].linkedOutside) {
+                group.reclaimableBytes += group.size;
+            }
+        }
+        result.duplicateFiles += group.files.size() - 1;
+        result.reclaimableBytes += group.reclaimableBytes;
+        result.groups.push_back(std::move(group));
+        begin = end;
+    }
+    std::sort(result.groups.begin(), result.groups.end(), [](const DuplicateGroup& a, const DuplicateGroup& b) {
+        return a.reclaimableBytes != b.reclaimableBytes ? a.reclaimableBytes > b.reclaimableBytes
+                                                        : a.files.front().paths.front() < b.files.front().paths.front();
+    });
+    result.cancelled = cancelled(options) || walkStats.cancelled;
+    return result;
+}
+
+DedupReplaceResult replaceDuplicates(int baseFd, const std::vector<DuplicateGroup>& groups, DedupLink mode,
+                                     const DedupOptions& options) {
+    DedupReplaceResult result;
+    std::atomic<uint64_t> replaced{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> mismatched{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> sequence{0};
+    std::mutex errorMutex;
+    const std::string pid = std::to_string(getpid());
+
+    auto recordError = [&](const std::string& path, int error) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (result.firstError.empty()) {
+            result.firstError = path + ": " + std::strerror(error);
+        }
+    };
+
+    // 在 path 所在的目录中取一个临时名字，rename 才能原子地覆盖 path
+    auto tempNameFor = [&](const std::string& path) {
+        size_t slash = path.rfind('/');
+        return path.substr(0, slash == std::string::npos ? 0 : slash + 1) + ".dedup-" + pid + "-" +
+               std::to_string(sequence.fetch_add(1, std::memory_order_relaxed));
+    };
+
+    // 每组由一个线程处理（组内的文件都要与同一个原件比较）
+    parallelFor(groups.size(), options.threads, [&](unsigned, size_t g) {
+        const DuplicateGroup& group = groups[g];
+        const std::string& original = group.files.front().paths.front();
+        UniqueFd originalFd(openat(baseFd, original.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+        struct stat originalStat;
+        if (!originalFd || fstat(originalFd.get(), &originalStat) != 0) {
+            recordError(original, errno);
+            return;
+        }
+        if (static_cast<uint64_t>(originalStat.st_size) != group.size) {
+            for (size_t i = 1; i < group.files.size(); i++) {
+                skipped.fetch_add(group.files[i].paths.size(), std::memory_order_relaxed);
+            }
+            return;
+        }
+        std::vector<char> bufferA(kReadChunk);
+        std::vector<char> bufferB(kReadChunk);
+
+        for (size_t i = 1; i < group.files.size(); i++) {
+            if (cancelled(options)) {
+                return;
+            }
+            const std::vector<std::string>& paths = group.files[i].paths;
+            UniqueFd fd(openat(baseFd, paths.front().c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+            struct stat st;
+            if (!fd || fstat(fd.get(), &st) != 0) {
+                recordError(paths.front(), errno);
+                continue;
+            }
+            // 已经是同一个文件，或者内容在查找之后变了
+            if ((st.st_dev == originalStat.st_dev && st.st_ino == originalStat.st_ino) ||
+                static_cast<uint64_t>(st.st_size) != group.size ||
+                !sameContent(originalFd.get(), fd.get(), bufferA, bufferB)) {
+                skipped.fetch_add(paths.size(), std::memory_order_relaxed);
+                continue;
+            }
+            // 硬链接只有一份权限和所有者，不同时不替换，以免悄悄改变副本的访问权限
+            if (mode == DedupLink::HardLink &&
+                ((st.st_mode & 07777) != (originalStat.st_mode & 07777) || st.st_uid != originalStat.st_uid ||
+                 st.st_gid != originalStat.st_gid)) {
+                mismatched.fetch_add(paths.size(), std::memory_order_relaxed);
+                continue;
+            }
+
+            // 链接的来源：硬链接直接用原件；reflink 先建一个新 inode，所有名称再链接到它
+            std::string source = original;
+            if (mode == DedupLink::Reflink) {
+                source = tempNameFor(paths.front());
+                UniqueFd tempFd(openat(baseFd, source.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777));
+                if (!tempFd) {
+                    recordError(paths.front(), errno);
+                    continue;
+                }
+                int error = reflinkFile(originalFd.get(), tempFd.get());
+                if (error != 0) {
+                    unlinkat(baseFd, source.c_str(), 0);
+                    recordError(paths.front(), error);
+                    continue;
+                }
+                // 保留副本自己的权限、所有者和时间
+                fchmod(tempFd.get(), st.st_mode & 07777);
+                // 不是 root 时不能修改所有者（保留为当前用户），忽略失败
+                int ignored = fchown(tempFd.get(), st.st_uid, st.st_gid);
+                (void)ignored;
+                struct timespec times[2] = {st.st_atim, st.st_mtim};
+                futimens(tempFd.get(), times);
+            }
+
+            for (const auto& path : paths) {
+                // 查找之后这个名称被换成了别的文件
+                struct stat nameStat;
+                if (fstatat(baseFd, path.c_str(), &nameStat, AT_SYMLINK_NOFOLLOW) != 0 ||
+                    nameStat.st_dev != st.st_dev || nameStat.st_ino != st.st_ino) {
+                    skipped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                std::string temp = tempNameFor(path);
+                if (linkat(baseFd, source.c_str(), baseFd, temp.c_str(), 0) != 0) {
+                    recordError(path, errno);
+                    continue;
+                }
+                if (renameat(baseFd, temp.c_str(), baseFd, path.c_str()) != 0) {
+                    int error = errno;
+                    unlinkat(baseFd, temp.c_str(), 0);
+                    recordError(path, error);
+                    continue;
+                }
+                replaced.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (mode == DedupLink::Reflink) {
+                unlinkat(baseFd, source.c_str(), 0);
+            }
+            // 所有名称都已替换（包括树外的链接也不存在了）时，旧 inode 才真正被释放
+            if (fstat(fd.get(), &st) == 0 && st.st_nlink == 0) {
+                bytes.fetch_add(group.size, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    result.replaced = replaced.load();
+    result.bytes = bytes.load();
+    result.skipped = skipped.load();
+    result.mismatched = mismatched.load();
+    result.errors = errors.load();
+    return result;
+}
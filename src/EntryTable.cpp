@@ -0,0 +1,120 @@
+#include "../include/EntryTable.h"
+#include "../include/Stats.h"
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+bool EntryTable::statAt(int dirFd, const char* name, Row& row) {
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(dirFd, name, &st, 0) != 0) {
+        row.type = Type::Unknown;
+        row.size = 0;
+        row.mtimeNs = row.atimeNs = 0;
+        return false;
+    }
+    row.type = S_ISDIR(st.st_mode) ? Type::Dir : Type::File;
+    row.size = static_cast<uint64_t>(st.st_size);
+    row.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    row.atimeNs = static_cast<int64_t>(st.st_atim.tv_sec) * 1000000000 + st.st_atim.tv_nsec;
+    return true;
+}
+
+int64_t EntryTable::sortKey(const Row& row, SortBy by) {
+    if (by == SortBy::Size) {
+        return row.type == Type::File ? static_cast<int64_t>(row.size) : 0;
+    }
+    if (by == SortBy::Time) {
+        return row.type == Type::Unknown ? INT64_MIN : row.mtimeNs;
+    }
+    return 0;
+}
+
+void EntryTable::reserve(size_t entries, size_t nameBytes) {
+    names.reserve(nameBytes);
+    nameStart.reserve(entries + 1);
+    types.reserve(entries);
+    sizes.reserve(entries);
+    mtimes.reserve(entries);
+    atimes.reserve(entries);
+}
+
+void EntryTable::append(std::string_view name, const Row& row) {
+    names.insert(names.end(), name.begin(), name.end());
+    names.push_back('\0');
+    nameStart.push_back(static_cast<uint32_t>(names.size()));
+    types.push_back(row.type);
+    sizes.push_back(row.size);
+    mtimes.push_back(row.mtimeNs);
+    atimes.push_back(row.atimeNs);
+}
+
+void EntryTable::shrinkToFit() {
+    names.shrink_to_fit();
+    nameStart.shrink_to_fit();
+    types.shrink_to_fit();
+    sizes.shrink_to_fit();
+    mtimes.shrink_to_fit();
+    atimes.shrink_to_fit();
+}
+
+std::vector<uint32_t> EntryTable::order(SortBy by, size_t limit) const {
+    size_t count = size();
+    size_t wanted = (limit == 0 || limit > count) ? count : limit;
+
+    std::vector<uint32_t> result;
+    if (by == SortBy::None) {
+        result.resize(wanted);
+        for (uint32_t i = 0; i < wanted; i++) {
+            result[i] = i;
+        }
+        return result;
+    }
+
+    // 只对 (键, 下标) 排序：16 字节的紧凑元素，不移动条目本身
+    struct Key {
+        int64_t key;
+        uint32_t index;
+    };
+    // 键大的在前；键相同时保持文件系统顺序，结果是确定的
+    auto before = [](const Key& a, const Key& b) {
+        return a.key != b.key ? a.key > b.key : a.index < b.index;
+    };
+
+    std::vector<Key> keys;
+    if (wanted == count) {
+        keys.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            keys[i] = Key{sortKey(row(i), by), i};
+        }
+        std::sort(keys.begin(), keys.end(), before);
+    } else {
+        // 大小为 wanted 的堆，堆顶是目前保留的条目中排最后的
+        keys.reserve(wanted);
+        for (uint32_t i = 0; i < count; i++) {
+            Key key{sortKey(row(i), by), i};
+            if (keys.size() < wanted) {
+                keys.push_back(key);
+                std::push_heap(keys.begin(), keys.end(), before);
+            } else if (before(key, keys.front())) {
+                std::pop_heap(keys.begin(), keys.end(), before);
+                keys.back() = key;
+                std::push_heap(keys.begin(), keys.end(), before);
+            }
+        }
+        std::sort_heap(keys.begin(), keys.end(), before);
+    }
+
+    result.reserve(keys.size());
+    for (const Key& key : keys) {
+        result.push_back(key.index);
+    }
+    return result;
+}
+
+size_t EntryTable::memoryBytes() const {
+    return sizeof(*this) + names.capacity() + nameStart.capacity() * sizeof(uint32_t) +
+           types.capacity() * sizeof(Type) + sizes.capacity() * sizeof(uint64_t) +
+           mtimes.capacity() * sizeof(int64_t) + atimes.capacity() * sizeof(int64_t);
+}
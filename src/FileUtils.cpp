@@ -0,0 +1,313 @@
+#include "../include/FileUtils.h"
+#include "../include/Stats.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstring>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+void UniqueFd::reset(int newFd) {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = newFd;
+}
+
+DirReader::DirReader(int fd, char* buffer, size_t bufferSize)
+    : fd(fd), buffer(buffer), capacity(bufferSize) {
+#ifndef __linux__
+    // readdir 会接管 fd，所以复制一份
+    int copy = dup(fd);
+    if (copy >= 0) {
+        dir = fdopendir(copy);
+        if (dir == nullptr) {
+            ::close(copy);
+        }
+    }
+    if (dir == nullptr) {
+        err = errno;
+    }
+#endif
+}
+
+DirReader::~DirReader() {
+    if (dir != nullptr) {
+        closedir(static_cast<DIR*>(dir));
+    }
+}
+
+bool DirReader::next(DirEntryView& entry) {
+#ifdef __linux__
+    // getdents64 返回的记录格式（内核 ABI，glibc 未必导出该结构体）
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    while (true) {
+        if (pos >= used) {
+            if (eof) {
+                return false;
+            }
+            Stats::add(Stats::GetdentsCalls);
+            long n = syscall(SYS_getdents64, fd, buffer, capacity);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                err = errno;
+                eof = true;
+                return false;
+            }
+            if (n == 0) {
+                eof = true;
+                return false;
+            }
+            used = static_cast<size_t>(n);
+            pos = 0;
+        }
+
+        const LinuxDirent64* de = reinterpret_cast<const LinuxDirent64*>(buffer + pos);
+        pos += de->d_reclen;
+        const char* name = de->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        entry.name = name;
+        entry.nameLength = std::strlen(name);
+        entry.type = de->d_type;
+        Stats::add(Stats::Entries);
+        return true;
+    }
+#else
+    (void)buffer;
+    (void)capacity;
+    if (dir == nullptr) {
+        return false;
+    }
+    struct dirent* de;
+    while ((de = readdir(static_cast<DIR*>(dir))) != nullptr) {
+        const char* name = de->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        entry.name = name;
+        entry.nameLength = std::strlen(name);
+        entry.type = de->d_type;
+        Stats::add(Stats::Entries);
+        return true;
+    }
+    return false;
+#endif
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    UniqueFd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd) {
+        return false;
+    }
+    return open(fd.get());
+}
+
+bool MappedFile::open(int fd) {
+    close();
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            length = 0;
+            return false;
+        }
+        addr = mapped;
+    }
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (addr != nullptr) {
+        munmap(addr, length);
+    }
+    addr = nullptr;
+    length = 0;
+    opened = false;
+}
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity) : fd(fd), storage(capacity > 0 ? capacity : 1) {
+    setp(storage.data(), storage.data() + storage.size());
+}
+
+OutputBuffer::~OutputBuffer() {
+    drain();
+}
+
+bool OutputBuffer::drain() {
+    const char* data = pbase();
+    size_t left = static_cast<size_t>(pptr() - pbase());
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setp(storage.data(), storage.data() + storage.size());
+            return false;
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+    setp(storage.data(), storage.data() + storage.size());
+    return true;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+    if (!drain()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize OutputBuffer::xsputn(const char* data, std::streamsize count) {
+    size_t length = static_cast<size_t>(count);
+    size_t room = static_cast<size_t>(epptr() - pptr());
+    if (length <= room) {
+        std::memcpy(pptr(), data, length);
+        pbump(static_cast<int>(length));
+        return count;
+    }
+    // 放不下：先写出已有内容，超过整个缓冲区的大块数据直接写
+    if (!drain()) {
+        return 0;
+    }
+    if (length >= storage.size()) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t written = ::write(fd, data + done, length - done);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return static_cast<std::streamsize>(done);
+            }
+            done += static_cast<size_t>(written);
+        }
+        return count;
+    }
+    std::memcpy(pptr(), data, length);
+    pbump(static_cast<int>(length));
+    return count;
+}
+
+int OutputBuffer::sync() {
+    return drain() ? 0 : -1;
+}
+
+std::string cacheFilePath(const std::string& kind, const std::string& key) {
+    std::filesystem::path dir;
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (xdg != nullptr && xdg[0] != '\0') {
+        dir = std::filesystem::path(xdg) / "minifileexplorer";
+    } else if (home != nullptr && home[0] != '\0') {
+        dir = std::filesystem::path(home) / ".cache" / "minifileexplorer";
+    } else {
+        return std::string();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return std::string();
+    }
+
+    // FNV-1a 64 位哈希，把任意长度的 key 变成固定长度的文件名
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%016llx.bin", static_cast<unsigned long long>(hash));
+    return (dir / (kind + name)).string();
+}
+
+bool writeFileAtomic(const std::string& path, const void* data, size_t size) {
+    // 临时文件名由 mkostemp 生成：同一进程的多个线程（后台任务）同时写同一个文件时也不会互相覆盖
+    std::string tmpPath = path + ".tmp.XXXXXX";
+    UniqueFd fd(mkostemp(&tmpPath[0], O_CLOEXEC));
+    if (!fd) {
+        return false;
+    }
+    // mkostemp 创建的文件权限为 0600，改成普通文件的 0644
+    fchmod(fd.get(), 0644);
+
+    const char* p = static_cast<const char*>(data);
+    size_t left = size;
+    while (left > 0) {
+        ssize_t n = ::write(fd.get(), p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            fd.reset();
+            ::unlink(tmpPath.c_str());
+            errno = error;
+            return false;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    fd.reset();
+
+    if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        ::unlink(tmpPath.c_str());
+        errno = error;
+        return false;
+    }
+    return true;
+}
+
+std::string formatBytes(unsigned long long bytes) {
+    static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+
+    if (bytes < 1024) {
+        return std::to_string(bytes) + " B";
+    }
+
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 5) {
+        value /= 1024.0;
+        unit++;
+    }
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f %s", value, units[unit]);
+    return std::string(buffer);
+}
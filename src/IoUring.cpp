@@ -0,0 +1,266 @@
+#include "../include/IoUring.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_IO_URING
+
+namespace {
+
+int sysSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int sysRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// 检测内核是否支持需要的操作
+bool probeOps() {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = sysSetup(4, &params);
+    if (fd < 0) {
+        return false;
+    }
+
+    const unsigned opCount = 256;
+    size_t size = sizeof(struct io_uring_probe) + opCount * sizeof(struct io_uring_probe_op);
+    unsigned char buffer[sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)];
+    std::memset(buffer, 0, size);
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(buffer);
+
+    bool ok = sysRegister(fd, IORING_REGISTER_PROBE, probe, opCount) == 0;
+    if (ok) {
+        const unsigned needed[] = {IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_READ, IORING_OP_WRITE};
+        for (unsigned op : needed) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                ok = false;
+            }
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+} // namespace
+
+bool IoUring::supported() {
+    static const bool result = probeOps();
+    return result;
+}
+
+IoUring::~IoUring() {
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing != nullptr && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != nullptr) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        close(ringFd);
+    }
+}
+
+bool IoUring::init(unsigned entries) {
+    if (!supported()) {
+        return false;
+    }
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd = sysSetup(entries, &params);
+    if (ringFd < 0) {
+        return false;
+    }
+
+    // 映射提交队列、完成队列和请求数组
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        sqRingSize = cqRingSize = (sqRingSize > cqRingSize ? sqRingSize : cqRingSize);
+    }
+
+    void* sq = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringFd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return false;
+    }
+    sqRing = sq;
+
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        void* cq = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return false;
+        }
+        cqRing = cq;
+    }
+
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* s = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd, IORING_OFF_SQES);
+    if (s == MAP_FAILED) {
+        return false;
+    }
+    sqes = s;
+
+    char* sqBase = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sqBase + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sqBase + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sqBase + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sqBase + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    pendingTail = *sqTail;
+
+    char* cqBase = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cqBase + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cqBase + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cqBase + params.cq_off.ring_mask);
+    cqes = cqBase + params.cq_off.cqes;
+    return true;
+}
+
+unsigned IoUring::spaceLeft() const {
+    if (ringFd < 0) {
+        return 0;
+    }
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    return sqEntries - (pendingTail - head);
+}
+
+void* IoUring::nextSqe() {
+    if (spaceLeft() == 0) {
+        return nullptr;
+    }
+    unsigned index = pendingTail & *sqMask;
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    pendingTail++;
+    toSubmit++;
+    return sqe;
+}
+
+bool IoUring::prepOpenat(int dirFd, const char* path, int flags, unsigned mode, uint64_t userData) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = dirFd;
+    sqe->addr = reinterpret_cast<uint64_t>(path);
+    sqe->len = mode;
+    sqe->open_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = userData;
+    return true;
+}
+
+bool IoUring::prepClose(int fd, uint64_t userData) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = userData;
+    return true;
+}
+
+bool IoUring::prepRead(int fd, void* buffer, unsigned length, uint64_t offset, uint64_t userData, bool link) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = userData;
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+bool IoUring::prepWrite(int fd, const void* buffer, unsigned length, uint64_t offset, uint64_t userData,
+                        bool link) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(nextSqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = userData;
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+bool IoUring::submitAndWait(unsigned waitCount) {
+    // 发布新的队尾，内核才能看到这些请求
+    __atomic_store_n(sqTail, pendingTail, __ATOMIC_RELEASE);
+    unsigned submit = toSubmit;
+    toSubmit = 0;
+    while (true) {
+        int ret = sysEnter(ringFd, submit, waitCount, IORING_ENTER_GETEVENTS);
+        if (ret >= 0) {
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+        // 被信号打断：请求可能已经提交，只需继续等待
+        submit = 0;
+    }
+}
+
+bool IoUring::popCompletion(uint64_t& userData, int32_t& result) {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const struct io_uring_cqe* cqe = static_cast<const struct io_uring_cqe*>(cqes) + (head & *cqMask);
+    userData = cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else // !HAVE_IO_URING
+
+bool IoUring::supported() { return false; }
+IoUring::~IoUring() {}
+bool IoUring::init(unsigned) { return false; }
+unsigned IoUring::spaceLeft() const { return 0; }
+void* IoUring::nextSqe() { return nullptr; }
+bool IoUring::prepOpenat(int, const char*, int, unsigned, uint64_t) { return false; }
+bool IoUring::prepClose(int, uint64_t) { return false; }
+bool IoUring::prepRead(int, void*, unsigned, uint64_t, uint64_t, bool) { return false; }
+bool IoUring::prepWrite(int, const void*, unsigned, uint64_t, uint64_t, bool) { return false; }
+bool IoUring::submitAndWait(unsigned) { return false; }
+bool IoUring::popCompletion(uint64_t&, int32_t&) { return false; }
+
+#endif // HAVE_IO_URING
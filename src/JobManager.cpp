@@ -0,0 +1,263 @@
+#include "../include/JobManager.h"
+#include "../include/FileUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+// ========== 任务输出缓冲区 ==========
+
+JobManager::Output::int_type JobManager::Output::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    text.push_back(traits_type::to_char_type(ch));
+    return ch;
+}
+
+std::streamsize JobManager::Output::xsputn(const char* data, std::streamsize count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    text.append(data, static_cast<size_t>(count));
+    return count;
+}
+
+std::string JobManager::Output::takeLines(bool final) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t end = final ? text.size() : text.rfind('\n');
+    if (end == std::string::npos || end == 0) {
+        return std::string();
+    }
+    if (!final) {
+        end++;
+    }
+    std::string lines = text.substr(0, end);
+    text.erase(0, end);
+    return lines;
+}
+
+// ========== 任务管理 ==========
+
+JobManager::JobManager(unsigned workers) : workerCount(workers) {
+    if (workerCount == 0) {
+        workerCount = std::max(2u, std::thread::hardware_concurrency() / 4);
+    }
+}
+
+JobManager::~JobManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (const auto& job : jobs) {
+            job->control.cancel();
+        }
+    }
+    queued.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+unsigned JobManager::submit(const std::string& command, Work work) {
+    auto job = std::make_shared<Job>();
+    job->command = command;
+    job->work = std::move(work);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    job->id = nextId++;
+    jobs.push_back(job);
+    pending.push_back(job);
+    // 工作线程在第一次提交时才启动
+    if (workers.empty()) {
+        for (unsigned i = 0; i < workerCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+    queued.notify_one();
+    return job->id;
+}
+
+void JobManager::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queued.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            return;
+        }
+        std::shared_ptr<Job> job = std::move(pending.front());
+        pending.pop_front();
+
+        // 排队期间已被取消
+        if (stopping || job->control.isCancelled()) {
+            job->state = State::Cancelled;
+            job->startNs = job->endNs = nowNs();
+            finished.notify_all();
+            continue;
+        }
+
+        job->state = State::Running;
+        job->startNs = nowNs();
+        lock.unlock();
+
+        bool ok = false;
+        std::ostream output(&job->output);
+        try {
+            ok = job->work(job->control, job->output);
+        } catch (const std::exception& e) {
+            output << "Error: " << e.what() << '\n';
+        }
+        job->work = nullptr;
+
+        lock.lock();
+        job->endNs = nowNs();
+        job->state = job->control.isCancelled() ? State::Cancelled : ok ? State::Done : State::Failed;
+        finished.notify_all();
+    }
+}
+
+std::shared_ptr<JobManager::Job> JobManager::find(unsigned id) {
+    for (const auto& job : jobs) {
+        if (job->id == id) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool JobManager::cancel(unsigned id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Job> job = find(id);
+    if (!job) {
+        return false;
+    }
+    job->control.cancel();
+    return true;
+}
+
+bool JobManager::wait(unsigned id, std::ostream& out) {
+    std::shared_ptr<Job> job;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job = find(id);
+        if (!job) {
+            return false;
+        }
+        // 等待期间继续输出任务的新输出，长时间的任务不会一直没有反应
+        while (!isFinished(job->state)) {
+            finished.wait_for(lock, std::chrono::milliseconds(200));
+            lock.unlock();
+            report(*job, false, out);
+            out.flush();
+            lock.lock();
+        }
+        jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+    }
+    report(*job, true, out);
+    return true;
+}
+
+void JobManager::waitAll(std::ostream& out) {
+    while (true) {
+        unsigned id = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.empty()) {
+                return;
+            }
+            id = jobs.front()->id;
+        }
+        wait(id, out);
+    }
+}
+
+void JobManager::drain(std::ostream& out) {
+    std::vector<std::shared_ptr<Job>> running;
+    std::vector<std::shared_ptr<Job>> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& job : jobs) {
+            (isFinished(job->state) ? done : running).push_back(job);
+        }
+        jobs = running;
+    }
+    for (const auto& job : running) {
+        report(*job, false, out);
+    }
+    for (const auto& job : done) {
+        report(*job, true, out);
+    }
+}
+
+void JobManager::report(Job& job, bool final, std::ostream& out) {
+    std::string lines = job.output.takeLines(final);
+    size_t start = 0;
+    while (start < lines.size()) {
+        size_t end = lines.find('\n', start);
+        if (end == std::string::npos) {
+            end = lines.size();
+        }
+        out << '[' << job.id << "] ";
+        out.write(lines.data() + start, static_cast<std::streamsize>(end - start));
+        out << '\n';
+        start = end + 1;
+    }
+    if (final) {
+        char elapsed[32];
+        std::snprintf(elapsed, sizeof(elapsed), "%.3f s", static_cast<double>(job.endNs - job.startNs) / 1e9);
+        out << '[' << job.id << "] " << stateName(job.state) << "  " << job.command << " (" << elapsed << ")\n";
+    }
+}
+
+void JobManager::list(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (jobs.empty()) {
+        out << "No jobs\n";
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-5s %-10s %10s %12s %12s %14s %12s  %s\n", "ID", "State", "Elapsed",
+                  "Entries", "Bytes", "Entries/s", "MiB/s", "Command");
+    out << line;
+    int64_t now = nowNs();
+    for (const auto& job : jobs) {
+        int64_t end = isFinished(job->state) ? job->endNs : now;
+        double seconds = job->state == State::Queued ? 0 : static_cast<double>(end - job->startNs) / 1e9;
+        uint64_t entries = job->control.entries.load(std::memory_order_relaxed);
+        uint64_t bytes = job->control.bytes.load(std::memory_order_relaxed);
+        std::snprintf(line, sizeof(line), "%-5u %-10s %9.1fs %12llu %12s %14.0f %12.1f  ", job->id,
+                      stateName(job->state), seconds, static_cast<unsigned long long>(entries),
+                      formatBytes(bytes).c_str(), seconds > 0 ? static_cast<double>(entries) / seconds : 0.0,
+                      seconds > 0 ? static_cast<double>(bytes) / seconds / (1024.0 * 1024.0) : 0.0);
+        out << line << job->command << '\n';
+    }
+}
+
+bool JobManager::empty() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.empty();
+}
+
+bool JobManager::isFinished(State state) {
+    return state == State::Done || state == State::Failed || state == State::Cancelled;
+}
+
+const char* JobManager::stateName(State state) {
+    switch (state) {
+        case State::Queued: return "Queued";
+        case State::Running: return "Running";
+        case State::Done: return "Done";
+        case State::Failed: return "Failed";
+        case State::Cancelled: return "Cancelled";
+    }
+    return "";
+}
@@ -1,4 +1,22 @@
 #include "../include/MiniFileExplorer.h"
+#include "../include/CommandTable.h"
+#include "../include/ContentScanner.h"
+#include "../include/CopyEngine.h"
+#include "../include/DirCache.h"
+#include "../include/DuCache.h"
+#include "../include/DuplicateFinder.h"
+#include "../include/EntryTable.h"
+#include "../include/FileUtils.h"
+#include "../include/ParallelFor.h"
+#include "../include/PathIndex.h"
+#include "../include/SearchFilter.h"
+#include "../include/Stats.h"
+#include "../include/TimeFormatter.h"
+#include "../include/TreeCopier.h"
+#include "../include/TreeRemover.h"
+#include "../include/TreeSnapshot.h"
+#include "../include/TreeSync.h"
+#include "../include/TreeWalker.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -7,6 +25,15 @@
 #include <fstream>  // for file operations
 #include <chrono>   // for time conversion
 #include <ctime>    // for time formatting
+#include <cerrno>   // for errno
+#include <cstring>  // for strerror
+#include <cstdio>   // for snprintf
+#include <mutex>    // for parallel walkers
+#include <atomic>   // for parallel walkers
+#include <condition_variable>  // for rm -r progress
+#include <thread>   // for rm -r progress
+#include <charconv> // for from_chars
+#include <cstdint>  // for UINT64_MAX
 
 // 跨平台支持：Windows 和 Linux/Mac 使用不同的函数获取当前目录
 #ifdef _WIN32
@@ -21,6 +48,8 @@
 #include <unistd.h>  // Linux/Mac: getcwd
 #include <limits.h>  // Linux/Mac: PATH_MAX
 #include <sys/stat.h>  // Linux/Mac: stat() for file times
+#include <fcntl.h>     // Linux/Mac: AT_FDCWD, openat()
+#include <dirent.h>    // Linux/Mac: DT_REG, DT_UNKNOWN
 
 #define getcwd_func getcwd
 // Linux 上 PATH_MAX 可能未定义，使用默认值
@@ -34,7 +63,7 @@
 // 1. 程序启动时默认加载当前工作目录（通过 getcwd() 函数获取）
 // 2. 支持启动时通过命令行参数指定初始目录
 // 3. 若指定目录不存在，提示错误并退出
-MiniFileExplorer::MiniFileExplorer(const std::string &initialPath) {
+MiniFileExplorer::MiniFileExplorer(const std::string &initialPath) : out(std::cout.rdbuf()) {
     if (initialPath.empty()) {
         // ========== 要求1：默认加载当前工作目录 ==========
         // 如果没有指定初始路径，使用 getcwd() 获取当前工作目录
@@ -63,31 +92,45 @@ MiniFileExplorer::MiniFileExplorer(const std::string &initialPath) {
         // 使用指定的初始路径
         currentPath = std::filesystem::path(initialPath);
 
-        // ========== 要求3：校验目录合法性 ==========
-        // 检查路径是否存在
-        if (!std::filesystem::exists(currentPath)) {
-            std::cout << "Directory not found: " << initialPath << std::endl;
-            exit(1);
-        }
-
-        // 检查是否是目录（而不是文件）
-        if (!std::filesystem::is_directory(currentPath)) {
-            std::cout << "Not a directory: " << initialPath << std::endl;
-            exit(1);
-        }
     }
 
-    // ========== 显示当前目录路径（格式：Current Directory: /path/to/dir）==========
-    std::cout << "Current Directory: " << currentPath.string() << std::endl;
+    // ========== 要求3：校验目录合法性 ==========
+    // 打开目录的 fd 作为当前目录，之后的相对路径操作都相对这个 fd 进行
+    int error = workingDir.open(currentPath.string());
+    if (error == ENOENT) {
+        out << "Directory not found: " << initialPath << '\n';
+        exit(1);
+    }
+    if (error == ENOTDIR) {
+        out << "Not a directory: " << initialPath << '\n';
+        exit(1);
+    }
+    if (error != 0) {
+        out << "Cannot open directory: " << currentPath.string() << ": " << std::strerror(error) << '\n';
+        exit(1);
+    }
+    currentPath = workingDir.path();
 }
 
+// 后台任务：在提交时的当前目录中执行，输出写入任务自己的缓冲区
+MiniFileExplorer::MiniFileExplorer(WorkingDirectory cwd, JobControl &control, std::streambuf &output, bool assumeYes)
+    : out(&output), workingDir(std::move(cwd)), currentPath(workingDir.path()), interactive(false),
+      assumeYes(assumeYes), control(&control) {}
+
 // ========== 主循环 ==========
-void MiniFileExplorer::run() {
+int MiniFileExplorer::run() {
+    // ========== 显示当前目录路径（格式：Current Directory: /path/to/dir）==========
+    out << "Current Directory: " << currentPath.string() << '\n';
+
     std::string line;
+    bool anyFailed = false;
 
-    while (true) {
-        // 显示命令提示符
-        std::cout << "Enter command (type 'help' for all commands): ";
+    while (running) {
+        // 先输出后台任务在上一条命令期间产生的输出，再显示提示符，不会打断用户的输入
+        jobs.drain(out);
+
+        // 显示命令提示符（std::cin 与 std::cout 绑定，out 使用 std::cout 的缓冲区，读取输入前会自动刷新输出）
+        out << "Enter command (type 'help' for all commands): ";
 
         // 读取用户输入的一行命令
         if (!std::getline(std::cin, line)) {
@@ -96,63 +139,188 @@ void MiniFileExplorer::run() {
         }
 
         // 处理命令
-        handleCommand(line);
+        if (!handleCommand(line)) {
+            anyFailed = true;
+        }
+    }
+    // 退出时取消还在运行的后台任务（JobManager 析构时等待它们结束）
+    if (!jobs.empty()) {
+        out << "Cancelling background jobs...\n";
     }
+    out.flush();
+    return anyFailed ? 1 : 0;
 }
 
-// ========== 命令处理 ==========
-void MiniFileExplorer::handleCommand(const std::string &line) {
-    // 分割命令和参数
-    std::vector <std::string> args = split(line);
+// ========== 批处理模式 ==========
+// 不显示提示符，命令之间用换行或 ';' 分隔（引号内的 ';' 除外），'#' 开头的行是注释。
+// 输出写入 1 MiB 的缓冲区，满了才真正 write()，而不是每行刷新一次
+int MiniFileExplorer::runBatch(std::istream &script, bool stopOnError) {
+    interactive = false;
+    this->stopOnError = stopOnError;
+    scriptOnStdin = &script == &std::cin;
 
-    // 如果没有输入任何内容，直接返回
-    if (args.empty()) {
-        return;
+    OutputBuffer buffer(STDOUT_FILENO);
+    std::streambuf *previous = out.rdbuf(&buffer);
+
+    std::string line;
+    bool anyFailed = false;
+
+    while (running && std::getline(script, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        // 一行中可以有多条用 ';' 分隔的命令（由 handleCommand 切分）
+        if (!handleCommand(line)) {
+            anyFailed = true;
+            if (stopOnError) {
+                running = false;
+            }
+        }
+        jobs.drain(out);
     }
 
-    // 获取命令名（第一个参数）
-    std::string command = args[0];
-
-    // 移除命令名，剩下的就是参数
-    args.erase(args.begin());
-
-    // 根据命令名调用对应的处理方法
-    if (command == "cd") {
-        cmdCd(args);
-    } else if (command == "ls") {
-        cmdLs(args);
-    } else if (command == "touch") {
-        cmdTouch(args);
-    } else if (command == "mkdir") {
-        cmdMkdir(args);
-    } else if (command == "rm") {
-        cmdRm(args);
-    } else if (command == "rmdir") {
-        cmdRmdir(args);
-    } else if (command == "stat") {
-        cmdStat(args);
-    } else if (command == "search") {
-        cmdSearch(args);
-    } else if (command == "cp") {
-        cmdCp(args);
-    } else if (command == "mv") {
-        cmdMv(args);
-    } else if (command == "du") {
-        cmdDu(args);
-    } else if (command == "help") {
-        printHelp();
-    } else if (command == "exit") {
-        cmdExit();
-    } else {
-        // 未知命令
-        std::cout << "Unknown command: " << command << std::endl;
-        std::cout << "Type 'help' for all commands." << std::endl;
+    // 脚本结束时等待所有后台任务
+    jobs.waitAll(out);
+    out.flush();
+    out.rdbuf(previous);
+    return anyFailed ? 1 : 0;
+}
+
+std::ostream &MiniFileExplorer::fail() {
+    commandFailed = true;
+    return out;
+}
+
+bool MiniFileExplorer::confirm(const std::string &question) {
+    if (assumeYes) {
+        return true;
+    }
+    if (control != nullptr) {
+        // 后台任务不能读取标准输入
+        out << question << " (y/n): n (background job; run with -y to confirm)\n";
+        return false;
+    }
+    if (scriptOnStdin) {
+        // 标准输入上的下一行是脚本的下一条命令，不是回答
+        out << question << " (y/n): n (script read from stdin; run with -y to confirm)\n";
+        return false;
+    }
+    out << question << " (y/n): ";
+    out.flush();
+    std::string answer;
+    if (!std::getline(std::cin, answer)) {
+        // 如果读取失败，取消操作
+        return false;
+    }
+    // 仅输入 "y" 时确认，其他输入取消操作
+    return answer == "y";
+}
+
+// ========== 命令处理 ==========
+bool MiniFileExplorer::handleCommand(std::string_view line) {
+    // 命令名 -> 处理方法，编译期生成完美哈希表：查找只需一次哈希和一次字符串比较
+    using Handler = void (MiniFileExplorer::*)(const ArgList &);
+    static constexpr CommandTable<Handler, 22> kCommands({
+        {"cd", &MiniFileExplorer::cmdCd},
+        {"ls", &MiniFileExplorer::cmdLs},
+        {"touch", &MiniFileExplorer::cmdTouch},
+        {"mkdir", &MiniFileExplorer::cmdMkdir},
+        {"rm", &MiniFileExplorer::cmdRm},
+        {"rmdir", &MiniFileExplorer::cmdRmdir},
+        {"stat", &MiniFileExplorer::cmdStat},
+        {"search", &MiniFileExplorer::cmdSearch},
+        {"grep", &MiniFileExplorer::cmdGrep},
+        {"index", &MiniFileExplorer::cmdIndex},
+        {"snapshot", &MiniFileExplorer::cmdSnapshot},
+        {"cp", &MiniFileExplorer::cmdCp},
+        {"mv", &MiniFileExplorer::cmdMv},
+        {"sync", &MiniFileExplorer::cmdSync},
+        {"du", &MiniFileExplorer::cmdDu},
+        {"dedup", &MiniFileExplorer::cmdDedup},
+        {"stats", &MiniFileExplorer::cmdStats},
+        {"jobs", &MiniFileExplorer::cmdJobs},
+        {"wait", &MiniFileExplorer::cmdWait},
+        {"cancel", &MiniFileExplorer::cmdCancel},
+        {"help", &MiniFileExplorer::cmdHelp},
+        {"exit", &MiniFileExplorer::cmdExit},
+    });
+
+    bool ok = true;
+    while (!line.empty() && running) {
+        // 切分出一条命令（到 ';' 或行尾为止），参数直接引用输入行，不逐个分配内存
+        size_t used = 0;
+        Tokenizer::Status status = tokenizer.tokenize(line, used);
+        std::string_view text = line.substr(0, used);
+        line.remove_prefix(used);
+        commandFailed = false;
+
+        if (status == Tokenizer::Status::UnterminatedQuote) {
+            fail() << "Unterminated quote\n";
+            return false;
+        }
+        if (status == Tokenizer::Status::TrailingBackslash) {
+            fail() << "Trailing backslash\n";
+            return false;
+        }
+
+        // 如果没有输入任何内容，直接跳过
+        ArgList words = tokenizer.args();
+        if (words.empty()) {
+            continue;
+        }
+
+        // 末尾未加引号的 & 表示作为后台任务执行（后台任务中再遇到 & 时直接执行）；\& 和 '&' 是普通参数
+        bool background = words.back() == "&" && tokenizer.verbatim(words.size() - 1);
+        if (background) {
+            words = words.dropBack();
+        }
+
+        if (words.empty()) {
+            fail() << "Missing command before '&'\n";
+        } else if (background && control == nullptr) {
+            // 命令文本去掉 & 及其之后的部分（& 是最后一个未加引号的 '&'）
+            submitJob(words.front(), text.substr(0, text.rfind('&')));
+        } else if (Handler handler = kCommands.find(words.front())) {
+            // 第一个参数是命令名，剩下的是命令参数
+            Stats::CommandTimer timer(words.front());
+            (this->*handler)(words.dropFront());
+        } else {
+            // 未知命令
+            fail() << "Unknown command: " << words.front() << '\n';
+            out << "Type 'help' for all commands.\n";
+        }
+
+        if (commandFailed) {
+            ok = false;
+            if (stopOnError) {
+                break;
+            }
+        }
     }
+    return ok;
+}
+
+// ========== 命令实现 ==========
+
+// 辅助函数：解析非负整数参数（整个参数都必须是数字）
+static bool parseNumber(std::string_view text, unsigned long long &value) {
+    const char *end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
 }
 
-// ========== 命令实现（暂时为空，后续填充） ==========
+std::filesystem::path MiniFileExplorer::resolvePath(std::string_view name) const {
+    if (std::filesystem::path(name).is_absolute()) {
+        // 绝对路径：直接使用
+        return std::filesystem::absolute(std::filesystem::path(name));
+    }
+    // 相对路径：基于当前目录构建完整路径
+    return std::filesystem::absolute(currentPath / name);
+}
 
-void MiniFileExplorer::cmdCd(const std::vector <std::string> &args) {
+void MiniFileExplorer::cmdCd(const ArgList &args) {
     // ========== 目录切换操作（15分）==========
     // 1. 支持输入 cd [目录路径] 切换目录
     // 2. 切换时校验目录合法性
@@ -162,11 +330,11 @@ void MiniFileExplorer::cmdCd(const std::vector <std::string> &args) {
     if (args.empty()) {
         // 如果没有参数，可以切换到主目录（可选功能，项目要求未明确说明）
         // 这里我们提示需要参数
-        std::cout << "Missing path: Please enter 'cd [path]'" << std::endl;
+        fail() << "Missing path: Please enter 'cd [path]'\n";
         return;
     }
 
-    std::string targetPath = args[0];
+    std::string targetPath(args[0]);
     std::filesystem::path newPath;
 
     // ========== 要求3：支持 cd ~ 切换到主目录 ==========
@@ -185,7 +353,7 @@ void MiniFileExplorer::cmdCd(const std::vector <std::string> &args) {
                 std::string homePath = std::string(drive) + std::string(path);
                 newPath = std::filesystem::path(homePath);
             } else {
-                std::cout << "Cannot determine home directory" << std::endl;
+                fail() << "Cannot determine home directory\n";
                 return;
             }
         } else {
@@ -195,7 +363,7 @@ void MiniFileExplorer::cmdCd(const std::vector <std::string> &args) {
         // Linux/Mac: 使用 HOME 环境变量
         homeDir = std::getenv("HOME");
         if (homeDir == nullptr) {
-            std::cout << "Cannot determine home directory" << std::endl;
+            fail() << "Cannot determine home directory\n";
             return;
         }
         newPath = std::filesystem::path(homeDir);
@@ -204,323 +372,596 @@ void MiniFileExplorer::cmdCd(const std::vector <std::string> &args) {
         // ========== 要求1：支持相对路径和绝对路径 ==========
         // 处理相对路径（如 ../.. 或 ./test）
         // 处理绝对路径（如 /home/user/docs）
-
-        if (std::filesystem::path(targetPath).is_absolute()) {
-            // 绝对路径：直接使用
-            newPath = std::filesystem::path(targetPath);
-        } else {
-            // 相对路径：基于当前目录构建完整路径
-            newPath = currentPath / targetPath;
-        }
-
-        // 规范化路径（处理 .. 和 . 等符号）
-        // 先转换为绝对路径
-        newPath = std::filesystem::absolute(newPath);
-
-        // 如果路径存在，使用 canonical 进一步规范化（解析符号链接等）
-        // 如果不存在，保持 absolute 的结果，稍后会检查并报错
-        if (std::filesystem::exists(newPath)) {
-            try {
-                newPath = std::filesystem::canonical(newPath);
-            } catch (const std::filesystem::filesystem_error &e) {
-                // 如果 canonical 失败（比如权限问题），继续使用 absolute 的结果
-            }
-        }
+        // 相对路径由内核相对当前目录的 fd 解析（.. 和符号链接都按实际结构处理）
+        newPath = std::filesystem::path(targetPath);
     }
 
     // ========== 要求2：校验目录合法性 ==========
-
-    // 检查路径是否存在
-    if (!std::filesystem::exists(newPath)) {
-        std::cout << "Invalid directory: " << targetPath << std::endl;
+    // 一次 openat 同时完成存在性和类型检查，打开的 fd 就是新的当前目录，
+    // 检查和切换之间路径不会被替换
+    int error = workingDir.change(newPath.string());
+    if (error == ENOTDIR) {
+        fail() << "Not a directory: " << targetPath << '\n';
         return;
     }
-
-    // 检查是否是目录（而不是文件）
-    if (!std::filesystem::is_directory(newPath)) {
-        std::cout << "Not a directory: " << targetPath << std::endl;
+    if (error != 0) {
+        fail() << "Invalid directory: " << targetPath << '\n';
         return;
     }
 
     // ========== 切换目录 ==========
-    // 更新当前路径
-    currentPath = newPath;
+    // 更新当前路径（规范化路径来自 WorkingDirectory 的缓存或 fd 的真实路径）
+    currentPath = workingDir.path();
 
     // 显示新的当前目录（保持与启动时一致的格式）
-    std::cout << "Current Directory: " << currentPath.string() << std::endl;
+    out << "Current Directory: " << currentPath.string() << '\n';
 }
 
-void MiniFileExplorer::cmdLs(const std::vector <std::string> &args) {
+void MiniFileExplorer::cmdLs(const ArgList &args) {
     // ========== 目录内容列表展示：ls 命令（10分）==========
     // 输入 ls 时，以列表形式展示当前目录下的所有文件和文件夹
     // 区分显示类型（文件夹名后加/，如data/；文件名正常显示，如note.txt）
     // 列表需包含 "名称、类型、大小（字节）、修改时间" 4列，格式对齐
     // 支持选项：-s (按大小排序), -t (按时间排序)
+    //          -n N (只显示 N 条), --offset M (跳过前 M 条), -f (按目录顺序流式输出)
+    //
+    // 超大目录：
+    //   -f 或者指定了 -n 时，不把整个目录读入内存，边读边输出（有缓存时直接用缓存）；
+    //   -s/-t 加 -n 时只用大小为 offset+N 的堆保留最大的条目，O(N log K)
     
     // 解析选项
     bool sortBySize = false;
     bool sortByTime = false;
-    for (const auto& arg : args) {
+    bool streaming = false;
+    bool limited = false;
+    uint64_t limit = 0;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string_view arg = args[i];
         if (arg == "-s") {
             sortBySize = true;
         } else if (arg == "-t") {
             sortByTime = true;
+        } else if (arg == "-f") {
+            streaming = true;
+        } else if (arg == "-n" || arg == "--offset") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing count: Please enter 'ls " << arg << " N'\n";
+                return;
+            }
+            unsigned long long value = 0;
+            if (!parseNumber(args[i + 1], value)) {
+                fail() << "Invalid count: " << args[i + 1] << '\n';
+                return;
+            }
+            if (arg == "-n") {
+                limited = true;
+                limit = value;
+            } else {
+                offset = value;
+            }
+            i++;
         }
     }
+    // 按目录顺序输出时 -s/-t 没有意义
+    if (streaming) {
+        sortBySize = sortByTime = false;
+    }
+    EntryTable::SortBy sortBy = sortBySize ? EntryTable::SortBy::Size
+                              : sortByTime ? EntryTable::SortBy::Time
+                              : EntryTable::SortBy::None;
     
-    // 定义条目信息结构
-    struct EntryInfo {
-        std::string name;
-        std::string type;
-        std::string sizeStr;
-        std::string modifyTime;
-        uintmax_t fileSize;  // 用于排序
-        std::filesystem::file_time_type modifyTimePoint;  // 用于排序
+    // 输出一个条目（第一次输出前打印表头；目录为空时不显示表头）
+    // 大小和时间的字符串只在这里生成，时间直接写入栈上的缓冲区
+    bool headerPrinted = false;
+    char timeBuffer[TimeFormatter::kBufferSize];
+    auto printRow = [&](const EntryTable::Row &row) {
+        if (!headerPrinted) {
+            // 打印表头
+            out << std::left << std::setw(20) << "Name" 
+                << std::setw(10) << "Type" 
+                << std::setw(15) << "Size(B)" 
+                << "Modify Time\n";
+            
+            // 打印分隔线
+            out << std::string(20, '-') << " " 
+                << std::string(10, '-') << " " 
+                << std::string(15, '-') << " " 
+                << std::string(19, '-') << '\n';
+            headerPrinted = true;
+        }
+        
+        auto formatTime = [&timeBuffer](int64_t ns) -> const char * {
+            TimeFormatter::format(TimeFormatter::fromNanoseconds(ns), timeBuffer);
+            return timeBuffer;
+        };
+        
+        if (row.type == EntryTable::Type::Unknown) {
+            // 无法获取信息（比如失效的符号链接）：按文件显示，大小和时间未知
+            out << std::left << std::setw(20) << row.name
+                << std::setw(10) << "File"
+                << std::setw(15) << "-"
+                << "-\n";
+        } else if (row.type == EntryTable::Type::Dir) {
+            // 目录：名称后加 /
+            out << std::left << std::setw(20) << std::string(row.name) + "/"
+                << std::setw(10) << "Dir"
+                << std::setw(15) << "-"
+                << formatTime(row.mtimeNs) << '\n';
+        } else {
+            // 文件：正常显示
+            out << std::left << std::setw(20) << row.name
+                << std::setw(10) << "File"
+                << std::setw(15) << row.size
+                << formatTime(row.mtimeNs) << '\n';
+        }
     };
     
-    try {
-        // 遍历当前目录下的所有文件和文件夹，收集信息
-        std::vector<EntryInfo> entries;
-        for (const auto& entry : std::filesystem::directory_iterator(currentPath)) {
-            EntryInfo info;
-            std::filesystem::path path = entry.path();
-            info.name = path.filename().string();
+    std::string dir = currentPath.lexically_normal().string();
+    
+    // ========== 分页或流式输出：不把整个目录读入内存 ==========
+    if (streaming || limited) {
+        if (limited && limit == 0) {
+            return;
+        }
+        // 需要保留的条目数（offset + limit，溢出时取最大值）
+        uint64_t keep = offset > UINT64_MAX - limit ? UINT64_MAX : offset + limit;
+        
+        // 目录已缓存：直接在缓存的表上取排列
+        std::shared_ptr<const EntryTable> listing = dirCache.find(dir);
+        if (listing) {
+            std::vector<uint32_t> order = listing->order(sortBy, limited ? keep : 0);
+            for (size_t i = offset; i < order.size(); i++) {
+                printRow(listing->row(order[i]));
+            }
+            return;
+        }
+        
+        // 边读边处理，内存占用与目录大小无关
+        UniqueFd dirFd(openat(workingDir.fd(), ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!dirFd) {
+            fail() << "Error reading directory: " << currentPath.string() << ": " << std::strerror(errno) << '\n';
+            return;
+        }
+        
+        // -s/-t：大小为 keep 的堆，堆顶是目前保留的条目中排最后的；
+        // 被挤出堆的条目不再占用内存，所以每个元素自己保存名称
+        struct Kept {
+            int64_t key;
+            uint64_t sequence;   // 键相同时保持目录顺序
+            std::string name;
+            EntryTable::Row row;
+        };
+        auto before = [](const Kept &a, const Kept &b) {
+            return a.key != b.key ? a.key > b.key : a.sequence < b.sequence;
+        };
+        std::vector<Kept> heap;
+        
+        std::vector<char> buffer(DirReader::kBufferSize);
+        DirReader reader(dirFd.get(), buffer.data(), buffer.size());
+        DirEntryView view;
+        EntryTable::Row row;
+        uint64_t seen = 0;
+        while (reader.next(view)) {
+            EntryTable::statAt(dirFd.get(), view.name, row);
+            row.name = std::string_view(view.name, view.nameLength);
+            uint64_t sequence = seen++;
             
-            // 判断类型并设置名称显示
-            if (std::filesystem::is_directory(entry.status())) {
-                // 目录：名称后加 /
-                info.name += "/";
-                info.type = "Dir";
-                info.sizeStr = "-";
-                info.fileSize = 0;  // 目录大小设为0用于排序
-            } else {
-                // 文件：正常显示
-                info.type = "File";
-                // 获取文件大小
-                try {
-                    info.fileSize = std::filesystem::file_size(path);
-                    info.sizeStr = std::to_string(info.fileSize);
-                } catch (const std::filesystem::filesystem_error&) {
-                    info.sizeStr = "-";
-                    info.fileSize = 0;
+            if (sortBy == EntryTable::SortBy::None) {
+                // 按目录顺序：跳过 offset 条，输出 limit 条后停止
+                if (sequence >= offset) {
+                    printRow(row);
                 }
+                if (limited && seen >= keep) {
+                    break;
+                }
+                continue;
             }
             
-            // 获取修改时间
-            try {
-                info.modifyTimePoint = std::filesystem::last_write_time(path);
-                
-                // 将文件系统时间转换为系统时间
-                auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                    info.modifyTimePoint - std::filesystem::file_time_type::clock::now() + 
-                    std::chrono::system_clock::now());
-                
-                // 转换为 time_t
-                std::time_t time = std::chrono::system_clock::to_time_t(sctp);
-                
-                // 格式化为字符串：YYYY-MM-DD HH:MM:SS
-                std::tm* timeinfo = std::localtime(&time);
-                char buffer[32];
-                std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-                info.modifyTime = std::string(buffer);
-            } catch (const std::filesystem::filesystem_error&) {
-                info.modifyTime = "-";
-                // 设置一个默认时间点用于排序
-                info.modifyTimePoint = std::filesystem::file_time_type::min();
+            Kept candidate{EntryTable::sortKey(row, sortBy), sequence, std::string(), row};
+            if (heap.size() < keep) {
+                candidate.name.assign(row.name);
+                heap.push_back(std::move(candidate));
+                std::push_heap(heap.begin(), heap.end(), before);
+            } else if (before(candidate, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), before);
+                candidate.name.assign(row.name);
+                heap.back() = std::move(candidate);
+                std::push_heap(heap.begin(), heap.end(), before);
             }
-            
-            entries.push_back(info);
         }
-        
-        // 如果没有条目，直接返回（不显示表头）
-        if (entries.empty()) {
+        if (reader.error() != 0) {
+            fail() << "Error reading directory: " << currentPath.string() << ": " << std::strerror(reader.error()) << '\n';
             return;
         }
         
-        // 根据选项排序
-        if (sortBySize) {
-            // 按大小排序（降序）
-            std::sort(entries.begin(), entries.end(), 
-                [](const EntryInfo& a, const EntryInfo& b) {
-                    return a.fileSize > b.fileSize;
-                });
-        } else if (sortByTime) {
-            // 按时间排序（降序，最新的在前）
-            std::sort(entries.begin(), entries.end(), 
-                [](const EntryInfo& a, const EntryInfo& b) {
-                    return a.modifyTimePoint > b.modifyTimePoint;
-                });
-        }
-        // 如果没有指定排序选项，保持默认顺序（文件系统顺序）
-        
-        // 打印表头
-        std::cout << std::left << std::setw(20) << "Name" 
-                  << std::setw(10) << "Type" 
-                  << std::setw(15) << "Size(B)" 
-                  << "Modify Time" << std::endl;
-        
-        // 打印分隔线
-        std::cout << std::string(20, '-') << " " 
-                  << std::string(10, '-') << " " 
-                  << std::string(15, '-') << " " 
-                  << std::string(19, '-') << std::endl;
-        
-        // 遍历并打印每个条目
-        for (const auto& info : entries) {
-            std::cout << std::left << std::setw(20) << info.name
-                      << std::setw(10) << info.type
-                      << std::setw(15) << info.sizeStr
-                      << info.modifyTime << std::endl;
+        // 堆中剩下的就是排在最前面的 keep 个条目
+        std::sort_heap(heap.begin(), heap.end(), before);
+        for (size_t i = offset; i < heap.size(); i++) {
+            heap[i].row.name = heap[i].name;
+            printRow(heap[i].row);
         }
-    } catch (const std::filesystem::filesystem_error& e) {
-        std::cout << "Error reading directory: " << e.what() << std::endl;
+        return;
+    }
+    
+    // ========== 完整列表 ==========
+    // 从目录缓存获取列表：目录没有变化时直接使用内存中的结果，
+    // 否则重新读取（每个条目只调用一次 fstatat，类型、大小、修改时间都来自同一个 stat 结果）
+    int error = 0;
+    std::shared_ptr<const EntryTable> listing = dirCache.get(dir, error);
+    if (!listing) {
+        fail() << "Error reading directory: " << currentPath.string() << ": " << std::strerror(error) << '\n';
+        return;
+    }
+    
+    // 根据选项排序（只对下标排序）；如果没有指定排序选项，保持默认顺序（文件系统顺序）
+    std::vector<uint32_t> order = listing->order(sortBy);
+    
+    // 遍历并打印每个条目
+    for (size_t i = offset; i < order.size(); i++) {
+        printRow(listing->row(order[i]));
+    }
+}
+
+// touch / mkdir 一次最多创建的名字数（花括号展开之后）
+static const size_t kMaxCreateNames = 2000000;
+
+// 辅助函数：展开参数中的花括号（与 bash 相同，加了引号或转义的参数原样保留），超过上限时返回 false
+static bool expandName(const Tokenizer &tokenizer, std::string_view arg, std::vector<std::string> &names) {
+    if (tokenizer.verbatim(arg)) {
+        return expandBraces(arg, names, kMaxCreateNames);
+    }
+    if (names.size() >= kMaxCreateNames) {
+        return false;
     }
+    names.emplace_back(arg);
+    return true;
 }
 
-void MiniFileExplorer::cmdTouch(const std::vector<std::string>& args) {
+// 批量创建时的一个失败：名字的下标和 errno
+struct CreateError {
+    size_t index;
+    int error;
+};
+
+// 辅助函数：按参数顺序输出批量创建的失败（最多 10 条，其余只输出数量）
+template <typename Describe>
+static void printCreateErrors(std::ostream &out, std::vector<std::vector<CreateError>> &perWorker,
+                              const Describe &describe) {
+    std::vector<CreateError> errors;
+    for (auto &list : perWorker) {
+        errors.insert(errors.end(), list.begin(), list.end());
+    }
+    std::sort(errors.begin(), errors.end(),
+              [](const CreateError &a, const CreateError &b) { return a.index < b.index; });
+    const size_t kShown = 10;
+    for (size_t i = 0; i < errors.size() && i < kShown; i++) {
+        describe(errors[i]);
+    }
+    if (errors.size() > kShown) {
+        out << "... and " << errors.size() - kShown << " more\n";
+    }
+}
+
+void MiniFileExplorer::cmdTouch(const ArgList &args) {
     // ========== 文件/文件夹创建：touch 命令（10分）==========
-    // 输入 touch [文件名] 创建空文件
+    // 输入 touch [文件名...] 创建空文件，支持花括号展开（如 touch f{0..99999}）
     // 若文件已存在，提示 "File already exists: [文件名]"
+    //
+    // 每个文件只需一次 openat(O_CREAT | O_EXCL)：内核原子地检查是否已存在并创建，
+    // 名字较多时由 parallelFor 的小线程池并行创建
     
     // 检查参数
     if (args.empty()) {
-        std::cout << "Missing filename: Please enter 'touch [filename]'" << std::endl;
+        fail() << "Missing filename: Please enter 'touch [filename]'\n";
         return;
     }
-    
-    std::string filename = args[0];
-    std::filesystem::path filePath;
-    
-    // 处理路径（相对路径或绝对路径）
-    if (std::filesystem::path(filename).is_absolute()) {
-        // 绝对路径：直接使用
-        filePath = std::filesystem::path(filename);
-    } else {
-        // 相对路径：基于当前目录构建完整路径
-        filePath = currentPath / filename;
+
+    std::vector<std::string> names;
+    for (const auto &arg : args) {
+        if (!expandName(tokenizer, arg, names)) {
+            fail() << "Too many names: at most " << kMaxCreateNames << " files per command\n";
+            return;
+        }
     }
-    
-    // 规范化路径
-    filePath = std::filesystem::absolute(filePath);
-    
-    // 检查文件是否已存在
-    if (std::filesystem::exists(filePath)) {
-        std::cout << "File already exists: " << filename << std::endl;
-        return;
+
+    // 相对当前目录的 fd 创建（绝对路径时 openat 忽略 fd）
+    int cwdFd = workingDir.fd();
+    std::vector<std::vector<CreateError>> errors(kParallelMaxThreads);
+    parallelFor(names.size(), 0, [&](unsigned worker, size_t i) {
+        if (cancelled()) {
+            return;
+        }
+        Stats::add(Stats::OpenCalls);
+        int fd = openat(cwdFd, names[i].c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd >= 0) {
+            // 文件创建成功，不需要额外输出（符合 Unix touch 命令的行为）
+            close(fd);
+        } else {
+            errors[worker].push_back(CreateError{i, errno});
+        }
+        if (control != nullptr) {
+            control->addEntries(1);
+        }
+    });
+
+    printCreateErrors(out, errors, [&](const CreateError &e) {
+        if (e.error == EEXIST) {
+            fail() << "File already exists: " << names[e.index] << '\n';
+        } else {
+            fail() << "Failed to create file: " << names[e.index] << ": " << std::strerror(e.error) << '\n';
+        }
+    });
+    if (cancelled()) {
+        fail() << "Cancelled\n";
     }
-    
-    // 创建空文件
-    // 使用 ofstream 创建文件，如果文件不存在会自动创建
-    std::ofstream file(filePath);
-    if (file.is_open()) {
-        file.close();
-        // 文件创建成功，不需要额外输出（符合 Unix touch 命令的行为）
-    } else {
-        std::cout << "Failed to create file: " << filename << std::endl;
+}
+
+// 辅助函数：mkdir -p 的单个目录，父目录不存在时先逐级创建；已存在的目录不算错误
+// @return 成功返回 0，否则返回 errno
+static int makeDirectories(int dirFd, const std::string &path) {
+    if (mkdirat(dirFd, path.c_str(), 0777) == 0) {
+        return 0;
     }
+    int error = errno;
+    if (error == EEXIST) {
+        struct stat st;
+        Stats::add(Stats::StatCalls);
+        if (fstatat(dirFd, path.c_str(), &st, 0) == 0 && S_ISDIR(st.st_mode)) {
+            return 0;
+        }
+        return EEXIST;
+    }
+    if (error != ENOENT) {
+        return error;
+    }
+    size_t slash = path.find_last_not_of('/');
+    slash = slash == std::string::npos ? std::string::npos : path.rfind('/', slash);
+    if (slash == std::string::npos || slash == 0) {
+        return error;
+    }
+    int parentError = makeDirectories(dirFd, path.substr(0, slash));
+    if (parentError != 0) {
+        return parentError;
+    }
+    // 父目录已就绪；其他线程可能刚好也创建了这个目录
+    if (mkdirat(dirFd, path.c_str(), 0777) == 0 || errno == EEXIST) {
+        return 0;
+    }
+    return errno;
 }
 
-void MiniFileExplorer::cmdMkdir(const std::vector<std::string>& args) {
+void MiniFileExplorer::cmdMkdir(const ArgList &args) {
     // ========== 文件/文件夹创建：mkdir 命令（10分）==========
-    // 输入 mkdir [文件夹名] 创建空文件夹
+    // 输入 mkdir [文件夹名...] 创建空文件夹，支持花括号展开（如 mkdir d{1..100}）
     // 若文件夹已存在，提示 "Directory already exists: [文件夹名]"
+    // 选项: -p (逐级创建不存在的上级目录，已存在的目录不算错误)
+    //
+    // 每个目录只需一次 mkdirat（已存在时返回 EEXIST，检查和创建是同一个系统调用）。
+    // 按路径层数分批，浅的先创建，同一批内由 parallelFor 并行创建，
+    // 因此 mkdir a a/b 这样依赖前一个参数的写法也能成功
+
+    bool parents = false;
+    std::vector<std::string> names;
+    for (const auto &arg : args) {
+        if (arg == "-p") {
+            parents = true;
+        } else if (!expandName(tokenizer, arg, names)) {
+            fail() << "Too many names: at most " << kMaxCreateNames << " directories per command\n";
+            return;
+        }
+    }
     
     // 检查参数
-    if (args.empty()) {
-        std::cout << "Missing directory name: Please enter 'mkdir [dirname]'" << std::endl;
+    if (names.empty()) {
+        fail() << "Missing directory name: Please enter 'mkdir [dirname]'\n";
         return;
     }
-    
-    std::string dirname = args[0];
-    std::filesystem::path dirPath;
-    
-    // 处理路径（相对路径或绝对路径）
-    if (std::filesystem::path(dirname).is_absolute()) {
-        // 绝对路径：直接使用
-        dirPath = std::filesystem::path(dirname);
-    } else {
-        // 相对路径：基于当前目录构建完整路径
-        dirPath = currentPath / dirname;
+
+    // 按层数（路径中 '/' 分隔的非空部分数）分批
+    std::vector<std::pair<size_t, size_t>> order;  // (层数, 下标)
+    order.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        size_t components = 0;
+        bool inName = false;
+        for (char c : names[i]) {
+            if (c != '/' && !inName) {
+                components++;
+            }
+            inName = c != '/';
+        }
+        order.emplace_back(components, i);
     }
-    
-    // 规范化路径
-    dirPath = std::filesystem::absolute(dirPath);
-    
-    // 检查目录是否已存在
-    if (std::filesystem::exists(dirPath)) {
-        std::cout << "Directory already exists: " << dirname << std::endl;
-        return;
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    int cwdFd = workingDir.fd();
+    std::vector<std::vector<CreateError>> errors(kParallelMaxThreads);
+    for (size_t begin = 0; begin < order.size() && !cancelled();) {
+        size_t end = begin;
+        while (end < order.size() && order[end].first == order[begin].first) {
+            end++;
+        }
+        parallelFor(end - begin, 0, [&](unsigned worker, size_t k) {
+            if (cancelled()) {
+                return;
+            }
+            size_t i = order[begin + k].second;
+            int error = 0;
+            if (parents) {
+                error = makeDirectories(cwdFd, names[i]);
+            } else {
+                error = mkdirat(cwdFd, names[i].c_str(), 0777) == 0 ? 0 : errno;
+            }
+            if (error != 0) {
+                errors[worker].push_back(CreateError{i, error});
+            }
+            if (control != nullptr) {
+                control->addEntries(1);
+            }
+        });
+        begin = end;
     }
-    
-    // 创建目录
-    // create_directories 可以创建多级目录，create_directory 只能创建单级目录
-    // 这里使用 create_directory，因为项目要求是创建"空文件夹"
-    if (std::filesystem::create_directory(dirPath)) {
-        // 目录创建成功，不需要额外输出（符合 Unix mkdir 命令的行为）
-    } else {
-        std::cout << "Failed to create directory: " << dirname << std::endl;
+
+    printCreateErrors(out, errors, [&](const CreateError &e) {
+        if (e.error == EEXIST && !parents) {
+            fail() << "Directory already exists: " << names[e.index] << '\n';
+        } else {
+            fail() << "Failed to create directory: " << names[e.index] << ": " << std::strerror(e.error) << '\n';
+        }
+    });
+    if (cancelled()) {
+        fail() << "Cancelled\n";
     }
 }
 
-void MiniFileExplorer::cmdRm(const std::vector <std::string> &args) {
+void MiniFileExplorer::cmdRm(const ArgList &args) {
     // ========== 文件删除：rm 命令 ==========
     // 输入 rm [文件名] 删除指定文件，删除前需二次确认
-    
+    // 选项: -r (删除目录及其全部内容，只确认一次), -j N (-r 时使用 N 个线程)
+    //
+    // rm -r 用 TreeRemover 并行删除：多个线程同时 unlinkat，目录在内容删除完后自底向上删除；
+    // 前台交互时每秒输出一次进度（已处理的条目数和这一秒的速度）
+
+    std::string filename;
+    bool recursive = false;
+    TreeRemoveOptions removeOptions;
+
+    // 解析选项
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-r") {
+            recursive = true;
+        } else if (args[i] == "-j") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing thread count: Please enter 'rm -r -j N [dirname]'\n";
+                return;
+            }
+            i++;
+            unsigned long long threads = 0;
+            if (!parseNumber(args[i], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count: " << args[i] << '\n';
+                return;
+            }
+            removeOptions.threads = static_cast<unsigned>(threads);
+        } else if (filename.empty()) {
+            filename = args[i];
+        } else {
+            fail() << "Unexpected argument: " << args[i] << '\n';
+            return;
+        }
+    }
+
     // 检查参数
-    if (args.empty()) {
-        std::cout << "Missing filename: Please enter 'rm [filename]'" << std::endl;
+    if (filename.empty()) {
+        fail() << "Missing filename: Please enter 'rm [filename]'\n";
         return;
     }
     
-    std::string filename = args[0];
-    std::filesystem::path filePath;
-    
-    // 处理路径（相对路径或绝对路径）
-    if (std::filesystem::path(filename).is_absolute()) {
-        // 绝对路径：直接使用
-        filePath = std::filesystem::path(filename);
-    } else {
-        // 相对路径：基于当前目录构建完整路径
-        filePath = currentPath / filename;
+    // 检查文件是否存在（符号链接本身也算）
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(workingDir.fd(), filename.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        fail() << "File not found: " << filename << '\n';
+        return;
     }
-    
-    // 规范化路径
-    filePath = std::filesystem::absolute(filePath);
-    
-    // 检查文件是否存在
-    if (!std::filesystem::exists(filePath)) {
-        std::cout << "File not found: " << filename << std::endl;
+
+    if (recursive && S_ISDIR(st.st_mode)) {
+        // ========== 删除整个目录树 ==========
+        // 不能删除当前目录或它的上级目录
+        std::error_code ec;
+        std::string target = std::filesystem::canonical(resolvePath(filename), ec).string();
+        std::string current = currentPath.string();
+        if (!ec && (current == target || current.compare(0, target.size() + 1, target + "/") == 0 || target == "/")) {
+            fail() << "Cannot delete the current directory or one of its parents: " << filename << '\n';
+            return;
+        }
+
+        // 只确认一次（-y 模式下跳过）
+        if (!confirm("Are you sure to delete " + filename + " and everything in it?")) {
+            return;
+        }
+
+        removeOptions.control = control;
+        auto startTime = std::chrono::steady_clock::now();
+
+        // 前台交互：removeTree 在当前线程运行，另一个线程定时读取计数输出进度（后台任务由 jobs 显示进度）
+        JobControl progress;
+        std::mutex progressMutex;
+        std::condition_variable progressDone;
+        bool removed = false;
+        std::thread reporter;
+        if (control == nullptr && interactive) {
+            removeOptions.control = &progress;
+            reporter = std::thread([&]() {
+                std::unique_lock<std::mutex> lock(progressMutex);
+                uint64_t lastEntries = 0;
+                auto lastTime = startTime;
+                while (!progressDone.wait_for(lock, std::chrono::seconds(1), [&]() { return removed; })) {
+                    uint64_t entries = progress.entries.load(std::memory_order_relaxed);
+                    auto now = std::chrono::steady_clock::now();
+                    double interval = std::chrono::duration<double>(now - lastTime).count();
+                    char rate[32];
+                    std::snprintf(rate, sizeof(rate), "%.0f entries/s", (entries - lastEntries) / interval);
+                    out << "Deleting " << filename << ": " << entries << " entries so far (" << rate << ")\n"
+                        << std::flush;
+                    lastEntries = entries;
+                    lastTime = now;
+                }
+            });
+        }
+        TreeRemoveStats stats = removeTree(workingDir.fd(), filename, removeOptions);
+        if (reporter.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                removed = true;
+            }
+            progressDone.notify_one();
+            reporter.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (stats.cancelled) {
+            fail() << "Cancelled after deleting " << stats.files << " files and " << stats.dirs
+                   << " directories; " << filename << " was only partly deleted\n";
+            return;
+        }
+        if (!stats.ok) {
+            fail() << "Failed to delete " << stats.errors << " entries under " << filename
+                   << " (first: " << stats.firstError << ")\n";
+        }
+        char summary[64];
+        double entriesPerSecond = seconds > 0 ? (stats.files + stats.dirs) / seconds : 0;
+        std::snprintf(summary, sizeof(summary), "%.3f s (%.0f entries/s)", seconds, entriesPerSecond);
+        out << "Deleted " << stats.files << " files and " << stats.dirs << " directories in " << summary
+            << " with " << stats.threads << " threads\n";
         return;
     }
     
     // 检查是否是文件（而不是目录）
-    if (!std::filesystem::is_regular_file(filePath) && !std::filesystem::is_symlink(filePath)) {
-        std::cout << "Not a file: " << filename << std::endl;
+    if (S_ISDIR(st.st_mode)) {
+        fail() << "Not a file: " << filename << " (use 'rm -r' to delete a directory)\n";
         return;
     }
-    
-    // ========== 二次确认 ==========
-    std::cout << "Are you sure to delete " << filename << "? (y/n): ";
-    std::string confirmation;
-    if (!std::getline(std::cin, confirmation)) {
-        // 如果读取失败，取消操作
+    if (!recursive && !S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode)) {
+        fail() << "Not a file: " << filename << '\n';
         return;
     }
     
-    // 仅输入 "y" 时执行删除，其他输入取消操作
-    if (confirmation == "y") {
-        // 删除文件
-        if (std::filesystem::remove(filePath)) {
-            // 删除成功，不需要额外输出（符合 Unix rm 命令的行为）
-        } else {
-            std::cout << "Failed to delete file: " << filename << std::endl;
-        }
-    } else {
+    // ========== 二次确认（-y 模式下跳过）==========
+    if (!confirm("Are you sure to delete " + filename + "?")) {
         // 取消操作，不需要输出（符合 Unix rm 命令的行为）
+        return;
+    }
+
+    // 删除文件（unlinkat 不会删除目录，确认期间被换成目录时同样失败）
+    if (unlinkat(workingDir.fd(), filename.c_str(), 0) == 0) {
+        // 删除成功，不需要额外输出（符合 Unix rm 命令的行为）
+    } else {
+        fail() << "Failed to delete file: " << filename << '\n';
     }
 }
 
-void MiniFileExplorer::cmdRmdir(const std::vector <std::string> &args) {
+void MiniFileExplorer::cmdRmdir(const ArgList &args) {
     // ========== 目录删除：rmdir 命令 ==========
     // 输入 rmdir [文件夹名] 删除指定空文件夹
     // 若文件夹非空，提示 "Directory not empty: [文件夹名]"
@@ -528,87 +969,42 @@ void MiniFileExplorer::cmdRmdir(const std::vector <std::string> &args) {
     
     // 检查参数
     if (args.empty()) {
-        std::cout << "Missing directory name: Please enter 'rmdir [dirname]'" << std::endl;
+        fail() << "Missing directory name: Please enter 'rmdir [dirname]'\n";
         return;
     }
     
-    std::string dirname = args[0];
-    std::filesystem::path dirPath;
+    std::string dirname(args[0]);
     
-    // 处理路径（相对路径或绝对路径）
-    if (std::filesystem::path(dirname).is_absolute()) {
-        // 绝对路径：直接使用
-        dirPath = std::filesystem::path(dirname);
+    // 删除空目录：unlinkat(AT_REMOVEDIR) 同时检查存在、类型和是否为空，
+    // 根据失败原因给出对应的提示
+    if (unlinkat(workingDir.fd(), dirname.c_str(), AT_REMOVEDIR) == 0) {
+        // 删除成功，不需要额外输出（符合 Unix rmdir 命令的行为）
+    } else if (errno == ENOENT) {
+        fail() << "Directory not found: " << dirname << '\n';
+    } else if (errno == ENOTDIR) {
+        fail() << "Not a directory: " << dirname << '\n';
+    } else if (errno == ENOTEMPTY || errno == EEXIST) {
+        fail() << "Directory not empty: " << dirname << '\n';
     } else {
-        // 相对路径：基于当前目录构建完整路径
-        dirPath = currentPath / dirname;
+        fail() << "Failed to delete directory: " << dirname << '\n';
     }
+}
+
+void MiniFileExplorer::cmdStat(const ArgList &args) {
+    // ========== 文件信息查询：stat 命令（15分）==========
+    // 输入 stat [文件名/文件夹名] 时，显示目标的详细信息：
+    // 类型（文件 / 文件夹）、路径、大小（文件为字节数，文件夹为 "-"）、
+    // 创建时间、修改时间、访问时间
+    // 若目标不存在，提示 "Target not found: [目标名]"
+    // 若输入时未指定目标（仅输入stat），提示 "Missing target: Please enter'stat [name]'"
     
-    // 规范化路径
-    dirPath = std::filesystem::absolute(dirPath);
-    
-    // 检查目录是否存在
-    if (!std::filesystem::exists(dirPath)) {
-        std::cout << "Directory not found: " << dirname << std::endl;
+    // 检查参数
+    if (args.empty()) {
+        fail() << "Missing target: Please enter 'stat [name]'\n";
         return;
     }
     
-    // 检查是否是目录（而不是文件）
-    if (!std::filesystem::is_directory(dirPath)) {
-        std::cout << "Not a directory: " << dirname << std::endl;
-        return;
-    }
-    
-    // 检查目录是否为空
-    if (!std::filesystem::is_empty(dirPath)) {
-        std::cout << "Directory not empty: " << dirname << std::endl;
-        return;
-    }
-    
-    // 删除空目录
-    if (std::filesystem::remove(dirPath)) {
-        // 删除成功，不需要额外输出（符合 Unix rmdir 命令的行为）
-    } else {
-        std::cout << "Failed to delete directory: " << dirname << std::endl;
-    }
-}
-
-// 辅助函数：将文件系统时间转换为格式化的字符串
-std::string formatFileTime(const std::filesystem::file_time_type& fileTime) {
-    try {
-        // 将文件系统时间转换为系统时间
-        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-            fileTime - std::filesystem::file_time_type::clock::now() + 
-            std::chrono::system_clock::now());
-        
-        // 转换为 time_t
-        std::time_t time = std::chrono::system_clock::to_time_t(sctp);
-        
-        // 格式化为字符串：YYYY-MM-DD HH:MM:SS
-        std::tm* timeinfo = std::localtime(&time);
-        char buffer[32];
-        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-        return std::string(buffer);
-    } catch (...) {
-        return "-";
-    }
-}
-
-void MiniFileExplorer::cmdStat(const std::vector <std::string> &args) {
-    // ========== 文件信息查询：stat 命令（15分）==========
-    // 输入 stat [文件名/文件夹名] 时，显示目标的详细信息：
-    // 类型（文件 / 文件夹）、路径、大小（文件为字节数，文件夹为 "-"）、
-    // 创建时间、修改时间、访问时间
-    // 若目标不存在，提示 "Target not found: [目标名]"
-    // 若输入时未指定目标（仅输入stat），提示 "Missing target: Please enter'stat [name]'"
-    
-    // 检查参数
-    if (args.empty()) {
-        std::cout << "Missing target: Please enter 'stat [name]'" << std::endl;
-        return;
-    }
-    
-    std::string targetName = args[0];
+    std::string targetName(args[0]);
     std::filesystem::path targetPath;
     
     // 处理路径（相对路径或绝对路径）
@@ -623,12 +1019,6 @@ void MiniFileExplorer::cmdStat(const std::vector <std::string> &args) {
     // 规范化路径
     targetPath = std::filesystem::absolute(targetPath);
     
-    // 检查目标是否存在
-    if (!std::filesystem::exists(targetPath)) {
-        std::cout << "Target not found: " << targetName << std::endl;
-        return;
-    }
-    
     // 获取目标信息
     std::string type;
     std::string sizeStr;
@@ -636,6 +1026,13 @@ void MiniFileExplorer::cmdStat(const std::vector <std::string> &args) {
     std::string modifyTime = "-";
     std::string accessTime = "-";
     
+#ifdef _WIN32
+    // 检查目标是否存在
+    if (!std::filesystem::exists(targetPath)) {
+        fail() << "Target not found: " << targetName << '\n';
+        return;
+    }
+    
     // 判断类型
     if (std::filesystem::is_directory(targetPath)) {
         type = "文件夹";
@@ -654,16 +1051,11 @@ void MiniFileExplorer::cmdStat(const std::vector <std::string> &args) {
     // 获取修改时间
     try {
         auto modifyTimePoint = std::filesystem::last_write_time(targetPath);
-        modifyTime = formatFileTime(modifyTimePoint);
+        modifyTime = TimeFormatter::format(modifyTimePoint);
     } catch (const std::filesystem::filesystem_error&) {
         modifyTime = "-";
     }
     
-    // 获取创建时间和访问时间
-    // 注意：C++17 的 std::filesystem 不直接支持创建时间和访问时间
-    // 在 Windows 上可以尝试通过其他方式获取，但为了跨平台兼容性，这里显示 "-"
-    // 或者可以使用修改时间作为创建时间的近似值（某些文件系统上创建时间不可用）
-    #ifdef _WIN32
     // Windows 上可以尝试获取创建时间
     try {
         WIN32_FILE_ATTRIBUTE_DATA fileInfo;
@@ -690,93 +1082,1465 @@ void MiniFileExplorer::cmdStat(const std::vector <std::string> &args) {
     } catch (...) {
         // 如果获取失败，保持默认值 "-"
     }
-    #else
-    // Linux/Mac 上，使用 stat() 系统调用获取访问时间
-    try {
-        struct stat fileStat;
-        if (stat(targetPath.string().c_str(), &fileStat) == 0) {
-            // 获取访问时间
-            std::time_t accessTime_t = fileStat.st_atime;
-            std::tm* timeinfo = std::localtime(&accessTime_t);
-            char buffer[32];
-            std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-            accessTime = std::string(buffer);
-            
-            // 在某些文件系统上，创建时间（birth time）可能可用
-            // 但为了兼容性，这里不尝试获取，保持 "-"
-            // 如果需要，可以使用 statx() 系统调用（Linux 4.11+）
-        }
-    } catch (...) {
-        // 如果获取失败，保持默认值 "-"
+#else
+    // Linux/Mac 上调用一次 stat()，类型、大小、修改/访问时间都来自同一个结果
+    // 不查目录缓存：读取文件只改变访问时间，不会使缓存失效，缓存中的访问时间可能已经过时
+    // 创建时间（birth time）在某些文件系统上不可用，为了兼容性保持 "-"
+    EntryTable::Row info;
+    bool found = EntryTable::statAt(workingDir.fd(), targetName.c_str(), info);
+    
+    // 检查目标是否存在（失效的符号链接视为不存在）
+    if (!found || info.type == EntryTable::Type::Unknown) {
+        fail() << "Target not found: " << targetName << '\n';
+        return;
     }
-    #endif
+    
+    // 判断类型
+    if (info.type == EntryTable::Type::Dir) {
+        type = "文件夹";
+        sizeStr = "-";
+    } else {
+        type = "文件";
+        sizeStr = std::to_string(info.size);
+    }
+    modifyTime = TimeFormatter::format(TimeFormatter::fromNanoseconds(info.mtimeNs));
+    accessTime = TimeFormatter::format(TimeFormatter::fromNanoseconds(info.atimeNs));
+#endif
     
     // 显示详细信息
-    std::cout << "\n=== File/Directory Information ===" << std::endl;
-    std::cout << "Type:        " << type << std::endl;
-    std::cout << "Path:        " << targetPath.string() << std::endl;
-    std::cout << "Size:        " << sizeStr << (type == "文件" ? " bytes" : "") << std::endl;
-    std::cout << "Create Time: " << createTime << std::endl;
-    std::cout << "Modify Time: " << modifyTime << std::endl;
-    std::cout << "Access Time: " << accessTime << std::endl;
-    std::cout << std::endl;
+    out << "\n=== File/Directory Information ===\n";
+    out << "Type:        " << type << '\n';
+    out << "Path:        " << targetPath.string() << '\n';
+    out << "Size:        " << sizeStr << (type == "文件" ? " bytes" : "") << '\n';
+    out << "Create Time: " << createTime << '\n';
+    out << "Modify Time: " << modifyTime << '\n';
+    out << "Access Time: " << accessTime << '\n';
+    out << '\n';
 }
 
-void MiniFileExplorer::cmdSearch(const std::vector <std::string> &args) {
-    // TODO: 实现文件搜索
-    std::cout << "search command - Not implemented yet" << std::endl;
+// 辅助函数：查找覆盖 dir 的索引（dir 本身或其某个上级目录的索引）
+// 找到时 subtree 为 dir 相对索引根目录的路径
+static bool findPathIndex(const std::filesystem::path &dir, PathIndex &index, std::string &subtree) {
+    std::filesystem::path candidate = dir;
+    while (true) {
+        std::string file = PathIndex::indexFileFor(candidate.string());
+        if (!file.empty() && index.open(file) && index.root() == candidate.string()) {
+            subtree = dir.lexically_relative(candidate).generic_string();
+            if (subtree == ".") {
+                subtree.clear();
+            }
+            return true;
+        }
+        if (candidate == candidate.root_path() || !candidate.has_parent_path()) {
+            return false;
+        }
+        candidate = candidate.parent_path();
+    }
 }
 
-void MiniFileExplorer::cmdCp(const std::vector <std::string> &args) {
-    // TODO: 实现文件复制
-    std::cout << "cp command - Not implemented yet" << std::endl;
+void MiniFileExplorer::cmdSearch(const ArgList &args) {
+    // ========== 文件搜索：search 命令 ==========
+    // 输入 search [关键词] 在当前目录（含子目录）中查找名称包含关键词的文件和文件夹
+    // 结果显示相对当前目录的路径，文件夹后加 /
+    // 选项: -i (忽略大小写)
+    // 谓词: -name GLOB, -regex RE, -type f|d|l, -size [+|-]N[K|M|G|T], -mtime [+|-]N,
+    //       -maxdepth N, -prune GLOB（见 SearchFilter）
+    //
+    // 只有关键词、并且当前目录或其上级目录建立过索引（index build）时，直接查询索引；
+    // 否则流式遍历目录树，边找边输出
+
+    SearchFilter filter;
+    std::string error;
+    if (!filter.parse(args, error)) {
+        fail() << error << '\n';
+        return;
+    }
+    if (filter.empty()) {
+        fail() << "Missing keyword: Please enter 'search [keyword]'\n";
+        return;
+    }
+    const std::string &keyword = filter.keyword();
+
+    uint64_t found = 0;
+    PathIndex index;
+    std::string subtree;
+    if (filter.keywordOnly() && findPathIndex(currentPath, index, subtree)) {
+        // ========== 使用索引查询 ==========
+        size_t prefix = subtree.empty() ? 0 : subtree.size() + 1;
+        found = index.search(keyword, filter.ignoreCase(), subtree, [&](const std::string &path, bool isDir) {
+            out << path.substr(prefix) << (isDir ? "/" : "") << '\n';
+        });
+    } else {
+        // ========== 没有索引：流式遍历目录树 ==========
+        // 名称条件直接在 getdents 缓冲区上检查（SIMD 子串匹配 / DFA），
+        // 只有通过名称条件、又需要大小或时间的条目才会 stat，被剪掉的目录不会打开，
+        // 每个条目都不分配内存。结果先写入每个线程自己的缓冲区，
+        // 缓冲区满、距上次输出超过 50ms 或第一次命中时输出，
+        // 因此第一个结果马上就能看到，内存占用也不随目录树大小增长
+        WalkOptions options;
+        filter.apply(options);
+        options.control = control;
+        TreeWalker walker(options);
+
+        using Clock = std::chrono::steady_clock;
+        struct alignas(64) WorkerOutput {
+            std::string buffer;
+            uint64_t matches = 0;
+            Clock::time_point lastFlush;
+        };
+        std::vector<WorkerOutput> outputs(walker.threadCount());
+        std::mutex outputMutex;
+        std::atomic<bool> anyFlushed{false};
+
+        auto flush = [&](WorkerOutput &slot) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            out.write(slot.buffer.data(), static_cast<std::streamsize>(slot.buffer.size()));
+            if (interactive) {
+                // 批处理模式下不逐块刷新，由 OutputBuffer 攒满后统一写出
+                out.flush();
+            }
+            slot.buffer.clear();
+            anyFlushed.store(true, std::memory_order_relaxed);
+        };
+
+        walker.walk(workingDir.fd(), ".", [&](WalkEntry &entry) {
+            bool descend = true;
+            if (!filter.matches(entry, descend)) {
+                return descend;
+            }
+            WorkerOutput &slot = outputs[entry.worker];
+            slot.matches++;
+            entry.appendRelativePath(slot.buffer);
+            if (entry.isDir) {
+                slot.buffer.push_back('/');
+            }
+            slot.buffer.push_back('\n');
+
+            Clock::time_point now = Clock::now();
+            if (slot.buffer.size() >= 16384 || !anyFlushed.load(std::memory_order_relaxed) ||
+                now - slot.lastFlush >= std::chrono::milliseconds(50)) {
+                flush(slot);
+                slot.lastFlush = now;
+            }
+            return true;
+        });
+
+        for (auto &slot : outputs) {
+            if (!slot.buffer.empty()) {
+                flush(slot);
+            }
+            found += slot.matches;
+        }
+    }
+
+    if (cancelled()) {
+        fail() << "Cancelled after " << found << " result(s)\n";
+        return;
+    }
+    if (found == 0 && keyword.empty()) {
+        out << "No matching files found\n";
+    } else if (found == 0) {
+        out << "No matching files found: " << keyword << '\n';
+    } else {
+        out << "Found " << found << " result(s)\n";
+    }
 }
 
-void MiniFileExplorer::cmdMv(const std::vector <std::string> &args) {
-    // TODO: 实现文件移动
-    std::cout << "mv command - Not implemented yet" << std::endl;
+void MiniFileExplorer::cmdGrep(const ArgList &args) {
+    // ========== 文件内容搜索：grep 命令 ==========
+    // 输入 grep [关键词] [文件或目录名] 查找内容包含关键词的行（不指定时为当前目录）
+    // 结果格式为 "路径:行号:内容"，路径相对当前目录，同一文件的结果按行号顺序输出
+    // 选项: -i (忽略大小写), -j N (使用 N 个线程)
+    //
+    // 目录用 TreeWalker 并行遍历，只扫描普通文件（不跟随符号链接），二进制文件跳过；
+    // 每个文件的扫描方式见 ContentScanner（小文件 read、大文件分窗口 mmap、管道按块 read）
+
+    WalkOptions options;
+    std::string_view pattern;
+    std::string target;
+    bool havePattern = false;
+    bool ignoreCase = false;
+
+    // 解析选项
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-i") {
+            ignoreCase = true;
+        } else if (args[i] == "-j") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing thread count: Please enter 'grep -j N [pattern] [path]'\n";
+                return;
+            }
+            i++;
+            unsigned long long threads = 0;
+            if (!parseNumber(args[i], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count: " << args[i] << '\n';
+                return;
+            }
+            options.threads = static_cast<unsigned>(threads);
+        } else if (!havePattern) {
+            pattern = args[i];
+            havePattern = true;
+        } else if (target.empty()) {
+            target = args[i];
+        } else {
+            fail() << "Unexpected argument: " << args[i] << '\n';
+            return;
+        }
+    }
+
+    if (!havePattern) {
+        fail() << "Missing pattern: Please enter 'grep [pattern] [path]'\n";
+        return;
+    }
+    if (target.empty()) {
+        target = ".";
+    }
+
+    struct stat targetStat;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(workingDir.fd(), target.c_str(), &targetStat, 0) != 0) {
+        fail() << "File or directory not found: " << target << '\n';
+        return;
+    }
+
+    NameMatcher matcher(pattern, ignoreCase);
+    std::mutex outputMutex;
+    std::atomic<bool> anyFlushed{false};
+    auto flush = [&](std::string &text) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (interactive) {
+            out.flush();
+        }
+        text.clear();
+        anyFlushed.store(true, std::memory_order_relaxed);
+    };
+
+    uint64_t lines = 0;
+    uint64_t files = 0;
+    uint64_t binary = 0;
+    uint64_t unreadable = 0;
+
+    if (!S_ISDIR(targetStat.st_mode)) {
+        // ========== 单个文件（也可以是管道，如 /dev/stdin）==========
+        ContentScanner scanner(matcher, control, flush);
+        ContentScanner::Status status = scanner.scanAt(workingDir.fd(), target.c_str(), target);
+        if (status == ContentScanner::Status::Failed) {
+            fail() << "Cannot read file: " << target << ": " << std::strerror(errno) << '\n';
+            return;
+        }
+        if (!scanner.output().empty()) {
+            flush(scanner.output());
+        }
+        lines = scanner.matchedLines();
+        files = scanner.matchedFiles();
+        binary = status == ContentScanner::Status::Binary ? 1 : 0;
+    } else {
+        // ========== 目录：并行遍历 ==========
+        // 每个线程一个扫描器和输出缓冲区，输出时机与 search 相同：
+        // 缓冲区满、第一次命中或距上次输出超过 50ms
+        options.statEntries = false;
+        options.control = control;
+        TreeWalker walker(options);
+
+        using Clock = std::chrono::steady_clock;
+        struct alignas(64) Worker {
+            ContentScanner scanner;
+            std::string path;
+            Clock::time_point lastFlush;
+            uint64_t binary = 0;
+            uint64_t unreadable = 0;
+        };
+        std::vector<Worker> workers;
+        workers.reserve(walker.threadCount());
+        for (unsigned i = 0; i < walker.threadCount(); i++) {
+            workers.push_back(Worker{ContentScanner(matcher, control, flush), std::string(), Clock::time_point(), 0, 0});
+        }
+
+        // 显示的路径相对当前目录
+        std::string prefix;
+        if (target != ".") {
+            prefix = target;
+            while (prefix.size() > 1 && prefix.back() == '/') {
+                prefix.pop_back();
+            }
+            if (prefix.back() != '/') {
+                prefix.push_back('/');
+            }
+        }
+
+        WalkStats walkStats = walker.walk(workingDir.fd(), target, [&](WalkEntry &entry) {
+            if (entry.isDir) {
+                return true;
+            }
+            if (entry.type == DT_UNKNOWN) {
+                entry.stat();
+            }
+            if (entry.type != DT_REG) {
+                return true;
+            }
+
+            Worker &worker = workers[entry.worker];
+            worker.path.assign(prefix);
+            entry.appendRelativePath(worker.path);
+            ContentScanner::Status status = worker.scanner.scanAt(entry.dirFd, entry.name.data(), worker.path);
+            if (status == ContentScanner::Status::Binary) {
+                worker.binary++;
+            } else if (status == ContentScanner::Status::Failed) {
+                worker.unreadable++;
+            }
+
+            std::string &text = worker.scanner.output();
+            if (!text.empty()) {
+                Clock::time_point now = Clock::now();
+                if (!anyFlushed.load(std::memory_order_relaxed) || now - worker.lastFlush >= std::chrono::milliseconds(50)) {
+                    flush(text);
+                    worker.lastFlush = now;
+                }
+            }
+            return true;
+        });
+
+        if (!walkStats.rootOk) {
+            fail() << "Cannot open directory: " << target << ": " << std::strerror(walkStats.rootErrno) << '\n';
+            return;
+        }
+        for (auto &worker : workers) {
+            if (!worker.scanner.output().empty()) {
+                flush(worker.scanner.output());
+            }
+            lines += worker.scanner.matchedLines();
+            files += worker.scanner.matchedFiles();
+            binary += worker.binary;
+            unreadable += worker.unreadable;
+        }
+        unreadable += walkStats.errors;
+    }
+
+    if (cancelled()) {
+        fail() << "Cancelled after " << lines << " matching line(s)\n";
+        return;
+    }
+    if (lines == 0) {
+        out << "No matches found: " << pattern << '\n';
+    } else {
+        out << "Found " << lines << " matching line(s) in " << files << " file(s)\n";
+    }
+    if (binary > 0) {
+        out << "Skipped " << binary << " binary file(s)\n";
+    }
+    if (unreadable > 0) {
+        out << "Could not read " << unreadable << " file(s) or directories\n";
+    }
 }
 
-void MiniFileExplorer::cmdDu(const std::vector <std::string> &args) {
-    // TODO: 实现目录大小计算
-    std::cout << "du command - Not implemented yet" << std::endl;
+void MiniFileExplorer::cmdIndex(const ArgList &args) {
+    // ========== 文件名索引：index 命令 ==========
+    // index build [目录]  为目录建立索引（已有索引时只重新读取 mtime 变化的目录）
+    // index info [目录]   显示目录的索引信息
+    // 不指定目录时为当前目录
+
+    if (args.empty() || (args[0] != "build" && args[0] != "info")) {
+        fail() << "Usage: index build [dirname] | index info [dirname]\n";
+        return;
+    }
+
+    std::string dirname(args.size() > 1 ? args[1] : ".");
+    std::filesystem::path dirPath;
+    if (std::filesystem::path(dirname).is_absolute()) {
+        // 绝对路径：直接使用
+        dirPath = std::filesystem::path(dirname);
+    } else {
+        // 相对路径：基于当前目录构建完整路径
+        dirPath = currentPath / dirname;
+    }
+
+    // 检查目录是否存在
+    if (!std::filesystem::exists(dirPath)) {
+        fail() << "Directory not found: " << dirname << '\n';
+        return;
+    }
+
+    // 检查是否是目录（而不是文件）
+    if (!std::filesystem::is_directory(dirPath)) {
+        fail() << "Not a directory: " << dirname << '\n';
+        return;
+    }
+
+    // 索引以规范化路径为键，保证同一目录不同写法对应同一份索引
+    std::string root = std::filesystem::canonical(dirPath).string();
+
+    if (args[0] == "info") {
+        PathIndex index;
+        if (!index.open(PathIndex::indexFileFor(root))) {
+            fail() << "No index for: " << dirname << '\n';
+            return;
+        }
+        char buffer[TimeFormatter::kBufferSize];
+        TimeFormatter::format(static_cast<std::time_t>(index.builtAt()), buffer);
+        out << "Root:        " << index.root() << '\n';
+        out << "Directories: " << index.dirCount() << '\n';
+        out << "Entries:     " << index.entryCount() << '\n';
+        out << "Built:       " << buffer << '\n';
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    PathIndex::BuildResult result = PathIndex::build(root);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (!result.ok) {
+        fail() << "Failed to build index: " << dirname << ": " << result.error << '\n';
+        return;
+    }
+
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+    out << "Indexed " << result.entries << " entries in " << result.dirs << " directories ("
+        << result.rescanned << " scanned, " << result.reused << " unchanged) in "
+        << elapsed << " s\n";
 }
 
-void MiniFileExplorer::printHelp() {
-    std::cout << "\n=== MiniFileExplorer Commands ===\n" << std::endl;
-    std::cout << "cd [path]          - Switch to target directory" << std::endl;
-    std::cout << "ls [options]       - List all files and directories" << std::endl;
-    std::cout << "                   - Options: -s (sort by size), -t (sort by time)" << std::endl;
-    std::cout << "touch [filename]   - Create an empty file" << std::endl;
-    std::cout << "mkdir [dirname]    - Create a directory" << std::endl;
-    std::cout << "rm [filename]      - Delete a file" << std::endl;
-    std::cout << "rmdir [dirname]    - Delete an empty directory" << std::endl;
-    std::cout << "stat [name]        - Show detailed information" << std::endl;
-    std::cout << "search [keyword]   - Search files/directories" << std::endl;
-    std::cout << "cp [src] [dst]     - Copy a file" << std::endl;
-    std::cout << "mv [src] [dst]     - Move/rename a file or directory" << std::endl;
-    std::cout << "du [dirname]       - Calculate directory size" << std::endl;
-    std::cout << "help               - Show this help message" << std::endl;
-    std::cout << "exit               - Exit the program" << std::endl;
-    std::cout << std::endl;
+void MiniFileExplorer::cmdSnapshot(const ArgList &args) {
+    // ========== 目录树快照：snapshot 命令 ==========
+    // snapshot save <目录> <文件> [-j N] [-x]  记录目录树中每个条目的元数据（见 TreeSnapshot）
+    // snapshot diff <旧文件> <新文件>          列出两次快照之间的变化：
+    //                                          A 添加、D 删除、M 修改、R 改名（同一 inode）
+    // snapshot info <文件>                     显示快照信息
+    // 快照文件的相对路径基于当前目录
+
+    const char *usage = "Usage: snapshot save <dirname> <file> [-j N] [-x] | snapshot diff <old> <new> | "
+                        "snapshot info <file>\n";
+    if (args.empty()) {
+        fail() << usage;
+        return;
+    }
+    auto filePath = [this](std::string_view name) {
+        std::filesystem::path path{std::string(name)};
+        return path.is_absolute() ? path.string() : (currentPath / path).string();
+    };
+    auto openSnapshot = [&](TreeSnapshot &snapshot, std::string_view name) {
+        if (!snapshot.open(filePath(name))) {
+            fail() << "Not a snapshot file: " << name << '\n';
+            return false;
+        }
+        return true;
+    };
+
+    if (args[0] == "info" && args.size() == 2) {
+        TreeSnapshot snapshot;
+        if (!openSnapshot(snapshot, args[1])) {
+            return;
+        }
+        char buffer[TimeFormatter::kBufferSize];
+        TimeFormatter::format(static_cast<std::time_t>(snapshot.savedAt()), buffer);
+        out << "Root:    " << snapshot.root() << '\n';
+        out << "Entries: " << snapshot.entryCount() << '\n';
+        out << "Saved:   " << buffer << '\n';
+        return;
+    }
+
+    if (args[0] == "diff" && args.size() == 3) {
+        TreeSnapshot before;
+        TreeSnapshot after;
+        if (!openSnapshot(before, args[1]) || !openSnapshot(after, args[2])) {
+            return;
+        }
+        auto display = [](const TreeSnapshot::Entry &entry) {
+            return S_ISDIR(entry.mode) ? std::string(entry.path) + "/" : std::string(entry.path);
+        };
+        auto startTime = std::chrono::steady_clock::now();
+        TreeSnapshot::DiffResult result = TreeSnapshot::diff(before, after,
+            [&](TreeSnapshot::Change change, const TreeSnapshot::Entry &oldEntry,
+                const TreeSnapshot::Entry &newEntry) {
+                switch (change) {
+                case TreeSnapshot::Change::Added:
+                    out << "A  " << display(newEntry) << '\n';
+                    break;
+                case TreeSnapshot::Change::Removed:
+                    out << "D  " << display(oldEntry) << '\n';
+                    break;
+                case TreeSnapshot::Change::Modified:
+                    out << "M  " << display(newEntry);
+                    if (oldEntry.size != newEntry.size && !S_ISDIR(newEntry.mode)) {
+                        out << " (" << formatBytes(oldEntry.size) << " -> " << formatBytes(newEntry.size) << ')';
+                    }
+                    out << '\n';
+                    break;
+                case TreeSnapshot::Change::Renamed:
+                    out << "R  " << display(oldEntry) << " -> " << display(newEntry) << '\n';
+                    break;
+                }
+            });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (!result.ok) {
+            fail() << "Failed to compare snapshots: " << result.error << '\n';
+            return;
+        }
+        char elapsed[32];
+        std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+        out << result.added << " added, " << result.removed << " removed, " << result.modified << " modified, "
+            << result.renamed << " renamed (" << result.oldEntries << " -> " << result.newEntries
+            << " entries compared in " << elapsed << " s)\n";
+        return;
+    }
+
+    if (args[0] != "save") {
+        fail() << usage;
+        return;
+    }
+
+    // 解析 save 的选项
+    WalkOptions options;
+    std::vector<std::string> operands;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "-j") {
+            unsigned long long threads = 0;
+            if (i + 1 >= args.size() || !parseNumber(args[i + 1], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count for -j\n";
+                return;
+            }
+            options.threads = static_cast<unsigned>(threads);
+            i++;
+        } else if (args[i] == "-x") {
+            options.oneFileSystem = true;
+        } else {
+            operands.emplace_back(args[i]);
+        }
+    }
+    if (operands.size() != 2) {
+        fail() << usage;
+        return;
+    }
+    const std::string &dirname = operands[0];
+
+    struct stat dirStat;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(workingDir.fd(), dirname.c_str(), &dirStat, 0) != 0) {
+        fail() << "Directory not found: " << dirname << '\n';
+        return;
+    }
+    if (!S_ISDIR(dirStat.st_mode)) {
+        fail() << "Not a directory: " << dirname << '\n';
+        return;
+    }
+    std::filesystem::path dirPath(filePath(dirname));
+    std::error_code ec;
+    std::string root = std::filesystem::canonical(dirPath, ec).string();
+    if (ec) {
+        root = dirPath.lexically_normal().string();
+    }
+
+    options.control = control;
+    auto startTime = std::chrono::steady_clock::now();
+    TreeSnapshot::SaveResult result =
+        TreeSnapshot::save(workingDir.fd(), dirname, root, filePath(operands[1]), options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (result.cancelled) {
+        fail() << "Cancelled; snapshot not written\n";
+        return;
+    }
+    if (!result.ok) {
+        fail() << "Failed to save snapshot: " << dirname << ": " << result.error << '\n';
+        return;
+    }
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+    out << "Saved " << result.entries << " entries (" << formatBytes(result.bytes) << ") to " << operands[1]
+        << " in " << elapsed << " s with " << result.threads << " threads\n";
+    if (result.errors > 0) {
+        out << "Could not read " << result.errors << " entries (not in the snapshot)\n";
+    }
 }
 
-void MiniFileExplorer::cmdExit() {
-    std::cout << "MiniFileExplorer closed successfully" << std::endl;
-    exit(0);
+void MiniFileExplorer::cmdCp(const ArgList &args) {
+    // ========== 文件复制：cp 命令 ==========
+    // 输入 cp [源文件] [目标路径] 复制文件
+    // 目标是已存在的目录时，复制到该目录下（文件名不变）
+    // 目标文件已存在时不覆盖，提示 "Target already exists: [目标]"
+    //
+    // 复制由 CopyEngine 完成：依次尝试 reflink、copy_file_range、sendfile、
+    // read/write，完成后显示使用的方式和速度
+    //
+    // cp -r [源目录] [目标路径] 复制整个目录树（TreeCopier 流水线，支持时使用 io_uring）
+    // 选项: -r (复制目录), -j N (复制线程数)
+
+    bool recursive = false;
+    TreeCopyOptions treeOptions;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-r" || args[i] == "-R") {
+            recursive = true;
+        } else if (args[i] == "-j") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing thread count: Please enter 'cp -r -j N [src] [dst]'\n";
+                return;
+            }
+            i++;
+            unsigned long long threads = 0;
+            if (!parseNumber(args[i], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count: " << args[i] << '\n';
+                return;
+            }
+            treeOptions.threads = static_cast<unsigned>(threads);
+        } else if (paths.size() < 2) {
+            paths.emplace_back(args[i]);
+        } else {
+            fail() << "Unexpected argument: " << args[i] << '\n';
+            return;
+        }
+    }
+
+    // 检查参数
+    if (paths.size() < 2) {
+        fail() << "Missing arguments: Please enter 'cp [src] [dst]'\n";
+        return;
+    }
+
+    const std::string &srcName = paths[0];
+    const std::string &dstName = paths[1];
+    // 系统调用都使用用户输入的路径，相对当前目录的 fd 解析；resolvePath 只用于显示和比较
+    int cwdFd = workingDir.fd();
+    std::filesystem::path srcPath(srcName);
+    std::filesystem::path dstPath(dstName);
+
+    // 检查源文件
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(cwdFd, srcName.c_str(), &st, 0) != 0) {
+        fail() << "File not found: " << srcName << '\n';
+        return;
+    }
+    bool srcIsDir = S_ISDIR(st.st_mode);
+    if (srcIsDir && !recursive) {
+        fail() << "Is a directory: " << srcName << " (use 'cp -r')\n";
+        return;
+    }
+    if (!srcIsDir && !S_ISREG(st.st_mode)) {
+        fail() << "Not a file: " << srcName << '\n';
+        return;
+    }
+
+    // 目标是目录：复制到目录下，保持原名称
+    Stats::add(Stats::StatCalls);
+    if (fstatat(cwdFd, dstName.c_str(), &st, 0) == 0 && S_ISDIR(st.st_mode)) {
+        dstPath /= srcPath.lexically_normal().filename();
+        if (dstPath.filename().empty()) {
+            dstPath = dstPath.parent_path() / resolvePath(srcName).lexically_normal().parent_path().filename();
+        }
+    }
+    Stats::add(Stats::StatCalls);
+    if (fstatat(cwdFd, dstPath.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        fail() << "Target already exists: " << resolvePath(dstPath.string()).string() << '\n';
+        return;
+    }
+
+    if (srcIsDir) {
+        // 不能把目录复制到它自己里面
+        std::error_code ec;
+        std::filesystem::path srcReal = std::filesystem::canonical(resolvePath(srcName), ec);
+        std::filesystem::path dstReal = std::filesystem::weakly_canonical(resolvePath(dstPath.string()), ec);
+        std::string srcText = srcReal.string() + "/";
+        if (dstReal.string().compare(0, srcText.size(), srcText) == 0) {
+            fail() << "Cannot copy a directory into itself: " << srcName << '\n';
+            return;
+        }
+
+        treeOptions.control = control;
+        auto startTime = std::chrono::steady_clock::now();
+        TreeCopyStats stats = copyTree(cwdFd, srcPath.string(), cwdFd, dstPath.string(), treeOptions);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (!stats.ok) {
+            fail() << "Failed to copy directory: " << srcName << ": " << stats.error << '\n';
+            return;
+        }
+        if (stats.cancelled) {
+            fail() << "Cancelled after " << stats.files << " files; " << dstName << " is incomplete\n";
+            return;
+        }
+
+        char summary[96];
+        double filesPerSecond = seconds > 0 ? stats.files / seconds : 0;
+        double mibPerSecond = seconds > 0 ? stats.bytes / seconds / (1024.0 * 1024.0) : 0;
+        std::snprintf(summary, sizeof(summary), "%.3f s (%.0f files/s, %.1f MiB/s)",
+                      seconds, filesPerSecond, mibPerSecond);
+        out << "Copied " << stats.files << " files, " << stats.dirs << " directories, "
+            << stats.symlinks << " symlinks (" << formatBytes(stats.bytes) << ") in " << summary
+            << " using " << stats.backend << " with " << stats.threads << " threads\n";
+        if (stats.skipped > 0) {
+            out << "Skipped " << stats.skipped << " special files\n";
+        }
+        if (stats.errors > 0) {
+            fail() << "Warning: " << stats.errors << " entries could not be copied (first: "
+                      << stats.firstError << ")\n";
+        }
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    CopyResult result = copyFileAt(cwdFd, srcPath.c_str(), cwdFd, dstPath.c_str(), true);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (!result.ok) {
+        fail() << "Failed to copy file: " << srcName << ": " << std::strerror(result.error) << '\n';
+        return;
+    }
+    if (control != nullptr) {
+        control->addBytes(result.bytes);
+    }
+
+    // 显示复制方式和吞吐量
+    char summary[64];
+    double mibPerSecond = seconds > 0 ? result.bytes / seconds / (1024.0 * 1024.0) : 0;
+    std::snprintf(summary, sizeof(summary), "%.3f s (%.1f MiB/s)", seconds, mibPerSecond);
+    out << "Copied " << result.bytes << " bytes (" << formatBytes(result.bytes) << ") via "
+        << copyTierName(result.tier) << " in " << summary << '\n';
 }
 
-// ========== 工具函数 ==========
-std::vector <std::string> split(const std::string &line) {
-    std::vector <std::string> result;
-    std::istringstream iss(line);
-    std::string word;
+void MiniFileExplorer::cmdSync(const ArgList &args) {
+    // ========== 增量同步：sync 命令 ==========
+    // 输入 sync [源目录] [目标目录] 让目标目录与源目录一致（目标不存在时创建）
+    // 大小和 mtime 都相同的文件直接跳过；变化的大文件按块比较，只写入不同的块（见 TreeSync）
+    // 只存在于目标中的条目保留不删除
+    // 选项: -j N (使用 N 个线程)
 
-    // 使用字符串流按空格分割
-    while (iss >> word) {
-        result.push_back(word);
+    TreeSyncOptions options;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-j") {
+            unsigned long long threads = 0;
+            if (i + 1 >= args.size() || !parseNumber(args[i + 1], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count for -j\n";
+                return;
+            }
+            options.threads = static_cast<unsigned>(threads);
+            i++;
+        } else {
+            paths.emplace_back(args[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        fail() << "Missing arguments: Please enter 'sync [src] [dst]'\n";
+        return;
+    }
+    const std::string &srcName = paths[0];
+    const std::string &dstName = paths[1];
+    int cwdFd = workingDir.fd();
+
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(cwdFd, srcName.c_str(), &st, 0) != 0) {
+        fail() << "Directory not found: " << srcName << '\n';
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        fail() << "Not a directory: " << srcName << '\n';
+        return;
+    }
+
+    // 目标不能是源目录本身或在它里面（遍历时会把同步出来的内容再同步一遍）
+    std::error_code ec;
+    std::filesystem::path srcReal = std::filesystem::canonical(resolvePath(srcName), ec);
+    std::filesystem::path dstReal = std::filesystem::weakly_canonical(resolvePath(dstName), ec);
+    std::string srcText = srcReal.string() + "/";
+    if (dstReal == srcReal || dstReal.string().compare(0, srcText.size(), srcText) == 0) {
+        fail() << "Cannot sync a directory into itself: " << srcName << '\n';
+        return;
+    }
+
+    options.control = control;
+    auto startTime = std::chrono::steady_clock::now();
+    TreeSyncStats stats = syncTree(cwdFd, srcName, cwdFd, dstName, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (!stats.ok) {
+        fail() << "Failed to sync: " << srcName << " -> " << dstName << ": " << stats.error << '\n';
+        return;
+    }
+    if (stats.cancelled) {
+        fail() << "Cancelled; " << dstName << " is partially updated\n";
+        return;
     }
 
-    return result;
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+    out << "Synced " << stats.files << " files in " << elapsed << " s with " << stats.threads << " threads: "
+        << stats.unchanged << " unchanged, " << stats.copied << " copied (" << formatBytes(stats.copiedBytes)
+        << "), " << stats.patched << " patched (" << formatBytes(stats.literalBytes) << " written, "
+        << formatBytes(stats.reusedBytes) << " shared)\n";
+    if (stats.dirs > 0 || stats.symlinks > 0) {
+        out << "Created " << stats.dirs << " directories, updated " << stats.symlinks << " symlinks\n";
+    }
+    if (stats.skipped > 0) {
+        out << "Skipped " << stats.skipped << " special files\n";
+    }
+    if (stats.errors > 0) {
+        fail() << "Warning: " << stats.errors << " entries could not be synced (first: " << stats.firstError
+               << ")\n";
+    }
 }
 
+// 辅助函数：不覆盖已有目标的重命名（相对路径基于 dirFd）
+// 优先使用 renameat2(RENAME_NOREPLACE)，由内核保证原子性；
+// 文件系统不支持该标志时，先检查目标是否存在再 rename
+static int renameNoReplace(int dirFd, const char *src, const char *dst) {
+#if defined(__linux__) && defined(RENAME_NOREPLACE)
+    if (renameat2(dirFd, src, dirFd, dst, RENAME_NOREPLACE) == 0) {
+        return 0;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+        return errno;
+    }
+#endif
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(dirFd, dst, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        return EEXIST;
+    }
+    return renameat(dirFd, src, dirFd, dst) == 0 ? 0 : errno;
+}
+
+void MiniFileExplorer::cmdMv(const ArgList &args) {
+    // ========== 文件移动：mv 命令 ==========
+    // 输入 mv [源] [目标] 移动/重命名文件或目录
+    // 输入 mv [源1] [源2] ... [目标目录] 把多个文件/目录移动到同一个目录下
+    // 目标已存在时不覆盖，提示 "Target already exists: [目标]"
+    //
+    // 同一设备上使用 renameat2(RENAME_NOREPLACE)，与文件大小无关，瞬间完成；
+    // 跨设备时先复制（文件用 CopyEngine，目录用 TreeCopier）再删除源
+
+    // 检查参数
+    if (args.size() < 2) {
+        fail() << "Missing arguments: Please enter 'mv [src] [dst]'\n";
+        return;
+    }
+
+    // 系统调用都使用用户输入的路径，相对当前目录的 fd 解析；resolvePath 只用于显示和比较
+    int cwdFd = workingDir.fd();
+    std::string dstName(args.back());
+    std::filesystem::path dstPath(dstName);
+    struct stat dstStat;
+    Stats::add(Stats::StatCalls);
+    bool dstIsDir = fstatat(cwdFd, dstName.c_str(), &dstStat, 0) == 0 && S_ISDIR(dstStat.st_mode);
+
+    // 多个源时，目标必须是已存在的目录
+    if (args.size() > 2 && !dstIsDir) {
+        fail() << "Not a directory: " << dstName << '\n';
+        return;
+    }
+
+    for (size_t i = 0; i + 1 < args.size(); i++) {
+        std::string srcName(args[i]);
+        std::filesystem::path srcPath(srcName);
+
+        // 检查源是否存在（符号链接本身也算）
+        struct stat srcStat;
+        Stats::add(Stats::StatCalls);
+        if (fstatat(cwdFd, srcName.c_str(), &srcStat, AT_SYMLINK_NOFOLLOW) != 0) {
+            fail() << "File not found: " << srcName << '\n';
+            continue;
+        }
+
+        // 目标是目录：移动到目录下，保持原名称
+        std::filesystem::path target = dstPath;
+        if (dstIsDir) {
+            target = dstPath / srcPath.lexically_normal().filename();
+            if (target.filename().empty()) {
+                target = target.parent_path() / resolvePath(srcName).lexically_normal().parent_path().filename();
+            }
+        }
+
+        // 不能把目录移动到它自己里面
+        if (S_ISDIR(srcStat.st_mode)) {
+            std::string srcText = resolvePath(srcName).lexically_normal().string() + "/";
+            if (resolvePath(target.string()).lexically_normal().string().compare(0, srcText.size(), srcText) == 0) {
+                fail() << "Cannot move a directory into itself: " << srcName << '\n';
+                continue;
+            }
+        }
+
+        // ========== 同一设备：直接重命名 ==========
+        int error = renameNoReplace(cwdFd, srcPath.c_str(), target.c_str());
+        if (error == 0) {
+            continue;
+        }
+        if (error == EEXIST || error == ENOTEMPTY) {
+            fail() << "Target already exists: " << resolvePath(target.string()).string() << '\n';
+            continue;
+        }
+        if (error != EXDEV) {
+            fail() << "Failed to move: " << srcName << ": " << std::strerror(error) << '\n';
+            continue;
+        }
+
+        // ========== 跨设备：复制后删除源 ==========
+        auto startTime = std::chrono::steady_clock::now();
+        uint64_t bytes = 0;
+        const char *method = "";
+        if (S_ISDIR(srcStat.st_mode)) {
+            TreeCopyOptions treeOptions;
+            treeOptions.control = control;
+            TreeCopyStats stats = copyTree(cwdFd, srcPath.string(), cwdFd, target.string(), treeOptions);
+            if (!stats.ok || stats.errors > 0 || stats.cancelled) {
+                fail() << "Failed to move: " << srcName << ": "
+                          << (stats.cancelled ? "cancelled" : stats.ok ? stats.firstError : stats.error) << '\n';
+                if (stats.ok) {
+                    // 复制不完整：保留源，删除不完整的副本
+                    removeTree(cwdFd, target.string());
+                }
+                continue;
+            }
+            bytes = stats.bytes;
+            method = stats.backend;
+        } else if (S_ISREG(srcStat.st_mode)) {
+            CopyResult result = copyFileAt(cwdFd, srcPath.c_str(), cwdFd, target.c_str(), true);
+            if (!result.ok) {
+                fail() << "Failed to move: " << srcName << ": " << std::strerror(result.error) << '\n';
+                continue;
+            }
+            bytes = result.bytes;
+            method = copyTierName(result.tier);
+        } else if (S_ISLNK(srcStat.st_mode)) {
+            // 复制符号链接本身（内容是它指向的路径）
+            std::vector<char> link(std::max<size_t>(static_cast<size_t>(srcStat.st_size), PATH_MAX) + 1);
+            ssize_t length = readlinkat(cwdFd, srcPath.c_str(), link.data(), link.size() - 1);
+            if (length >= 0) {
+                link[static_cast<size_t>(length)] = '\0';
+            }
+            if (length < 0 || symlinkat(link.data(), cwdFd, target.c_str()) != 0) {
+                fail() << "Failed to move: " << srcName << ": " << std::strerror(errno) << '\n';
+                continue;
+            }
+            method = "symlink";
+        } else {
+            fail() << "Cannot move special file across devices: " << srcName << '\n';
+            continue;
+        }
+
+        // 目录用 TreeRemover 并行删除，其他条目直接 unlinkat
+        if (S_ISDIR(srcStat.st_mode)) {
+            TreeRemoveOptions removeOptions;
+            removeOptions.control = control;
+            TreeRemoveStats removed = removeTree(cwdFd, srcPath.string(), removeOptions);
+            if (!removed.ok) {
+                fail() << "Copied but failed to remove source: " << srcName << ": "
+                          << (removed.cancelled ? "cancelled" : removed.firstError) << '\n';
+                continue;
+            }
+        } else if (unlinkat(cwdFd, srcPath.c_str(), 0) != 0) {
+            fail() << "Copied but failed to remove source: " << srcName << ": "
+                      << std::strerror(errno) << '\n';
+            continue;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        char elapsed[32];
+        std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+        out << "Moved " << srcName << " across devices (" << formatBytes(bytes) << " via "
+            << method << " in " << elapsed << " s)\n";
+    }
+}
+
+// 辅助函数：按大小降序输出 du 的各子目录合计
+static void printSubdirTotals(std::ostream &out, std::vector<DuCache::Subdir> &subdirs) {
+    if (subdirs.empty()) {
+        return;
+    }
+    std::sort(subdirs.begin(), subdirs.end(),
+        [](const DuCache::Subdir &a, const DuCache::Subdir &b) {
+            return a.bytes > b.bytes;
+        });
+
+    // 打印表头
+    out << std::left << std::setw(16) << "Size(B)"
+        << std::setw(12) << "Size"
+        << std::setw(12) << "Files"
+        << "Name\n";
+    out << std::string(15, '-') << " "
+        << std::string(11, '-') << " "
+        << std::string(11, '-') << " "
+        << std::string(20, '-') << '\n';
+
+    for (const auto &subdir : subdirs) {
+        out << std::left << std::setw(16) << subdir.bytes
+            << std::setw(12) << formatBytes(subdir.bytes)
+            << std::setw(12) << subdir.files
+            << subdir.name << "/\n";
+    }
+}
+
+void MiniFileExplorer::cmdDu(const ArgList &args) {
+    // ========== 目录大小计算：du 命令 ==========
+    // 输入 du [目录名] 计算目录总大小（不指定时为当前目录）
+    // 同时列出每个直接子目录的大小，按大小降序排列
+    // 选项: -j N (使用 N 个线程), -x (不跨越文件系统),
+    //       --incremental (使用上次保存的结果，只重新读取 mtime 变化的目录，见 DuCache)
+    //
+    // 使用 TreeWalker 并行遍历：多线程 work-stealing，
+    // 所有 stat 都相对父目录 fd 进行，硬链接按 (设备号, inode) 只统计一次
+
+    WalkOptions options;
+    std::string dirname;
+    bool incremental = false;
+
+    // 解析选项
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-j") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing thread count: Please enter 'du -j N [dirname]'\n";
+                return;
+            }
+            i++;
+            unsigned long long threads = 0;
+            if (!parseNumber(args[i], threads) || threads == 0 || threads > 1024) {
+                fail() << "Invalid thread count: " << args[i] << '\n';
+                return;
+            }
+            options.threads = static_cast<unsigned>(threads);
+        } else if (args[i] == "-x") {
+            options.oneFileSystem = true;
+        } else if (args[i] == "--incremental") {
+            incremental = true;
+        } else if (dirname.empty()) {
+            dirname = args[i];
+        } else {
+            fail() << "Unexpected argument: " << args[i] << '\n';
+            return;
+        }
+    }
+
+    if (dirname.empty()) {
+        dirname = ".";
+    }
+
+    // 检查目录是否存在（相对当前目录的 fd）
+    struct stat dirStat;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(workingDir.fd(), dirname.c_str(), &dirStat, 0) != 0) {
+        fail() << "Directory not found: " << dirname << '\n';
+        return;
+    }
+
+    // 检查是否是目录（而不是文件）
+    if (!S_ISDIR(dirStat.st_mode)) {
+        fail() << "Not a directory: " << dirname << '\n';
+        return;
+    }
+
+    options.control = control;
+    if (incremental) {
+        // 缓存以规范化路径为键，同一目录不同写法共用一份
+        std::error_code ec;
+        std::string root = std::filesystem::canonical(resolvePath(dirname), ec).string();
+        if (ec) {
+            fail() << "Directory not found: " << dirname << '\n';
+            return;
+        }
+        auto startTime = std::chrono::steady_clock::now();
+        DuCache::Result result = DuCache::update(root, options);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (result.cancelled) {
+            fail() << "Cancelled after scanning " << result.entries << " entries\n";
+            return;
+        }
+        if (!result.ok) {
+            fail() << "Error reading directory: " << dirname << ": " << result.error << '\n';
+            return;
+        }
+
+        printSubdirTotals(out, result.subdirs);
+        out << "Total: " << result.bytes << " bytes (" << formatBytes(result.bytes) << "), "
+            << result.files << " files, " << result.dirs << " directories\n";
+        char elapsed[32];
+        std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+        if (result.fromScratch) {
+            out << "Scanned " << result.entries << " entries in " << elapsed << " s using "
+                << result.threads << " threads (full scan; saved for the next --incremental run)\n";
+        } else {
+            out << "Rescanned " << result.rescanned << " changed directories (" << result.entries
+                << " entries), reused " << result.reused << " unchanged, in " << elapsed << " s using "
+                << result.threads << " threads\n";
+        }
+        if (result.errors > 0) {
+            fail() << "Warning: " << result.errors << " entries could not be read\n";
+        }
+        return;
+    }
+
+    TreeWalker walker(options);
+
+    // 每个直接子目录分配一个编号（tag），其下所有条目都会继承这个编号，
+    // 这样累加时不需要拼接或比较路径。编号 0 表示根目录下的直接文件。
+    struct alignas(64) WorkerTotals {
+        std::vector<uint64_t> bytes;
+        std::vector<uint64_t> files;
+    };
+    std::vector<WorkerTotals> totals(walker.threadCount());
+    std::vector<std::string> subdirNames(1);
+    std::mutex namesMutex;
+
+    auto startTime = std::chrono::steady_clock::now();
+    WalkStats stats = walker.walk(workingDir.fd(), dirname, [&](WalkEntry &entry) {
+        if (entry.isDir) {
+            if (entry.depth == 1) {
+                std::lock_guard<std::mutex> lock(namesMutex);
+                entry.tag = subdirNames.size();
+                subdirNames.emplace_back(entry.name);
+            }
+            return true;
+        }
+        if (!entry.firstLink) {
+            return true;
+        }
+        WorkerTotals &mine = totals[entry.worker];
+        if (mine.bytes.size() <= entry.tag) {
+            mine.bytes.resize(entry.tag + 1, 0);
+            mine.files.resize(entry.tag + 1, 0);
+        }
+        mine.bytes[entry.tag] += static_cast<uint64_t>(entry.stat()->st_size);
+        mine.files[entry.tag]++;
+        return true;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (!stats.rootOk) {
+        fail() << "Error reading directory: " << dirname << ": " << std::strerror(stats.rootErrno) << '\n';
+        return;
+    }
+    if (stats.cancelled) {
+        fail() << "Cancelled after scanning " << (stats.files + stats.dirs) << " entries\n";
+        return;
+    }
+
+    // 合并各线程的统计
+    std::vector<DuCache::Subdir> subdirs;
+    for (size_t tag = 0; tag < subdirNames.size(); tag++) {
+        subdirs.push_back({subdirNames[tag], 0, 0});
+    }
+    uint64_t totalBytes = 0;
+    uint64_t totalFiles = 0;
+    for (const auto &mine : totals) {
+        for (size_t tag = 0; tag < mine.bytes.size(); tag++) {
+            subdirs[tag].bytes += mine.bytes[tag];
+            subdirs[tag].files += mine.files[tag];
+            totalBytes += mine.bytes[tag];
+            totalFiles += mine.files[tag];
+        }
+    }
+
+    // 第 0 项是根目录下的直接文件，不作为子目录显示
+    subdirs.erase(subdirs.begin());
+    printSubdirTotals(out, subdirs);
+
+    out << "Total: " << totalBytes << " bytes (" << formatBytes(totalBytes) << "), "
+        << totalFiles << " files, " << stats.dirs << " directories\n";
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+    out << "Scanned " << (stats.files + stats.dirs) << " entries in " << elapsed
+        << " s using " << walker.threadCount() << " threads\n";
+    if (stats.errors > 0) {
+        fail() << "Warning: " << stats.errors << " entries could not be read\n";
+    }
+}
+
+void MiniFileExplorer::cmdDedup(const ArgList &args) {
+    // ========== 重复文件查找：dedup 命令 ==========
+    // 输入 dedup [目录名] 查找内容相同的文件（不指定时为当前目录），
+    // 按可回收空间从大到小列出每组重复文件，路径相对当前目录
+    // 选项: -j N (使用 N 个线程), -x (不跨越文件系统), --min-size N (忽略小于 N 字节的文件),
+    //       --link (把多余的副本替换成硬链接), --reflink (替换成 reflink)
+    //
+    // 先按大小、再按首尾 4 KiB 的哈希、最后按完整内容的 XXH64 逐级排除（见 DuplicateFinder），
+    // 替换之前逐字节比较，确认一次
+
+    DedupOptions options;
+    std::string dirname;
+    bool replace = false;
+    DedupLink mode = DedupLink::HardLink;
+
+    // 解析选项
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-j" || args[i] == "--min-size") {
+            if (i + 1 >= args.size()) {
+                fail() << "Missing value for " << args[i] << '\n';
+                return;
+            }
+            unsigned long long value = 0;
+            if (!parseNumber(args[i + 1], value) || (args[i] == "-j" && (value == 0 || value > 1024))) {
+                fail() << "Invalid value for " << args[i] << ": " << args[i + 1] << '\n';
+                return;
+            }
+            if (args[i] == "-j") {
+                options.threads = static_cast<unsigned>(value);
+            } else {
+                options.minSize = std::max<unsigned long long>(value, 1);
+            }
+            i++;
+        } else if (args[i] == "-x") {
+            options.oneFileSystem = true;
+        } else if (args[i] == "--link" || args[i] == "--reflink") {
+            replace = true;
+            mode = args[i] == "--link" ? DedupLink::HardLink : DedupLink::Reflink;
+        } else if (dirname.empty()) {
+            dirname = args[i];
+        } else {
+            fail() << "Unexpected argument: " << args[i] << '\n';
+            return;
+        }
+    }
+
+    if (dirname.empty()) {
+        dirname = ".";
+    }
+
+    // 检查目录是否存在（相对当前目录的 fd）
+    struct stat dirStat;
+    Stats::add(Stats::StatCalls);
+    if (fstatat(workingDir.fd(), dirname.c_str(), &dirStat, 0) != 0) {
+        fail() << "Directory not found: " << dirname << '\n';
+        return;
+    }
+    if (!S_ISDIR(dirStat.st_mode)) {
+        fail() << "Not a directory: " << dirname << '\n';
+        return;
+    }
+
+    options.control = control;
+    auto startTime = std::chrono::steady_clock::now();
+    DedupResult result = findDuplicates(workingDir.fd(), dirname, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (!result.ok) {
+        fail() << "Cannot open directory: " << dirname << ": " << result.error << '\n';
+        return;
+    }
+    if (result.cancelled) {
+        fail() << "Cancelled; results are incomplete\n";
+        return;
+    }
+
+    for (size_t g = 0; g < result.groups.size(); g++) {
+        const DuplicateGroup &group = result.groups[g];
+        out << "Duplicate set " << g + 1 << ": " << group.files.size() << " files, " << formatBytes(group.size)
+            << " each (" << formatBytes(group.reclaimableBytes) << " reclaimable)\n";
+        for (const auto &file : group.files) {
+            // 同一文件的其他硬链接名称缩进列在下面
+            out << "  " << file.paths.front() << (file.linkedOutside ? " (also linked outside)" : "") << '\n';
+            for (size_t i = 1; i < file.paths.size(); i++) {
+                out << "    = " << file.paths[i] << '\n';
+            }
+        }
+    }
+
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.3f", seconds);
+    out << "Scanned " << result.files << " files: " << result.sizeCandidates << " share a size, "
+        << result.fullyHashed << " fully hashed, " << formatBytes(result.bytesRead) << " read in " << elapsed
+        << " s with " << result.threads << " threads\n";
+    if (result.errors > 0) {
+        out << "Could not read " << result.errors << " files or directories\n";
+    }
+    if (result.groups.empty()) {
+        out << "No duplicate files found\n";
+        return;
+    }
+    out << "Found " << result.groups.size() << " duplicate sets, " << result.duplicateFiles << " extra copies, "
+        << formatBytes(result.reclaimableBytes) << " reclaimable\n";
+
+    if (!replace) {
+        return;
+    }
+    const char *how = mode == DedupLink::HardLink ? "hard links" : "reflinks";
+    std::string names = result.duplicateNames == result.duplicateFiles
+                            ? std::string()
+                            : " (" + std::to_string(result.duplicateNames) + " names)";
+    if (!confirm("Replace " + std::to_string(result.duplicateFiles) + " extra copies" + names + " with " + how +
+                 "?")) {
+        return;
+    }
+    DedupReplaceResult replaced = replaceDuplicates(workingDir.fd(), result.groups, mode, options);
+    out << "Replaced " << replaced.replaced << " files with " << how << ", reclaimed "
+        << formatBytes(replaced.bytes) << '\n';
+    if (replaced.skipped > 0) {
+        out << "Skipped " << replaced.skipped << " files that changed since the scan\n";
+    }
+    if (replaced.mismatched > 0) {
+        out << "Skipped " << replaced.mismatched
+            << " files whose permissions or owner differ from the original (use --reflink to keep them)\n";
+    }
+    if (replaced.errors > 0) {
+        fail() << "Failed to replace " << replaced.errors << " files (first: " << replaced.firstError << ")\n";
+    }
+}
+
+void MiniFileExplorer::cmdStats(const ArgList &args) {
+    // ========== 统计信息：stats 命令 ==========
+    // stats          显示每条命令的调用次数、耗时分布、访问的条目数和系统调用次数
+    // stats on|off   打开/关闭统计（默认关闭，关闭时几乎没有开销）
+    // stats reset    清空已有的统计
+    // stats json [文件名] 以 JSON 输出（到文件或屏幕）
+
+    if (args.empty()) {
+        Stats::print(out);
+        if (!Stats::enabled()) {
+            out << "Statistics are off; use 'stats on' to start collecting.\n";
+        }
+        return;
+    }
+
+    std::string_view action = args[0];
+    if (action == "on" || action == "off") {
+        Stats::setEnabled(action == "on");
+        out << "Stats " << action << '\n';
+    } else if (action == "reset") {
+        Stats::reset();
+        out << "Stats reset\n";
+    } else if (action == "json") {
+        if (args.size() < 2) {
+            Stats::writeJson(out);
+            return;
+        }
+        std::ostringstream json;
+        Stats::writeJson(json);
+        std::string text = json.str();
+        std::string path = resolvePath(args[1]).string();
+        if (!writeFileAtomic(path, text.data(), text.size())) {
+            fail() << "Cannot write " << path << ": " << std::strerror(errno) << '\n';
+            return;
+        }
+        out << "Stats written to " << path << '\n';
+    } else {
+        fail() << "Usage: stats [on | off | reset | json [file]]\n";
+    }
+}
+
+// ========== 后台任务 ==========
+void MiniFileExplorer::submitJob(std::string_view name, std::string_view command) {
+    // 只影响本实例状态的命令放到后台没有意义
+    if (name == "cd" || name == "exit" || name == "jobs" || name == "wait" || name == "cancel") {
+        fail() << "Cannot run '" << name << "' in the background\n";
+        return;
+    }
+
+    // 任务在工作线程中用自己的 MiniFileExplorer 实例执行（自己的目录缓存、输出缓冲区），
+    // 与前台实例不共享任何可变状态；前台的目录缓存通过 inotify 感知任务做出的修改
+    size_t begin = command.find_first_not_of(" \t");
+    size_t end = command.find_last_not_of(" \t");
+    std::string text(command.substr(begin, end + 1 - begin));
+    // 任务持有当前目录 fd 的副本：之后前台 cd 或目录被改名都不影响任务
+    auto cwd = std::make_shared<WorkingDirectory>(workingDir.clone());
+    if (!*cwd) {
+        fail() << "Cannot start job: " << std::strerror(errno) << '\n';
+        return;
+    }
+    bool yes = assumeYes;
+    unsigned id = jobs.submit(text, [text, cwd, yes](JobControl &control, std::streambuf &output) {
+        MiniFileExplorer job(std::move(*cwd), control, output, yes);
+        return job.handleCommand(text);
+    });
+    out << '[' << id << "] " << text << '\n';
+}
+
+void MiniFileExplorer::cmdJobs(const ArgList &) {
+    // ========== 后台任务列表：jobs 命令 ==========
+    // 显示每个任务的状态、已运行时间、已处理的条目数和数据量以及速率
+    jobs.list(out);
+}
+
+// 解析任务编号
+static bool parseJobId(std::string_view text, unsigned &id) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), id);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() && id > 0;
+}
+
+void MiniFileExplorer::cmdWait(const ArgList &args) {
+    // ========== 等待后台任务：wait 命令 ==========
+    // wait [编号]：等待任务结束并显示其输出；不指定编号时等待所有任务
+    if (args.empty()) {
+        jobs.waitAll(out);
+        return;
+    }
+    for (const auto &arg : args) {
+        unsigned id = 0;
+        if (!parseJobId(arg, id)) {
+            fail() << "Invalid job id: " << arg << '\n';
+        } else if (!jobs.wait(id, out)) {
+            fail() << "No such job: " << id << '\n';
+        }
+    }
+}
+
+void MiniFileExplorer::cmdCancel(const ArgList &args) {
+    // ========== 取消后台任务：cancel 命令 ==========
+    // cancel [编号]：请求任务停止（协作式：遍历/复制在处理下一个目录或文件前检查）
+    if (args.empty()) {
+        fail() << "Missing job id: Please enter 'cancel [id]'\n";
+        return;
+    }
+    for (const auto &arg : args) {
+        unsigned id = 0;
+        if (!parseJobId(arg, id)) {
+            fail() << "Invalid job id: " << arg << '\n';
+        } else if (!jobs.cancel(id)) {
+            fail() << "No such job: " << id << '\n';
+        } else {
+            out << "Cancelling job " << id << '\n';
+        }
+    }
+}
+
+void MiniFileExplorer::cmdHelp(const ArgList &) {
+    out << "\n=== MiniFileExplorer Commands ===\n\n";
+    out << "cd [path]          - Switch to target directory\n";
+    out << "ls [options]       - List all files and directories\n";
+    out << "                   - Options: -s (sort by size), -t (sort by time)\n";
+    out << "                              -n N (show N entries), --offset M (skip M entries),\n";
+    out << "                              -f (stream in directory order, constant memory)\n";
+    out << "touch [filename]   - Create empty files (several names and braces: touch f{0..99})\n";
+    out << "mkdir [dirname]    - Create directories (several names and braces: mkdir d{a,b})\n";
+    out << "                   - Options: -p (create missing parents, no error if existing)\n";
+    out << "rm [filename]      - Delete a file\n";
+    out << "                   - Options: -r (delete a directory tree, one confirmation), -j N (threads)\n";
+    out << "rmdir [dirname]    - Delete an empty directory\n";
+    out << "stat [name]        - Show detailed information\n";
+    out << "search [keyword]   - Search files/directories\n";
+    out << "                   - Options: -i (ignore case); uses the index if one exists\n";
+    out << "                   - Filters: -name GLOB, -regex RE, -type f|d|l, -size [+|-]N[K|M|G],\n";
+    out << "                              -mtime [+|-]DAYS, -maxdepth N, -prune GLOB\n";
+    out << "grep [pat] [path]  - Find lines containing pat in files (recursive for directories)\n";
+    out << "                   - Options: -i (ignore case), -j N (use N threads); binary files are skipped\n";
+    out << "cp [src] [dst]     - Copy a file (reflink/copy_file_range/sendfile when possible)\n";
+    out << "                   - Options: -r (copy a directory tree), -j N (copy threads)\n";
+    out << "mv [src] [dst]     - Move/rename a file or directory\n";
+    out << "mv [src...] [dir]  - Move several files/directories into a directory\n";
+    out << "sync [src] [dst]   - Update dst to match src: skip unchanged files, patch changed blocks of large files\n";
+    out << "                   - Options: -j N (threads); entries only in dst are kept\n";
+    out << "du [dirname]       - Calculate directory size\n";
+    out << "                   - Options: -j N (use N threads), -x (stay on one filesystem)\n";
+    out << "                              --incremental (reuse cached totals of unchanged directories)\n";
+    out << "dedup [dirname]    - Find duplicate files (size, then partial hash, then full XXH64)\n";
+    out << "                   - Options: -j N (threads), -x (stay on one filesystem), --min-size N (bytes),\n";
+    out << "                              --link / --reflink (replace extra copies after a byte-by-byte check)\n";
+    out << "index build [dir]  - Build/refresh the file name index used by search\n";
+    out << "index info [dir]   - Show index information\n";
+    out << "snapshot save <dir> <file> [-j N] [-x] - Record the metadata of every entry in a tree\n";
+    out << "snapshot diff <old> <new> - List added (A), removed (D), modified (M) and renamed (R) entries\n";
+    out << "snapshot info <file> - Show snapshot information\n";
+    out << "stats [on|off]     - Show or toggle per-command timing and syscall counters\n";
+    out << "                   - Also: stats reset, stats json [file]\n";
+    out << "[command] &        - Run a command in the background (e.g. du /srv &)\n";
+    out << "jobs               - List background jobs with progress\n";
+    out << "wait [id]          - Wait for a background job (all jobs if no id)\n";
+    out << "cancel [id]        - Cancel a background job\n";
+    out << "help               - Show this help message\n";
+    out << "exit               - Exit the program\n";
+    out << '\n';
+}
+
+void MiniFileExplorer::cmdExit(const ArgList &) {
+    out << "MiniFileExplorer closed successfully\n";
+    // 结束主循环（而不是直接 exit），缓冲的输出才能被完整写出
+    running = false;
+}
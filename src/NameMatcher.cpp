@@ -0,0 +1,222 @@
+#include "../include/NameMatcher.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NAMEMATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline unsigned char toLowerAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+// 比较 text 与（已转小写的）pattern 的前 length 个字节
+template <bool IgnoreCase>
+inline bool equalBytes(const char* text, const char* pattern, size_t length) {
+    if (!IgnoreCase) {
+        return std::memcmp(text, pattern, length) == 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (toLowerAscii(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(pattern[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <bool IgnoreCase>
+size_t findScalar(const std::string& needle, const char* text, size_t length) {
+    size_t k = needle.size();
+    if (k == 0) {
+        return 0;
+    }
+    if (length < k) {
+        return NameMatcher::npos;
+    }
+    if (!IgnoreCase) {
+        size_t pos = std::string_view(text, length).find(needle);
+        return pos == std::string_view::npos ? NameMatcher::npos : pos;
+    }
+    unsigned char first = static_cast<unsigned char>(needle[0]);
+    for (size_t i = 0; i + k <= length; i++) {
+        if (toLowerAscii(static_cast<unsigned char>(text[i])) == first &&
+            equalBytes<true>(text + i + 1, needle.data() + 1, k - 1)) {
+            return i;
+        }
+    }
+    return NameMatcher::npos;
+}
+
+#ifdef NAMEMATCHER_X86
+
+// 从 p 开始读取 width 字节是否会跨越 4 KiB 页边界。
+// 不跨页时即使读到数据末尾之后也不会触发缺页错误，超出部分的结果会被掩码丢弃；
+// 这样短名称（远小于一个向量宽度）也能走向量路径。
+inline bool crossesPage(const char* p, size_t width) {
+    return (reinterpret_cast<uintptr_t>(p) & 4095) > 4096 - width;
+}
+
+// 把 'A'..'Z' 转为小写：带符号比较时 >= 0x80 的字节是负数，不会被误判为字母
+inline __m128i foldCase128(__m128i x) {
+    __m128i ge = _mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1));
+    __m128i le = _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1));
+    return _mm_or_si128(x, _mm_and_si128(_mm_and_si128(ge, le), _mm_set1_epi8(0x20)));
+}
+
+template <bool IgnoreCase>
+size_t findSse2(const std::string& needle, const char* text, size_t length) {
+    size_t k = needle.size();
+    if (k == 0) {
+        return 0;
+    }
+    if (length < k) {
+        return NameMatcher::npos;
+    }
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    const size_t lastStart = length - k;
+
+    size_t i = 0;
+    for (; i <= lastStart; i += 16) {
+        const char* p1 = text + i;
+        const char* p2 = text + i + k - 1;
+        if (i + k - 1 + 16 > length && (crossesPage(p1, 16) || crossesPage(p2, 16))) {
+            break;
+        }
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p2));
+        if (IgnoreCase) {
+            a = foldCase128(a);
+            b = foldCase128(b);
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        size_t valid = lastStart - i + 1;
+        if (valid < 16) {
+            mask &= (1u << valid) - 1;
+        }
+        while (mask != 0) {
+            size_t pos = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (k <= 2 || equalBytes<IgnoreCase>(text + pos + 1, needle.data() + 1, k - 2)) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    if (i > lastStart) {
+        return NameMatcher::npos;
+    }
+
+    // 剩下靠近页边界的部分用标量处理
+    size_t pos = findScalar<IgnoreCase>(needle, text + i, length - i);
+    return pos == NameMatcher::npos ? pos : i + pos;
+}
+
+__attribute__((target("avx2")))
+inline __m256i foldCase256(__m256i x) {
+    __m256i ge = _mm256_cmpgt_epi8(x, _mm256_set1_epi8('A' - 1));
+    __m256i le = _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), x);
+    return _mm256_or_si256(x, _mm256_and_si256(_mm256_and_si256(ge, le), _mm256_set1_epi8(0x20)));
+}
+
+template <bool IgnoreCase>
+__attribute__((target("avx2")))
+size_t findAvx2(const std::string& needle, const char* text, size_t length) {
+    size_t k = needle.size();
+    if (k == 0) {
+        return 0;
+    }
+    if (length < k) {
+        return NameMatcher::npos;
+    }
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    const size_t lastStart = length - k;
+
+    size_t i = 0;
+    for (; i <= lastStart; i += 32) {
+        const char* p1 = text + i;
+        const char* p2 = text + i + k - 1;
+        if (i + k - 1 + 32 > length && (crossesPage(p1, 32) || crossesPage(p2, 32))) {
+            break;
+        }
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p2));
+        if (IgnoreCase) {
+            a = foldCase256(a);
+            b = foldCase256(b);
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        size_t valid = lastStart - i + 1;
+        if (valid < 32) {
+            mask &= (1u << valid) - 1;
+        }
+        while (mask != 0) {
+            size_t pos = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (k <= 2 || equalBytes<IgnoreCase>(text + pos + 1, needle.data() + 1, k - 2)) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    if (i > lastStart) {
+        return NameMatcher::npos;
+    }
+
+    // 剩下靠近页边界的部分交给 SSE2（它会继续处理到真正的末尾）
+    size_t pos = findSse2<IgnoreCase>(needle, text + i, length - i);
+    return pos == NameMatcher::npos ? pos : i + pos;
+}
+
+#endif // NAMEMATCHER_X86
+
+} // namespace
+
+// 访问 NameMatcher 私有成员的各个实现
+struct NameMatcherKernels {
+    template <bool IgnoreCase>
+    static size_t scalar(const NameMatcher& m, const char* text, size_t length) {
+        return findScalar<IgnoreCase>(m.needle, text, length);
+    }
+#ifdef NAMEMATCHER_X86
+    template <bool IgnoreCase>
+    static size_t sse2(const NameMatcher& m, const char* text, size_t length) {
+        return findSse2<IgnoreCase>(m.needle, text, length);
+    }
+    template <bool IgnoreCase>
+    static size_t avx2(const NameMatcher& m, const char* text, size_t length) {
+        return findAvx2<IgnoreCase>(m.needle, text, length);
+    }
+#endif
+};
+
+NameMatcher::NameMatcher(std::string_view needle, bool ignoreCase)
+    : needle(needle), ignoreCase(ignoreCase) {
+    if (ignoreCase) {
+        for (auto& c : this->needle) {
+            c = static_cast<char>(toLowerAscii(static_cast<unsigned char>(c)));
+        }
+    }
+
+#ifdef NAMEMATCHER_X86
+    // CPU 特性只检测一次
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        findImpl = ignoreCase ? &NameMatcherKernels::avx2<true> : &NameMatcherKernels::avx2<false>;
+    } else {
+        findImpl = ignoreCase ? &NameMatcherKernels::sse2<true> : &NameMatcherKernels::sse2<false>;
+    }
+#else
+    findImpl = ignoreCase ? &NameMatcherKernels::scalar<true> : &NameMatcherKernels::scalar<false>;
+#endif
+}
+
+size_t NameMatcher::find(const char* text, size_t length) const {
+    return findImpl(*this, text, length);
+}
@@ -0,0 +1,471 @@
+#include "../include/NamePattern.h"
+#include <algorithm>
+#include <bitset>
+#include <map>
+
+namespace {
+
+using CharSet = std::bitset<256>;
+
+// Thompson NFA：每个状态最多一条字符转移，外加任意条 ε 转移
+struct NfaState {
+    CharSet set;
+    int next = -1;
+    std::vector<int> eps;
+};
+
+// 一段已构造的 NFA：从 start 进入，从 end 离开（end 尚无出边）
+struct Fragment {
+    int start;
+    int end;
+};
+
+class NfaBuilder {
+public:
+    std::vector<NfaState> states;
+
+    int add() {
+        states.emplace_back();
+        return static_cast<int>(states.size() - 1);
+    }
+
+    Fragment chars(const CharSet& set) {
+        int s = add();
+        int e = add();
+        states[s].set = set;
+        states[s].next = e;
+        return {s, e};
+    }
+
+    Fragment empty() {
+        int s = add();
+        int e = add();
+        states[s].eps.push_back(e);
+        return {s, e};
+    }
+
+    Fragment concat(Fragment a, Fragment b) {
+        states[a.end].eps.push_back(b.start);
+        return {a.start, b.end};
+    }
+
+    Fragment alternate(Fragment a, Fragment b) {
+        int s = add();
+        int e = add();
+        states[s].eps = {a.start, b.start};
+        states[a.end].eps.push_back(e);
+        states[b.end].eps.push_back(e);
+        return {s, e};
+    }
+
+    Fragment star(Fragment a) {
+        int s = add();
+        int e = add();
+        states[s].eps = {a.start, e};
+        states[a.end].eps.push_back(a.start);
+        states[a.end].eps.push_back(e);
+        return {s, e};
+    }
+
+    Fragment plus(Fragment a) {
+        int e = add();
+        states[a.end].eps.push_back(a.start);
+        states[a.end].eps.push_back(e);
+        return {a.start, e};
+    }
+
+    Fragment optional(Fragment a) {
+        int s = add();
+        int e = add();
+        states[s].eps = {a.start, e};
+        states[a.end].eps.push_back(e);
+        return {s, e};
+    }
+};
+
+void addChar(CharSet& set, unsigned char c, bool ignoreCase) {
+    set.set(c);
+    if (ignoreCase) {
+        if (c >= 'a' && c <= 'z') {
+            set.set(c - 'a' + 'A');
+        } else if (c >= 'A' && c <= 'Z') {
+            set.set(c - 'A' + 'a');
+        }
+    }
+}
+
+// \d \w \s 对应的字符集合；不是这几个时返回 false
+bool escapeClass(char c, CharSet& set) {
+    switch (c) {
+        case 'd':
+            for (int ch = '0'; ch <= '9'; ch++) set.set(ch);
+            return true;
+        case 'w':
+            for (int ch = 0; ch < 256; ch++) {
+                if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_') {
+                    set.set(ch);
+                }
+            }
+            return true;
+        case 's':
+            for (char ch : {' ', '\t', '\n', '\r', '\f', '\v'}) set.set(static_cast<unsigned char>(ch));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 解析 [...]：pos 指向 '[' 之后，成功时指向 ']' 之后
+// glob 中 '!' 和 '^' 都表示取反，正则中只有 '^'；两者都支持 \ 转义
+bool parseBracket(std::string_view p, size_t& pos, bool glob, bool ignoreCase, CharSet& out, std::string& error) {
+    CharSet set;
+    bool negate = false;
+    if (pos < p.size() && (p[pos] == '^' || (glob && p[pos] == '!'))) {
+        negate = true;
+        pos++;
+    }
+    bool first = true;
+    while (pos < p.size() && (p[pos] != ']' || first)) {
+        first = false;
+        unsigned char c = static_cast<unsigned char>(p[pos++]);
+        if (c == '\\' && pos < p.size()) {
+            c = static_cast<unsigned char>(p[pos++]);
+            if (!glob && escapeClass(static_cast<char>(c), set)) {
+                continue;
+            }
+        }
+        // 范围 a-z（'-' 在末尾时是普通字符）
+        if (pos + 1 < p.size() && p[pos] == '-' && p[pos + 1] != ']') {
+            unsigned char hi = static_cast<unsigned char>(p[pos + 1]);
+            pos += 2;
+            if (hi == '\\' && pos < p.size()) {
+                hi = static_cast<unsigned char>(p[pos++]);
+            }
+            if (hi < c) {
+                error = "invalid range in []";
+                return false;
+            }
+            for (unsigned ch = c; ch <= hi; ch++) {
+                addChar(set, static_cast<unsigned char>(ch), ignoreCase);
+            }
+            continue;
+        }
+        addChar(set, c, ignoreCase);
+    }
+    if (pos >= p.size()) {
+        error = "missing ']'";
+        return false;
+    }
+    pos++;
+    // 取反在大小写折叠之后进行，[^a] 忽略大小写时也不匹配 A
+    out = negate ? ~set : set;
+    return true;
+}
+
+// 正则表达式解析（递归下降）：alt := concat ('|' concat)*，concat := repeat*，repeat := atom ('*'|'+'|'?')*
+class RegexParser {
+public:
+    RegexParser(std::string_view pattern, bool ignoreCase, NfaBuilder& nfa, std::string& error)
+        : p(pattern), ignoreCase(ignoreCase), nfa(nfa), error(error) {}
+
+    bool parse(Fragment& out) {
+        if (!parseAlternation(out)) {
+            return false;
+        }
+        if (pos < p.size()) {
+            error = "unmatched ')'";
+            return false;
+        }
+        return true;
+    }
+
+    // 最外层（不在括号中）是否有 '|'
+    bool topLevelAlternation() const { return topLevelBar; }
+
+private:
+    std::string_view p;
+    size_t pos = 0;
+    bool ignoreCase;
+    NfaBuilder& nfa;
+    std::string& error;
+    int depth = 0;
+    bool topLevelBar = false;
+
+    bool parseAlternation(Fragment& out) {
+        if (!parseConcat(out)) {
+            return false;
+        }
+        while (pos < p.size() && p[pos] == '|') {
+            topLevelBar = topLevelBar || depth == 0;
+            pos++;
+            Fragment right;
+            if (!parseConcat(right)) {
+                return false;
+            }
+            out = nfa.alternate(out, right);
+        }
+        return true;
+    }
+
+    bool parseConcat(Fragment& out) {
+        out = nfa.empty();
+        while (pos < p.size() && p[pos] != '|' && p[pos] != ')') {
+            Fragment item;
+            if (!parseRepeat(item)) {
+                return false;
+            }
+            out = nfa.concat(out, item);
+        }
+        return true;
+    }
+
+    bool parseRepeat(Fragment& out) {
+        if (!parseAtom(out)) {
+            return false;
+        }
+        while (pos < p.size() && (p[pos] == '*' || p[pos] == '+' || p[pos] == '?')) {
+            char op = p[pos++];
+            out = op == '*' ? nfa.star(out) : op == '+' ? nfa.plus(out) : nfa.optional(out);
+        }
+        return true;
+    }
+
+    bool parseAtom(Fragment& out) {
+        char c = p[pos++];
+        CharSet set;
+        switch (c) {
+            case '(':
+                if (++depth > 256) {
+                    error = "too many nested groups";
+                    return false;
+                }
+                if (!parseAlternation(out)) {
+                    return false;
+                }
+                if (pos >= p.size() || p[pos] != ')') {
+                    error = "missing ')'";
+                    return false;
+                }
+                pos++;
+                depth--;
+                return true;
+            case '[':
+                if (!parseBracket(p, pos, false, ignoreCase, set, error)) {
+                    return false;
+                }
+                out = nfa.chars(set);
+                return true;
+            case '.':
+                out = nfa.chars(~CharSet());
+                return true;
+            case '*':
+            case '+':
+            case '?':
+                error = std::string("nothing to repeat before '") + c + "'";
+                return false;
+            case '{':
+                error = "{m,n} repetition is not supported";
+                return false;
+            case '^':
+            case '$':
+                error = "'^' and '$' are only supported at the start and end of the pattern";
+                return false;
+            case '\\':
+                if (pos >= p.size()) {
+                    error = "trailing '\\'";
+                    return false;
+                }
+                c = p[pos++];
+                if (escapeClass(c, set)) {
+                    out = nfa.chars(set);
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+        addChar(set, static_cast<unsigned char>(c), ignoreCase);
+        out = nfa.chars(set);
+        return true;
+    }
+};
+
+bool compileGlob(std::string_view p, bool ignoreCase, NfaBuilder& nfa, Fragment& out, std::string& error) {
+    out = nfa.empty();
+    size_t pos = 0;
+    while (pos < p.size()) {
+        char c = p[pos++];
+        CharSet set;
+        Fragment item;
+        if (c == '*') {
+            item = nfa.star(nfa.chars(~CharSet()));
+        } else if (c == '?') {
+            item = nfa.chars(~CharSet());
+        } else if (c == '[') {
+            if (!parseBracket(p, pos, true, ignoreCase, set, error)) {
+                return false;
+            }
+            item = nfa.chars(set);
+        } else {
+            if (c == '\\' && pos < p.size()) {
+                c = p[pos++];
+            }
+            addChar(set, static_cast<unsigned char>(c), ignoreCase);
+            item = nfa.chars(set);
+        }
+        out = nfa.concat(out, item);
+    }
+    return true;
+}
+
+// 末尾的 '$' 是否是锚点（前面有奇数个 '\' 时是被转义的普通字符）
+bool endsWithAnchor(std::string_view p) {
+    if (p.empty() || p.back() != '$') {
+        return false;
+    }
+    size_t slashes = 0;
+    for (size_t i = p.size() - 1; i > 0 && p[i - 1] == '\\'; i--) {
+        slashes++;
+    }
+    return slashes % 2 == 0;
+}
+
+void closure(const std::vector<NfaState>& states, std::vector<int>& set) {
+    std::vector<int> stack(set);
+    std::vector<bool> seen(states.size(), false);
+    for (int s : set) {
+        seen[s] = true;
+    }
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        for (int t : states[s].eps) {
+            if (!seen[t]) {
+                seen[t] = true;
+                set.push_back(t);
+                stack.push_back(t);
+            }
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+} // namespace
+
+bool NamePattern::compile(std::string_view pattern, Syntax syntax, bool ignoreCase, std::string& error) {
+    NfaBuilder nfa;
+    Fragment body;
+    bool anchoredStart = true;
+    bool anchoredEnd = true;
+    if (syntax == Syntax::Glob) {
+        if (!compileGlob(pattern, ignoreCase, nfa, body, error)) {
+            return false;
+        }
+    } else {
+        anchoredStart = !pattern.empty() && pattern.front() == '^';
+        anchoredEnd = endsWithAnchor(pattern);
+        if (anchoredStart) {
+            pattern.remove_prefix(1);
+        }
+        if (anchoredEnd) {
+            pattern.remove_suffix(1);
+        }
+        RegexParser parser(pattern, ignoreCase, nfa, error);
+        if (!parser.parse(body)) {
+            return false;
+        }
+        // 锚点作用于整个模式，a|b$ 会被当成 (a|b)$，与通常的含义不同，直接拒绝
+        if ((anchoredStart || anchoredEnd) && parser.topLevelAlternation()) {
+            error = "'^' and '$' cannot be combined with a top-level '|'; group the alternatives, e.g. ^(a|b)$";
+            return false;
+        }
+    }
+
+    // 未锚定开头：起始状态在任意字节上回到自身，相当于在前面加 .*
+    int nfaStart = body.start;
+    if (!anchoredStart) {
+        nfaStart = nfa.add();
+        nfa.states[nfaStart].set = ~CharSet();
+        nfa.states[nfaStart].next = nfaStart;
+        nfa.states[nfaStart].eps.push_back(body.start);
+    }
+    int nfaAccept = body.end;
+    const std::vector<NfaState>& states = nfa.states;
+
+    // ========== 字节等价类：对所有转移都表现相同的字节归为一类 ==========
+    int classes[256] = {};
+    int count = 1;
+    for (const auto& s : states) {
+        if (s.next < 0) {
+            continue;
+        }
+        std::vector<int> remap(static_cast<size_t>(count) * 2, -1);
+        int newCount = 0;
+        for (int b = 0; b < 256; b++) {
+            int key = classes[b] * 2 + (s.set.test(b) ? 1 : 0);
+            if (remap[key] < 0) {
+                remap[key] = newCount++;
+            }
+            classes[b] = remap[key];
+        }
+        count = newCount;
+    }
+    std::vector<int> representative(count, -1);
+    for (int b = 0; b < 256; b++) {
+        if (representative[classes[b]] < 0) {
+            representative[classes[b]] = b;
+        }
+    }
+
+    // ========== 子集构造 ==========
+    // 状态 0 是死状态（空集合），所有转移都回到自身
+    std::map<std::vector<int>, uint32_t> ids;
+    std::vector<std::vector<int>> sets;
+    ids.emplace(std::vector<int>(), kDead);
+    sets.emplace_back();
+
+    std::vector<int> first{nfaStart};
+    closure(states, first);
+    ids.emplace(first, 1);
+    sets.push_back(first);
+
+    std::vector<uint32_t> newTable(static_cast<size_t>(count) * 2, kDead);
+    std::vector<int> next;
+    for (size_t d = 1; d < sets.size(); d++) {
+        for (int k = 0; k < count; k++) {
+            int b = representative[k];
+            next.clear();
+            for (int s : sets[d]) {
+                if (states[s].next >= 0 && states[s].set.test(b)) {
+                    next.push_back(states[s].next);
+                }
+            }
+            closure(states, next);
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            auto it = ids.find(next);
+            if (it == ids.end()) {
+                if (sets.size() >= kMaxStates) {
+                    error = "pattern is too complex";
+                    return false;
+                }
+                it = ids.emplace(next, static_cast<uint32_t>(sets.size())).first;
+                sets.push_back(next);
+                newTable.resize(sets.size() * static_cast<size_t>(count), kDead);
+            }
+            newTable[d * count + k] = it->second;
+        }
+    }
+
+    for (int b = 0; b < 256; b++) {
+        byteClass[b] = static_cast<uint8_t>(classes[b]);
+    }
+    classCount = static_cast<uint32_t>(count);
+    table = std::move(newTable);
+    accepting.assign(sets.size(), 0);
+    for (size_t d = 0; d < sets.size(); d++) {
+        accepting[d] = std::binary_search(sets[d].begin(), sets[d].end(), nfaAccept) ? 1 : 0;
+    }
+    start = 1;
+    acceptEarly = !anchoredEnd;
+    return true;
+}
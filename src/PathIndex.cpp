@@ -0,0 +1,632 @@
+#include "../include/PathIndex.h"
+#include "../include/Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'M', 'F', 'E', 'I', 'D', 'X', '1', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kNone = 0xFFFFFFFFu;
+
+// 条目类型
+enum : uint8_t {
+    kTypeFile = 'f',
+    kTypeDir = 'd',
+    kTypeLink = 'l',
+    kTypeOther = 'o'
+};
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t builtAt;
+    uint64_t rootOffset;
+    uint64_t rootLength;
+    uint64_t dirCount;
+    uint64_t entryCount;
+    uint64_t trigramCount;
+    uint64_t postingCount;
+    uint64_t stringBytes;
+    uint64_t dirsOffset;
+    uint64_t entriesOffset;
+    uint64_t trigramsOffset;
+    uint64_t postingsOffset;
+    uint64_t stringsOffset;
+};
+
+struct DirRecord {
+    uint64_t pathOffset;   // 相对根的路径（根目录为空）
+    uint32_t pathLength;
+    uint32_t entryCount;   // 本目录的直接条目数
+    uint64_t firstEntry;   // 第一个直接条目的编号
+    int64_t mtimeSec;      // 目录 mtime，-1 表示读取失败（下次总是重新读取）
+    int64_t mtimeNsec;
+};
+
+struct EntryRecord {
+    uint64_t nameOffset;
+    uint32_t dirIndex;     // 所在目录
+    uint32_t childDir;     // 若为目录，对应的目录编号；否则为 kNone
+    uint16_t nameLength;
+    uint8_t type;
+    uint8_t reserved[5];
+};
+
+struct TrigramRecord {
+    uint32_t key;          // 三个小写字节拼成的 24 位整数
+    uint32_t count;        // 倒排表长度
+    uint64_t firstPosting; // 在倒排表中的起始位置
+};
+
+inline unsigned char toLowerAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+inline uint32_t trigramKey(unsigned char a, unsigned char b, unsigned char c) {
+    return (static_cast<uint32_t>(toLowerAscii(a)) << 16) |
+           (static_cast<uint32_t>(toLowerAscii(b)) << 8) |
+           static_cast<uint32_t>(toLowerAscii(c));
+}
+
+// 名称中的所有三元组（去重后）
+void collectTrigrams(std::string_view name, std::vector<uint32_t>& keys) {
+    keys.clear();
+    for (size_t i = 0; i + 3 <= name.size(); i++) {
+        keys.push_back(trigramKey(name[i], name[i + 1], name[i + 2]));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.size() > haystack.size()) {
+        return false;
+    }
+    for (size_t i = 0; i + needle.size() <= haystack.size(); i++) {
+        size_t j = 0;
+        while (j < needle.size() &&
+               toLowerAscii(haystack[i + j]) == toLowerAscii(needle[j])) {
+            j++;
+        }
+        if (j == needle.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t typeFromMode(mode_t mode) {
+    if (S_ISDIR(mode)) {
+        return kTypeDir;
+    }
+    if (S_ISREG(mode)) {
+        return kTypeFile;
+    }
+    if (S_ISLNK(mode)) {
+        return kTypeLink;
+    }
+    return kTypeOther;
+}
+
+uint8_t typeFromDirent(int dirFd, const struct dirent* de) {
+    switch (de->d_type) {
+        case DT_DIR: return kTypeDir;
+        case DT_REG: return kTypeFile;
+        case DT_LNK: return kTypeLink;
+        case DT_UNKNOWN: {
+            // 部分文件系统不提供 d_type，只能再 stat 一次
+            struct stat st;
+            Stats::add(Stats::StatCalls);
+            if (fstatat(dirFd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                return typeFromMode(st.st_mode);
+            }
+            return kTypeOther;
+        }
+        default: return kTypeOther;
+    }
+}
+
+void alignTo8(std::string& buffer) {
+    buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7), '\0');
+}
+
+template <typename T>
+void appendArray(std::string& buffer, const std::vector<T>& items) {
+    alignTo8(buffer);
+    buffer.append(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+}
+
+// 已打开的索引文件中各段的指针
+struct IndexView {
+    const IndexHeader* header = nullptr;
+    const DirRecord* dirs = nullptr;
+    const EntryRecord* entries = nullptr;
+    const TrigramRecord* trigrams = nullptr;
+    const uint32_t* postings = nullptr;
+    const char* strings = nullptr;
+
+    bool load(const char* data, size_t size) {
+        if (data == nullptr || size < sizeof(IndexHeader)) {
+            return false;
+        }
+        header = reinterpret_cast<const IndexHeader*>(data);
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+            header->version != kVersion || header->headerSize != sizeof(IndexHeader)) {
+            return false;
+        }
+        auto fits = [size](uint64_t offset, uint64_t count, uint64_t itemSize) {
+            return offset <= size && count <= (size - offset) / itemSize;
+        };
+        if (!fits(header->dirsOffset, header->dirCount, sizeof(DirRecord)) ||
+            !fits(header->entriesOffset, header->entryCount, sizeof(EntryRecord)) ||
+            !fits(header->trigramsOffset, header->trigramCount, sizeof(TrigramRecord)) ||
+            !fits(header->postingsOffset, header->postingCount, sizeof(uint32_t)) ||
+            !fits(header->stringsOffset, header->stringBytes, 1) ||
+            !within(header->rootOffset, header->rootLength, header->stringBytes) ||
+            header->dirCount == 0 || header->dirCount >= kNone || header->entryCount >= kNone) {
+            return false;
+        }
+        dirs = reinterpret_cast<const DirRecord*>(data + header->dirsOffset);
+        entries = reinterpret_cast<const EntryRecord*>(data + header->entriesOffset);
+        trigrams = reinterpret_cast<const TrigramRecord*>(data + header->trigramsOffset);
+        postings = reinterpret_cast<const uint32_t*>(data + header->postingsOffset);
+        strings = data + header->stringsOffset;
+        return true;
+    }
+
+    // load 只检查头部（打开、查询都不必读完整个文件），记录在使用时再检查
+
+    // [first, first + count) 是否在 [0, total) 之内（不会溢出）
+    static bool within(uint64_t first, uint64_t count, uint64_t total) {
+        return first <= total && count <= total - first;
+    }
+
+    bool validDir(const DirRecord& d) const {
+        return within(d.pathOffset, d.pathLength, header->stringBytes) &&
+               within(d.firstEntry, d.entryCount, header->entryCount);
+    }
+
+    // 条目的名称在字符串区内，所在目录（查询时要读它的路径）也有效
+    bool validEntry(const EntryRecord& e) const {
+        return within(e.nameOffset, e.nameLength, header->stringBytes) && e.dirIndex < header->dirCount &&
+               (e.childDir == kNone || e.childDir < header->dirCount) && validDir(dirs[e.dirIndex]);
+    }
+
+    bool validTrigram(const TrigramRecord& t) const {
+        return within(t.firstPosting, t.count, header->postingCount);
+    }
+
+    // 增量更新会复用所有记录，并按名称拼出子目录路径再打开：重建前完整检查一遍
+    // （名称不能跳出所在目录）
+    bool validateAll() const {
+        for (uint64_t i = 0; i < header->dirCount; i++) {
+            if (!validDir(dirs[i])) {
+                return false;
+            }
+        }
+        for (uint64_t i = 0; i < header->entryCount; i++) {
+            if (!validEntry(entries[i])) {
+                return false;
+            }
+            std::string_view entryName = name(entries[i]);
+            if (entryName.empty() || entryName == "." || entryName == ".." ||
+                entryName.find('/') != std::string_view::npos) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view name(const EntryRecord& e) const {
+        return std::string_view(strings + e.nameOffset, e.nameLength);
+    }
+
+    std::string_view path(const DirRecord& d) const {
+        return std::string_view(strings + d.pathOffset, d.pathLength);
+    }
+
+    const TrigramRecord* findTrigram(uint32_t key) const {
+        const TrigramRecord* begin = trigrams;
+        const TrigramRecord* end = trigrams + header->trigramCount;
+        const TrigramRecord* it = std::lower_bound(begin, end, key,
+            [](const TrigramRecord& r, uint32_t k) { return r.key < k; });
+        return (it != end && it->key == key) ? it : nullptr;
+    }
+};
+
+// 索引构建器：按广度优先顺序处理目录，dirs 本身就是待处理队列
+class IndexBuilder {
+public:
+    IndexBuilder(const std::string& root, const IndexView* old) : root(root), old(old) {}
+
+    bool scan(PathIndex::BuildResult& result) {
+        rootFd.reset(::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!rootFd) {
+            result.error = std::strerror(errno);
+            return false;
+        }
+
+        addDir(std::string_view(), old != nullptr ? 0 : kNone);
+        for (size_t i = 0; i < dirs.size(); i++) {
+            scanDir(static_cast<uint32_t>(i), result);
+        }
+        result.dirs = dirs.size();
+        result.entries = entries.size();
+        return true;
+    }
+
+    bool write(const std::string& file, std::string& error) {
+        // 第一遍：统计每个三元组出现的次数
+        // 计数表覆盖全部 2^24 个 key，用 calloc 分配，只有实际用到的页才会占用内存
+        std::unique_ptr<uint32_t, void (*)(void*)> counts(
+            static_cast<uint32_t*>(std::calloc(1u << 24, sizeof(uint32_t))), std::free);
+        if (!counts) {
+            error = "out of memory";
+            return false;
+        }
+        uint32_t* cursor = counts.get();
+        std::vector<uint32_t> keys;
+        std::vector<uint32_t> usedKeys;
+        uint64_t postingCount = 0;
+        for (const auto& e : entries) {
+            collectTrigrams(std::string_view(strings.data() + e.nameOffset, e.nameLength), keys);
+            for (uint32_t key : keys) {
+                if (cursor[key]++ == 0) {
+                    usedKeys.push_back(key);
+                }
+            }
+            postingCount += keys.size();
+        }
+        std::sort(usedKeys.begin(), usedKeys.end());
+        if (postingCount >= kNone) {
+            error = "too many names to index";
+            return false;
+        }
+
+        // 计算每个三元组在倒排表中的起始位置
+        std::vector<TrigramRecord> trigrams;
+        uint32_t offset = 0;
+        for (uint32_t key : usedKeys) {
+            trigrams.push_back({key, cursor[key], offset});
+            uint32_t count = cursor[key];
+            cursor[key] = offset;
+            offset += count;
+        }
+
+        // 第二遍：按条目编号顺序填充，倒排表天然有序
+        std::vector<uint32_t> postings(postingCount);
+        for (size_t id = 0; id < entries.size(); id++) {
+            const auto& e = entries[id];
+            collectTrigrams(std::string_view(strings.data() + e.nameOffset, e.nameLength), keys);
+            for (uint32_t key : keys) {
+                postings[cursor[key]++] = static_cast<uint32_t>(id);
+            }
+        }
+
+        IndexHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.headerSize = sizeof(IndexHeader);
+        header.builtAt = static_cast<int64_t>(std::time(nullptr));
+        header.rootOffset = strings.size();
+        header.rootLength = root.size();
+        strings.append(root);
+        header.dirCount = dirs.size();
+        header.entryCount = entries.size();
+        header.trigramCount = trigrams.size();
+        header.postingCount = postings.size();
+        header.stringBytes = strings.size();
+
+        std::string buffer(sizeof(IndexHeader), '\0');
+        alignTo8(buffer);
+        header.dirsOffset = buffer.size();
+        appendArray(buffer, dirs);
+        alignTo8(buffer);
+        header.entriesOffset = buffer.size();
+        appendArray(buffer, entries);
+        alignTo8(buffer);
+        header.trigramsOffset = buffer.size();
+        appendArray(buffer, trigrams);
+        alignTo8(buffer);
+        header.postingsOffset = buffer.size();
+        appendArray(buffer, postings);
+        alignTo8(buffer);
+        header.stringsOffset = buffer.size();
+        buffer.append(strings);
+        std::memcpy(&buffer[0], &header, sizeof(header));
+
+        if (!writeFileAtomic(file, buffer.data(), buffer.size())) {
+            error = std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& root;
+    const IndexView* old;
+    UniqueFd rootFd;
+
+    std::string strings;
+    std::vector<DirRecord> dirs;
+    std::vector<uint32_t> oldDirs;  // 每个新目录对应的旧目录编号
+    std::vector<EntryRecord> entries;
+
+    uint32_t addDir(std::string_view path, uint32_t oldDir) {
+        DirRecord d{strings.size(), static_cast<uint32_t>(path.size()), 0, 0, -1, 0};
+        strings.append(path);
+        dirs.push_back(d);
+        oldDirs.push_back(oldDir);
+        return static_cast<uint32_t>(dirs.size() - 1);
+    }
+
+    void addEntry(uint32_t dirIndex, std::string_view name, uint8_t type, uint32_t oldChild) {
+        EntryRecord e;
+        std::memset(&e, 0, sizeof(e));
+        e.nameOffset = strings.size();
+        e.nameLength = static_cast<uint16_t>(name.size());
+        e.dirIndex = dirIndex;
+        e.childDir = kNone;
+        e.type = type;
+        strings.append(name);
+        if (type == kTypeDir) {
+            // 注意：addDir 会修改 strings，所以先拼好路径
+            std::string childPath(strings.data() + dirs[dirIndex].pathOffset, dirs[dirIndex].pathLength);
+            if (!childPath.empty()) {
+                childPath.push_back('/');
+            }
+            childPath.append(name);
+            e.childDir = addDir(childPath, oldChild);
+        }
+        entries.push_back(e);
+    }
+
+    void scanDir(uint32_t dirIndex, PathIndex::BuildResult& result) {
+        std::string path(strings.data() + dirs[dirIndex].pathOffset, dirs[dirIndex].pathLength);
+        dirs[dirIndex].firstEntry = entries.size();
+
+        Stats::add(Stats::OpenCalls);
+        int fd = openat(rootFd.get(), path.empty() ? "." : path.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        UniqueFd dirFd(fd);
+        struct stat st;
+        if (fstat(dirFd.get(), &st) != 0) {
+            return;
+        }
+
+        uint32_t oldDir = oldDirs[dirIndex];
+        if (oldDir != kNone) {
+            const DirRecord& od = old->dirs[oldDir];
+            if (od.mtimeSec == static_cast<int64_t>(st.st_mtim.tv_sec) &&
+                od.mtimeNsec == static_cast<int64_t>(st.st_mtim.tv_nsec)) {
+                // 目录没有变化：直接复用旧索引中的条目，不需要 readdir
+                for (uint64_t i = 0; i < od.entryCount; i++) {
+                    const EntryRecord& oe = old->entries[od.firstEntry + i];
+                    addEntry(dirIndex, old->name(oe), oe.type, oe.childDir);
+                }
+                finishDir(dirIndex, st);
+                result.reused++;
+                return;
+            }
+        }
+
+        // 目录有变化（或没有旧索引）：重新读取
+        std::unordered_map<std::string_view, uint32_t> oldChildren;
+        if (oldDir != kNone) {
+            const DirRecord& od = old->dirs[oldDir];
+            for (uint64_t i = 0; i < od.entryCount; i++) {
+                const EntryRecord& oe = old->entries[od.firstEntry + i];
+                if (oe.childDir != kNone) {
+                    oldChildren.emplace(old->name(oe), oe.childDir);
+                }
+            }
+        }
+
+        DIR* dir = fdopendir(dirFd.get());
+        if (dir == nullptr) {
+            return;
+        }
+        dirFd.release();
+        struct dirent* de;
+        while ((de = readdir(dir)) != nullptr) {
+            const char* name = de->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            Stats::add(Stats::Entries);
+            uint8_t type = typeFromDirent(dirfd(dir), de);
+            uint32_t oldChild = kNone;
+            if (type == kTypeDir && !oldChildren.empty()) {
+                auto it = oldChildren.find(std::string_view(name));
+                if (it != oldChildren.end()) {
+                    oldChild = it->second;
+                }
+            }
+            addEntry(dirIndex, std::string_view(name), type, oldChild);
+        }
+        closedir(dir);
+        finishDir(dirIndex, st);
+        result.rescanned++;
+    }
+
+    void finishDir(uint32_t dirIndex, const struct stat& st) {
+        DirRecord& d = dirs[dirIndex];
+        d.entryCount = static_cast<uint32_t>(entries.size() - d.firstEntry);
+        d.mtimeSec = static_cast<int64_t>(st.st_mtim.tv_sec);
+        d.mtimeNsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+    }
+};
+
+} // namespace
+
+std::string PathIndex::indexFileFor(const std::string& root) {
+    return cacheFilePath("index", root);
+}
+
+PathIndex::BuildResult PathIndex::build(const std::string& root) {
+    BuildResult result;
+    result.file = indexFileFor(root);
+    if (result.file.empty()) {
+        result.error = "cannot determine cache directory";
+        return result;
+    }
+
+    // 如果已有同一目录的旧索引，用它来跳过没有变化的目录
+    MappedFile oldFile;
+    IndexView oldView;
+    const IndexView* old = nullptr;
+    if (oldFile.open(result.file) && oldView.load(oldFile.data(), oldFile.size()) && oldView.validateAll() &&
+        std::string_view(oldView.strings + oldView.header->rootOffset, oldView.header->rootLength) == root) {
+        old = &oldView;
+    }
+
+    IndexBuilder builder(root, old);
+    if (!builder.scan(result)) {
+        return result;
+    }
+    if (!builder.write(result.file, result.error)) {
+        return result;
+    }
+    result.ok = true;
+    return result;
+}
+
+bool PathIndex::open(const std::string& path) {
+    IndexView view;
+    if (!file.open(path) || !view.load(file.data(), file.size())) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+std::string_view PathIndex::root() const {
+    IndexView view;
+    if (!view.load(file.data(), file.size())) {
+        return std::string_view();
+    }
+    return std::string_view(view.strings + view.header->rootOffset, view.header->rootLength);
+}
+
+uint64_t PathIndex::dirCount() const {
+    IndexView view;
+    return view.load(file.data(), file.size()) ? view.header->dirCount : 0;
+}
+
+uint64_t PathIndex::entryCount() const {
+    IndexView view;
+    return view.load(file.data(), file.size()) ? view.header->entryCount : 0;
+}
+
+int64_t PathIndex::builtAt() const {
+    IndexView view;
+    return view.load(file.data(), file.size()) ? view.header->builtAt : 0;
+}
+
+uint64_t PathIndex::search(std::string_view keyword, bool ignoreCase, std::string_view subtree,
+                           const MatchCallback& onMatch) const {
+    IndexView view;
+    if (keyword.empty() || !view.load(file.data(), file.size())) {
+        return 0;
+    }
+
+    // 1. 用三元组倒排表求候选集合（关键词不足 3 个字符时所有条目都是候选）
+    std::vector<uint32_t> candidates;
+    bool allCandidates = keyword.size() < 3;
+    if (!allCandidates) {
+        std::vector<uint32_t> keys;
+        collectTrigrams(keyword, keys);
+        std::vector<const TrigramRecord*> lists;
+        for (uint32_t key : keys) {
+            const TrigramRecord* record = view.findTrigram(key);
+            if (record == nullptr || !view.validTrigram(*record)) {
+                return 0;
+            }
+            lists.push_back(record);
+        }
+        // 从最短的倒排表开始求交集
+        std::sort(lists.begin(), lists.end(),
+            [](const TrigramRecord* a, const TrigramRecord* b) { return a->count < b->count; });
+        const uint32_t* first = view.postings + lists[0]->firstPosting;
+        candidates.assign(first, first + lists[0]->count);
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            const uint32_t* begin = view.postings + lists[i]->firstPosting;
+            const uint32_t* end = begin + lists[i]->count;
+            size_t kept = 0;
+            for (uint32_t id : candidates) {
+                begin = std::lower_bound(begin, end, id);
+                if (begin == end) {
+                    break;
+                }
+                if (*begin == id) {
+                    candidates[kept++] = id;
+                }
+            }
+            candidates.resize(kept);
+        }
+    }
+
+    // 2. 校验候选：名称确实包含关键词、位于指定子目录下、并且文件仍然存在
+    std::string_view rootPath(view.strings + view.header->rootOffset, view.header->rootLength);
+    UniqueFd rootFd(::open(std::string(rootPath).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (!rootFd) {
+        return 0;
+    }
+
+    uint64_t matches = 0;
+    uint64_t total = allCandidates ? view.header->entryCount : candidates.size();
+    std::string path;
+    struct stat st;
+    for (uint64_t i = 0; i < total; i++) {
+        uint64_t id = allCandidates ? i : candidates[i];
+        if (id >= view.header->entryCount || !view.validEntry(view.entries[id])) {
+            // 索引损坏：跳过这一条
+            continue;
+        }
+        const EntryRecord& e = view.entries[id];
+        std::string_view name = view.name(e);
+        bool hit = ignoreCase ? containsIgnoreCase(name, keyword)
+                              : name.find(keyword) != std::string_view::npos;
+        if (!hit) {
+            continue;
+        }
+
+        std::string_view dirPath = view.path(view.dirs[e.dirIndex]);
+        if (!subtree.empty()) {
+            if (dirPath.size() < subtree.size() || dirPath.compare(0, subtree.size(), subtree) != 0 ||
+                (dirPath.size() > subtree.size() && dirPath[subtree.size()] != '/')) {
+                continue;
+            }
+        }
+
+        path.assign(dirPath);
+        if (!path.empty()) {
+            path.push_back('/');
+        }
+        path.append(name);
+        Stats::add(Stats::StatCalls);
+        if (fstatat(rootFd.get(), path.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            // 索引建立后已被删除
+            continue;
+        }
+        matches++;
+        onMatch(path, S_ISDIR(st.st_mode));
+    }
+    return matches;
+}
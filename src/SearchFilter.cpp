@@ -0,0 +1,184 @@
+#include "../include/SearchFilter.h"
+#include <charconv>
+#include <cstdint>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+// 解析 [+|-]N[后缀]；units 为 false 时不允许后缀
+bool parseComparison(std::string_view text, bool units, int64_t& value, char& sign) {
+    sign = 0;
+    if (!text.empty() && (text[0] == '+' || text[0] == '-')) {
+        sign = text[0];
+        text.remove_prefix(1);
+    }
+    int64_t multiplier = 1;
+    if (units && !text.empty()) {
+        bool suffix = true;
+        switch (text.back()) {
+            case 'k': case 'K': multiplier = 1LL << 10; break;
+            case 'm': case 'M': multiplier = 1LL << 20; break;
+            case 'g': case 'G': multiplier = 1LL << 30; break;
+            case 't': case 'T': multiplier = 1LL << 40; break;
+            case 'c': case 'b': case 'B': multiplier = 1; break;
+            default: suffix = false; break;
+        }
+        // 只去掉认识的后缀，其他字符留给下面的数字解析报错（如 10x）
+        if (suffix) {
+            text.remove_suffix(1);
+        }
+    }
+    const char* end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, value);
+    if (text.empty() || result.ec != std::errc() || result.ptr != end || value < 0 ||
+        value > INT64_MAX / multiplier) {
+        return false;
+    }
+    value *= multiplier;
+    return true;
+}
+
+} // namespace
+
+bool SearchFilter::parse(const ArgList& args, std::string& error) {
+    // -i 可以出现在任意位置，编译模式之前先确定
+    for (const auto& arg : args) {
+        if (arg == "-i") {
+            ignoreCaseFlag = true;
+        }
+    }
+    now = std::time(nullptr);
+
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string_view arg = args[i];
+        if (arg == "-i") {
+            continue;
+        }
+        if (arg.empty() || arg[0] != '-') {
+            if (!keywordText.empty()) {
+                error = "Unexpected argument: " + std::string(arg);
+                return false;
+            }
+            keywordText.assign(arg);
+            continue;
+        }
+
+        bool known = arg == "-name" || arg == "-regex" || arg == "-type" || arg == "-size" ||
+                     arg == "-mtime" || arg == "-maxdepth" || arg == "-prune";
+        if (!known) {
+            error = "Unknown option: " + std::string(arg);
+            return false;
+        }
+        if (i + 1 >= args.size()) {
+            error = "Missing value for " + std::string(arg);
+            return false;
+        }
+        std::string_view value = args[++i];
+        hasPredicates = true;
+
+        if (arg == "-name" || arg == "-regex" || arg == "-prune") {
+            NamePattern pattern;
+            NamePattern::Syntax syntax = arg == "-regex" ? NamePattern::Syntax::Regex : NamePattern::Syntax::Glob;
+            // -prune 按名称字面比较目录名，不受 -i 影响
+            if (!pattern.compile(value, syntax, ignoreCaseFlag && arg != "-prune", error)) {
+                error = "Invalid pattern for " + std::string(arg) + ": " + std::string(value) + " (" + error + ")";
+                return false;
+            }
+            (arg == "-prune" ? prunePatterns : namePatterns).push_back(std::move(pattern));
+        } else if (arg == "-type") {
+            if (value == "f") {
+                type = DT_REG;
+            } else if (value == "d") {
+                type = DT_DIR;
+            } else if (value == "l") {
+                type = DT_LNK;
+            } else {
+                error = "Invalid type: " + std::string(value) + " (use f, d or l)";
+                return false;
+            }
+        } else if (arg == "-size" || arg == "-mtime") {
+            int64_t number = 0;
+            char sign = 0;
+            if (!parseComparison(value, arg == "-size", number, sign)) {
+                error = "Invalid value for " + std::string(arg) + ": " + std::string(value);
+                return false;
+            }
+            Comparison comparison;
+            comparison.op = sign == '+' ? Comparison::Op::Greater
+                          : sign == '-' ? Comparison::Op::Less
+                                        : Comparison::Op::Equal;
+            comparison.value = number;
+            (arg == "-size" ? size : mtimeDays) = comparison;
+        } else {
+            int64_t depth = 0;
+            char sign = 0;
+            if (!parseComparison(value, false, depth, sign) || sign != 0 || depth < 1 || depth > 4096) {
+                error = "Invalid value for -maxdepth: " + std::string(value) + " (use 1 or more)";
+                return false;
+            }
+            maxDepth = static_cast<int>(depth);
+        }
+    }
+
+    if (!keywordText.empty()) {
+        keywordMatcher.emplace(keywordText, ignoreCaseFlag);
+    }
+    return true;
+}
+
+void SearchFilter::apply(WalkOptions& options) const {
+    options.statEntries = false;
+    options.maxDepth = maxDepth;
+}
+
+bool SearchFilter::matches(WalkEntry& entry, bool& descend) const {
+    descend = true;
+
+    // 1. 被剪掉的目录：不进入、不输出
+    if (entry.isDir) {
+        for (const auto& pattern : prunePatterns) {
+            if (pattern.matches(entry.name.data(), entry.name.size())) {
+                descend = false;
+                return false;
+            }
+        }
+    }
+
+    // 2. 只需要名称和 d_type 的条件
+    if (type != 0 && entry.type != DT_UNKNOWN && entry.type != type) {
+        return false;
+    }
+    if (keywordMatcher && !keywordMatcher->matches(entry.name.data(), entry.name.size())) {
+        return false;
+    }
+    for (const auto& pattern : namePatterns) {
+        if (!pattern.matches(entry.name.data(), entry.name.size())) {
+            return false;
+        }
+    }
+
+    // 3. 需要 stat 的条件：只有通过了前面所有检查的条目才会走到这里
+    bool needStat = size || mtimeDays || (type != 0 && entry.type == DT_UNKNOWN);
+    if (!needStat) {
+        return true;
+    }
+    const struct stat* st = entry.stat();
+    if (st == nullptr) {
+        return false;
+    }
+    if (type != 0 && IFTODT(st->st_mode) != type) {
+        return false;
+    }
+    if (size && !size->test(static_cast<int64_t>(st->st_size))) {
+        return false;
+    }
+    if (mtimeDays) {
+        int64_t age = static_cast<int64_t>(now) - static_cast<int64_t>(st->st_mtim.tv_sec);
+        int64_t days = age >= 0 ? age / 86400 : -((-age + 86399) / 86400);
+        if (!mtimeDays->test(days)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,255 @@
+#include "../include/Stats.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kCounterNames[Stats::kCounterCount] = {"entries", "bytes", "stat", "open", "getdents"};
+
+// 耗时直方图：第 0 个桶是不到 1 微秒，第 b 个桶是 [2^(b-1), 2^b) 微秒
+const size_t kBucketCount = 32;
+
+struct CommandStats {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t histogram[kBucketCount] = {};
+    Stats::Totals counters;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<CommandStats> commands;
+    Stats::Totals baseline;   // reset 时的计数器之和，之后的读数都减去它
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+size_t bucketOf(uint64_t nanoseconds) {
+    uint64_t micros = nanoseconds / 1000;
+    if (micros == 0) {
+        return 0;
+    }
+    size_t bucket = static_cast<size_t>(64 - __builtin_clzll(micros));
+    return bucket < kBucketCount ? bucket : kBucketCount - 1;
+}
+
+// 直方图中第 p 分位所在桶的上界（微秒）
+uint64_t percentileMicros(const CommandStats& command, double p) {
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(command.calls));
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBucketCount; b++) {
+        seen += command.histogram[b];
+        if (seen >= rank) {
+            return uint64_t(1) << b;
+        }
+    }
+    return uint64_t(1) << (kBucketCount - 1);
+}
+
+} // namespace
+
+// ========== 每线程的槽位 ==========
+
+// 槽位只增不减，线程退出后标记为空闲，由之后的线程复用（计数器保留）
+struct Stats::SlotOwner {
+    static inline std::mutex mutex;
+    static inline std::vector<std::unique_ptr<Slot>> slots;
+
+    Slot* slot = nullptr;
+
+    ~SlotOwner() {
+        if (slot != nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->inUse = false;
+            current = nullptr;
+        }
+    }
+
+    // 所有槽位（包括空闲的）的计数器之和
+    static Totals sum() {
+        Totals total;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& item : slots) {
+            for (size_t i = 0; i < kCounterCount; i++) {
+                total.counters[i] += item->counters[i].load(std::memory_order_relaxed);
+            }
+        }
+        return total;
+    }
+};
+
+Stats::Slot* Stats::acquireSlot() {
+    static thread_local SlotOwner owner;
+    std::lock_guard<std::mutex> lock(SlotOwner::mutex);
+    Slot* found = nullptr;
+    for (const auto& item : SlotOwner::slots) {
+        if (!item->inUse) {
+            found = item.get();
+            break;
+        }
+    }
+    if (found == nullptr) {
+        SlotOwner::slots.push_back(std::make_unique<Slot>());
+        found = SlotOwner::slots.back().get();
+    }
+    found->inUse = true;
+    owner.slot = found;
+    current = found;
+    return found;
+}
+
+Stats::Totals Stats::totals() {
+    Totals sum = SlotOwner::sum();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t i = 0; i < kCounterCount; i++) {
+        sum.counters[i] -= reg.baseline.counters[i];
+    }
+    return sum;
+}
+
+// ========== 命令统计 ==========
+
+void Stats::recordCommand(std::string_view name, uint64_t nanoseconds, const Totals& delta) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    CommandStats* command = nullptr;
+    for (CommandStats& item : reg.commands) {
+        if (item.name == name) {
+            command = &item;
+            break;
+        }
+    }
+    if (command == nullptr) {
+        reg.commands.emplace_back();
+        command = &reg.commands.back();
+        command->name = std::string(name);
+    }
+    command->calls++;
+    command->totalNs += nanoseconds;
+    if (nanoseconds > command->maxNs) {
+        command->maxNs = nanoseconds;
+    }
+    command->histogram[bucketOf(nanoseconds)]++;
+    for (size_t i = 0; i < kCounterCount; i++) {
+        command->counters.counters[i] += delta.counters[i];
+    }
+}
+
+void Stats::reset() {
+    Totals raw = SlotOwner::sum();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.commands.clear();
+    reg.baseline = raw;
+}
+
+Stats::CommandTimer::CommandTimer(std::string_view name) : name(name), armed(Stats::enabled()) {
+    // 直接使用各槽位的原始和，执行期间 reset 不影响增量
+    if (armed) {
+        before = SlotOwner::sum();
+        start = nowNs();
+    }
+}
+
+Stats::CommandTimer::~CommandTimer() {
+    if (!armed) {
+        return;
+    }
+    uint64_t elapsed = nowNs() - start;
+    Totals after = SlotOwner::sum();
+    for (size_t i = 0; i < kCounterCount; i++) {
+        after.counters[i] -= before.counters[i];
+    }
+    recordCommand(name, elapsed, after);
+}
+
+// ========== 输出 ==========
+
+void Stats::print(std::ostream& out) {
+    Totals sum = totals();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    out << "Stats: " << (enabled() ? "on" : "off") << '\n';
+    char line[320];
+    std::snprintf(line, sizeof(line), "%-10s %8s %12s %10s %10s %10s %12s %12s %14s %10s %10s %10s\n",
+                  "Command", "Calls", "Total(ms)", "Mean(us)", "p50(us)", "p99(us)", "Max(us)", "Entries", "Bytes",
+                  "stat", "open", "getdents");
+    out << line;
+    for (const CommandStats& command : reg.commands) {
+        std::snprintf(line, sizeof(line), "%-10s %8llu %12.3f %10.1f %10llu %10llu %12.1f %12llu %14llu %10llu %10llu %10llu\n",
+                      command.name.c_str(), static_cast<unsigned long long>(command.calls),
+                      static_cast<double>(command.totalNs) / 1e6,
+                      static_cast<double>(command.totalNs) / 1e3 / static_cast<double>(command.calls),
+                      static_cast<unsigned long long>(percentileMicros(command, 0.50)),
+                      static_cast<unsigned long long>(percentileMicros(command, 0.99)),
+                      static_cast<double>(command.maxNs) / 1e3,
+                      static_cast<unsigned long long>(command.counters.counters[Entries]),
+                      static_cast<unsigned long long>(command.counters.counters[Bytes]),
+                      static_cast<unsigned long long>(command.counters.counters[StatCalls]),
+                      static_cast<unsigned long long>(command.counters.counters[OpenCalls]),
+                      static_cast<unsigned long long>(command.counters.counters[GetdentsCalls]));
+        out << line;
+    }
+    out << "Totals:";
+    for (size_t i = 0; i < kCounterCount; i++) {
+        out << ' ' << kCounterNames[i] << '=' << sum.counters[i];
+    }
+    out << '\n';
+    out << "(p50/p99 are upper bounds of power-of-two buckets)\n";
+}
+
+void Stats::writeJson(std::ostream& out) {
+    Totals sum = totals();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    out << "{\n  \"enabled\": " << (enabled() ? "true" : "false") << ",\n  \"totals\": {";
+    for (size_t i = 0; i < kCounterCount; i++) {
+        out << (i == 0 ? "" : ", ") << '"' << kCounterNames[i] << "\": " << sum.counters[i];
+    }
+    out << "},\n  \"commands\": [";
+    for (size_t c = 0; c < reg.commands.size(); c++) {
+        const CommandStats& command = reg.commands[c];
+        // 命令名来自用户输入，只保留可以直接放进 JSON 字符串的字符
+        std::string name;
+        for (char ch : command.name) {
+            name.push_back(ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20 ? '?' : ch);
+        }
+        out << (c == 0 ? "\n" : ",\n") << "    {\"name\": \"" << name << "\", \"calls\": " << command.calls
+            << ", \"total_ns\": " << command.totalNs << ", \"max_ns\": " << command.maxNs;
+        for (size_t i = 0; i < kCounterCount; i++) {
+            out << ", \"" << kCounterNames[i] << "\": " << command.counters.counters[i];
+        }
+        // 直方图：去掉末尾的空桶，第 b 个元素是 [2^(b-1), 2^b) 微秒内的次数
+        size_t last = kBucketCount;
+        while (last > 0 && command.histogram[last - 1] == 0) {
+            last--;
+        }
+        out << ", \"histogram_us_log2\": [";
+        for (size_t b = 0; b < last; b++) {
+            out << (b == 0 ? "" : ", ") << command.histogram[b];
+        }
+        out << "]}";
+    }
+    out << (reg.commands.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
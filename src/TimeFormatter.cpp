@@ -0,0 +1,118 @@
+#include "../include/TimeFormatter.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// "00" "01" ... "99"：每次写两位数字，不做除法求每一位
+const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const std::time_t kSecondsPerDay = 86400;
+
+inline void putTwo(char* out, unsigned value) {
+    std::memcpy(out, kDigitPairs + 2 * value, 2);
+}
+
+// 一天的缓存：[start, end) 内的时间戳都属于这一天，UTC 偏移相同
+struct DaySlot {
+    std::time_t start = 1;
+    std::time_t end = 0;      // start > end 表示空
+    char prefix[11];          // "YYYY-MM-DD "
+};
+
+const size_t kSlotCount = 64;   // 直接映射：按时间戳所在的天数选择槽位
+thread_local DaySlot slots[kSlotCount];
+
+// 写日期前缀 "YYYY-MM-DD "（年份必须在 0..9999 之间）
+void putDate(char* out, const std::tm& tm) {
+    unsigned year = static_cast<unsigned>(tm.tm_year + 1900);
+    putTwo(out, year / 100);
+    putTwo(out + 2, year % 100);
+    out[4] = '-';
+    putTwo(out + 5, static_cast<unsigned>(tm.tm_mon + 1));
+    out[7] = '-';
+    putTwo(out + 8, static_cast<unsigned>(tm.tm_mday));
+    out[10] = ' ';
+}
+
+// 写 "HH:MM:SS"
+void putClock(char* out, unsigned hour, unsigned minute, unsigned second) {
+    putTwo(out, hour);
+    out[2] = ':';
+    putTwo(out + 3, minute);
+    out[5] = ':';
+    putTwo(out + 6, second);
+}
+
+size_t putUnknown(char* buffer) {
+    buffer[0] = '-';
+    buffer[1] = '\0';
+    return 1;
+}
+
+} // namespace
+
+size_t TimeFormatter::format(std::time_t seconds, char* buffer) {
+    DaySlot& slot = slots[static_cast<uint64_t>(seconds) / kSecondsPerDay % kSlotCount];
+
+    // ========== 命中：同一天只需要一次减法 ==========
+    if (seconds >= slot.start && seconds < slot.end) {
+        unsigned offset = static_cast<unsigned>(seconds - slot.start);
+        std::memcpy(buffer, slot.prefix, sizeof(slot.prefix));
+        putClock(buffer + 11, offset / 3600, offset / 60 % 60, offset % 60);
+        buffer[kLength] = '\0';
+        return kLength;
+    }
+
+    // ========== 未命中：调用一次 localtime_r ==========
+    std::tm tm;
+    if (localtime_r(&seconds, &tm) == nullptr || tm.tm_year + 1900 < 0 || tm.tm_year + 1900 > 9999) {
+        return putUnknown(buffer);
+    }
+    putDate(buffer, tm);
+    putClock(buffer + 11, static_cast<unsigned>(tm.tm_hour), static_cast<unsigned>(tm.tm_min),
+             static_cast<unsigned>(tm.tm_sec > 59 ? 59 : tm.tm_sec));
+    buffer[kLength] = '\0';
+
+    // 只有一整天 UTC 偏移都不变（当天第一秒和最后一秒的偏移与当前相同）才放入缓存，
+    // 夏令时切换的那一天每次都调用 localtime_r
+    std::time_t dayStart = seconds - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+    std::time_t lastSecond = dayStart + kSecondsPerDay - 1;
+    std::tm first;
+    std::tm last;
+    if (localtime_r(&dayStart, &first) != nullptr && localtime_r(&lastSecond, &last) != nullptr &&
+        first.tm_gmtoff == tm.tm_gmtoff && last.tm_gmtoff == tm.tm_gmtoff &&
+        first.tm_mday == tm.tm_mday && first.tm_hour == 0 && first.tm_min == 0 && first.tm_sec == 0 &&
+        last.tm_mday == tm.tm_mday && last.tm_hour == 23 && last.tm_min == 59 && last.tm_sec == 59) {
+        slot.start = dayStart;
+        slot.end = dayStart + kSecondsPerDay;
+        std::memcpy(slot.prefix, buffer, sizeof(slot.prefix));
+    }
+    return kLength;
+}
+
+std::string TimeFormatter::format(std::time_t seconds) {
+    char buffer[kBufferSize];
+    size_t length = format(seconds, buffer);
+    return std::string(buffer, length);
+}
+
+std::string TimeFormatter::format(const std::filesystem::file_time_type& fileTime) {
+    using namespace std::chrono;
+    using FileClock = std::filesystem::file_time_type::clock;
+
+    // 文件时钟与系统时钟之间的差值只在第一次调用时计算（静态局部变量的初始化是线程安全的）
+    static const int64_t clockOffset =
+        duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count() -
+        duration_cast<nanoseconds>(FileClock::now().time_since_epoch()).count();
+
+    int64_t ns = 0;
+    if (fileTime == std::filesystem::file_time_type::min() ||
+        __builtin_add_overflow(duration_cast<nanoseconds>(fileTime.time_since_epoch()).count(), clockOffset, &ns)) {
+        return "-";
+    }
+    return format(fromNanoseconds(ns));
+}
@@ -0,0 +1,234 @@
+#include "../include/Tokenizer.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// 普通字符：不需要任何处理，可以直接引用输入行
+inline bool isPlain(char c) {
+    return !isSpace(c) && c != '\'' && c != '"' && c != '\\' && c != ';';
+}
+
+} // namespace
+
+bool Tokenizer::verbatim(size_t i) const {
+    return verbatim(tokens[i]);
+}
+
+bool Tokenizer::verbatim(std::string_view token) const {
+    // 去掉引号/转义的参数都在 unescaped 中（空参数 "" 指向它的末尾），其余的指向输入行
+    const char* p = token.data();
+    std::less_equal<const char*> lessEqual;
+    return !(lessEqual(unescaped.data(), p) && lessEqual(p, unescaped.data() + unescaped.size()));
+}
+
+Tokenizer::Status Tokenizer::tokenize(std::string_view line, size_t& used) {
+    tokens.clear();
+    unescaped.clear();
+    // 预留足够的空间：之后写入 unescaped 不会重新分配，已有的 string_view 保持有效
+    if (unescaped.capacity() < line.size()) {
+        unescaped.reserve(line.size());
+    }
+
+    size_t i = 0;
+    size_t n = line.size();
+    while (true) {
+        while (i < n && isSpace(line[i])) {
+            i++;
+        }
+        if (i >= n) {
+            used = n;
+            return Status::Ok;
+        }
+        if (line[i] == ';') {
+            used = i + 1;
+            return Status::Ok;
+        }
+
+        // ========== 快速路径：整个参数都是普通字符 ==========
+        size_t start = i;
+        while (i < n && isPlain(line[i])) {
+            i++;
+        }
+        if (i >= n || isSpace(line[i]) || line[i] == ';') {
+            tokens.push_back(line.substr(start, i - start));
+            continue;
+        }
+
+        // ========== 含引号或转义：去掉引号/转义后写入缓冲区 ==========
+        size_t outStart = unescaped.size();
+        unescaped.append(line.data() + start, i - start);
+        while (i < n && !isSpace(line[i]) && line[i] != ';') {
+            char c = line[i];
+            if (c == '\\') {
+                if (i + 1 >= n) {
+                    used = n;
+                    return Status::TrailingBackslash;
+                }
+                unescaped.push_back(line[i + 1]);
+                i += 2;
+            } else if (c == '\'') {
+                size_t close = line.find('\'', i + 1);
+                if (close == std::string_view::npos) {
+                    used = n;
+                    return Status::UnterminatedQuote;
+                }
+                unescaped.append(line.data() + i + 1, close - i - 1);
+                i = close + 1;
+            } else if (c == '"') {
+                i++;
+                while (i < n && line[i] != '"') {
+                    if (line[i] == '\\' && i + 1 < n && (line[i + 1] == '"' || line[i + 1] == '\\')) {
+                        i++;
+                    }
+                    unescaped.push_back(line[i]);
+                    i++;
+                }
+                if (i >= n) {
+                    used = n;
+                    return Status::UnterminatedQuote;
+                }
+                i++;
+            } else {
+                unescaped.push_back(c);
+                i++;
+            }
+        }
+        tokens.push_back(std::string_view(unescaped.data() + outStart, unescaped.size() - outStart));
+    }
+}
+
+// ========== 花括号展开 ==========
+
+namespace {
+
+// text 是否为 [+|-]数字，是则保存数值、是否有前导 0
+bool parseRangeNumber(std::string_view text, long long& value, bool& padded) {
+    size_t start = (!text.empty() && (text[0] == '-' || text[0] == '+')) ? 1 : 0;
+    if (start >= text.size() || text.size() - start > 18) {
+        return false;
+    }
+    long long number = 0;
+    for (size_t i = start; i < text.size(); i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        number = number * 10 + (text[i] - '0');
+    }
+    value = text[0] == '-' ? -number : number;
+    padded = text.size() - start > 1 && text[start] == '0';
+    return true;
+}
+
+// 展开花括号内的 body（不含括号），结果写入 items；不构成展开时返回 false
+bool expandBody(std::string_view body, std::vector<std::string>& items, size_t limit) {
+    // 逗号列表：只看最外层的逗号
+    int depth = 0;
+    size_t start = 0;
+    bool hasComma = false;
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i] == '{') {
+            depth++;
+        } else if (body[i] == '}') {
+            depth--;
+        } else if (body[i] == ',' && depth == 0) {
+            items.emplace_back(body.substr(start, i - start));
+            start = i + 1;
+            hasComma = true;
+        }
+    }
+    if (hasComma) {
+        items.emplace_back(body.substr(start));
+        return true;
+    }
+
+    // 范围：x..y
+    size_t dots = body.find("..");
+    if (dots == std::string_view::npos) {
+        return false;
+    }
+    std::string_view first = body.substr(0, dots);
+    std::string_view last = body.substr(dots + 2);
+    long long from = 0;
+    long long to = 0;
+    bool fromPadded = false;
+    bool toPadded = false;
+    if (parseRangeNumber(first, from, fromPadded) && parseRangeNumber(last, to, toPadded)) {
+        size_t width = (fromPadded || toPadded) ? std::max(first.size(), last.size()) : 0;
+        long long step = from <= to ? 1 : -1;
+        for (long long value = from;; value += step) {
+            if (items.size() >= limit) {
+                return true;
+            }
+            std::string number = std::to_string(value < 0 ? -value : value);
+            size_t digits = width > 0 && value < 0 ? width - 1 : width;
+            if (number.size() < digits) {
+                number.insert(0, digits - number.size(), '0');
+            }
+            items.push_back(value < 0 ? "-" + number : number);
+            if (value == to) {
+                break;
+            }
+        }
+        return true;
+    }
+    auto isLetter = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+    if (first.size() == 1 && last.size() == 1 && isLetter(first[0]) && isLetter(last[0])) {
+        int step = first[0] <= last[0] ? 1 : -1;
+        for (int c = first[0];; c += step) {
+            items.emplace_back(1, static_cast<char>(c));
+            if (c == last[0]) {
+                break;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool expandBraces(std::string_view pattern, std::vector<std::string>& out, size_t limit) {
+    // 找到第一个构成展开的 {...}，对每一项把 前缀 + 项 + 后缀 再递归展开
+    for (size_t open = pattern.find('{'); open != std::string_view::npos; open = pattern.find('{', open + 1)) {
+        int depth = 0;
+        size_t close = open;
+        for (; close < pattern.size(); close++) {
+            if (pattern[close] == '{') {
+                depth++;
+            } else if (pattern[close] == '}' && --depth == 0) {
+                break;
+            }
+        }
+        if (close >= pattern.size()) {
+            break;
+        }
+
+        std::vector<std::string> items;
+        if (!expandBody(pattern.substr(open + 1, close - open - 1), items, limit + 1)) {
+            continue;
+        }
+        std::string_view prefix = pattern.substr(0, open);
+        std::string_view suffix = pattern.substr(close + 1);
+        std::string combined;
+        for (const auto& item : items) {
+            combined.assign(prefix);
+            combined.append(item);
+            combined.append(suffix);
+            if (!expandBraces(combined, out, limit)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (out.size() >= limit) {
+        return false;
+    }
+    out.emplace_back(pattern);
+    return true;
+}
@@ -0,0 +1,559 @@
+#include "../include/TreeCopier.h"
+#include "../include/BoundedQueue.h"
+#include "../include/CopyEngine.h"
+#include "../include/FileUtils.h"
+#include "../include/IoUring.h"
+#include "../include/JobControl.h"
+#include "../include/Stats.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 队列容量：限制遍历线程最多领先复制线程多少个文件
+const size_t kQueueCapacity = 4096;
+
+// 同时打开的目录对（每对两个 fd）上限的范围；实际上限取 RLIMIT_NOFILE / 8，
+// 队列中的文件任务会让所在目录对保持打开，只限制队列长度不能限制 fd 数量
+const size_t kMinOpenDirs = 8;
+const size_t kMaxOpenDirs = 4096;
+
+// io_uring 每批处理的文件数
+const size_t kBatchSize = 32;
+
+// 不超过这个大小的文件直接用 io_uring 读写（每个批次槽位一个缓冲区）
+const size_t kSmallFileSize = 128 * 1024;
+
+// 一对已打开的源/目标目录；文件任务持有它的 shared_ptr，全部完成后自动关闭
+struct DirPair {
+    UniqueFd src;
+    UniqueFd dst;
+};
+
+// 一个待复制的普通文件
+struct FileJob {
+    std::shared_ptr<DirPair> dir;
+    std::string name;
+    std::string path;      // 相对根的路径，用于错误提示
+    mode_t mode = 0;
+    uint64_t size = 0;
+    struct timespec times[2];
+};
+
+// 等待遍历的目录（不持有父目录：父目录还打开着时相对它打开，否则按路径从根打开）
+struct PendingDir {
+    std::weak_ptr<DirPair> parent;
+    std::string name;
+    std::string path;
+};
+
+// 需要在最后设置的目录元数据
+struct DirMeta {
+    std::string path;
+    mode_t mode;
+    struct timespec times[2];
+};
+
+class TreeCopyRun {
+public:
+    TreeCopyRun(const TreeCopyOptions& options, TreeCopyStats& stats)
+        : options(options), stats(stats), queue(kQueueCapacity) {
+        struct rlimit limit;
+        maxOpenDirs = kMaxOpenDirs;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            maxOpenDirs = std::clamp<size_t>(static_cast<size_t>(limit.rlim_cur / 8), kMinOpenDirs, kMaxOpenDirs);
+        }
+    }
+
+    void run(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst) {
+        // ========== 创建根目录 ==========
+        auto root = std::make_shared<DirPair>();
+        Stats::add(Stats::OpenCalls, 2);
+        root->src.reset(openat(srcBaseFd, src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        struct stat rootStat;
+        if (!root->src || fstat(root->src.get(), &rootStat) != 0) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        if (mkdirat(dstBaseFd, dst.c_str(), 0700) != 0) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        root->dst.reset(openat(dstBaseFd, dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!root->dst) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        stats.ok = true;
+        stats.dirs = 1;
+        srcRootFd.reset(dup(root->src.get()));
+        dstRootFd.reset(dup(root->dst.get()));
+
+        // ========== 启动复制线程，然后在当前线程遍历 ==========
+        unsigned threads = options.threads;
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+            if (threads < 4) {
+                threads = 4;
+            }
+        }
+        bool uring = options.useIoUring && IoUring::supported();
+        stats.threads = threads;
+        stats.backend = uring ? "io_uring" : "thread pool";
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back([this, uring]() {
+                if (uring) {
+                    uringWorker();
+                } else {
+                    syncWorker();
+                }
+            });
+        }
+
+        enumerate(std::move(root));
+        queue.close();
+        for (auto& t : workers) {
+            t.join();
+        }
+
+        // ========== 最后设置目录的权限和时间（从最深的目录开始） ==========
+        for (auto it = metas.rbegin(); it != metas.rend(); ++it) {
+            fchmodat(dstRootFd.get(), it->path.c_str(), it->mode & 07777, 0);
+            utimensat(dstRootFd.get(), it->path.c_str(), it->times, 0);
+        }
+        struct timespec rootTimes[2] = {rootStat.st_atim, rootStat.st_mtim};
+        fchmod(dstRootFd.get(), rootStat.st_mode & 07777);
+        futimens(dstRootFd.get(), rootTimes);
+
+        stats.files = files.load();
+        stats.bytes = bytes.load();
+        stats.errors += errors.load();
+        stats.cancelled = cancelled();
+    }
+
+private:
+    const TreeCopyOptions& options;
+    TreeCopyStats& stats;
+    BoundedQueue<FileJob> queue;
+    std::vector<DirMeta> metas;
+
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+    std::mutex errorMutex;
+
+    // 根目录 fd 的副本：父目录已经关闭的子目录按路径从这里打开
+    UniqueFd srcRootFd;
+    UniqueFd dstRootFd;
+
+    // 已打开的目录对计数（不含根）；达到上限时遍历线程等待复制线程用完之前的目录
+    size_t maxOpenDirs;
+    size_t openDirs = 0;
+    std::mutex openDirsMutex;
+    std::condition_variable openDirsReleased;
+
+    bool cancelled() const {
+        return options.control != nullptr && options.control->isCancelled();
+    }
+
+    void addBytes(uint64_t n) {
+        bytes += n;
+        if (options.control != nullptr) {
+            options.control->addBytes(n);
+        }
+    }
+
+    void recordError(const std::string& path, int error) {
+        errors++;
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (stats.firstError.empty()) {
+            stats.firstError = path + ": " + std::strerror(error);
+        }
+    }
+
+    // ========== 第一级：遍历源目录树 ==========
+    void enumerate(std::shared_ptr<DirPair> root) {
+        std::vector<char> buffer(DirReader::kBufferSize);
+        std::vector<PendingDir> stack;
+        std::shared_ptr<DirPair> current = std::move(root);
+        std::string currentPath;
+
+        while (!cancelled()) {
+            if (current) {
+                scanDir(current, currentPath, buffer, stack);
+                current.reset();
+            }
+            if (stack.empty()) {
+                break;
+            }
+            PendingDir next = std::move(stack.back());
+            stack.pop_back();
+
+            std::shared_ptr<DirPair> pair = acquireDirPair();
+            std::shared_ptr<DirPair> parent = next.parent.lock();
+            int srcBase = parent ? parent->src.get() : srcRootFd.get();
+            int dstBase = parent ? parent->dst.get() : dstRootFd.get();
+            const std::string& name = parent ? next.name : next.path;
+            Stats::add(Stats::OpenCalls, 2);
+            pair->src.reset(openat(srcBase, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+            pair->dst.reset(openat(dstBase, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+            parent.reset();
+            if (!pair->src || !pair->dst) {
+                recordError(next.path, errno);
+                continue;
+            }
+            current = std::move(pair);
+            currentPath = std::move(next.path);
+        }
+    }
+
+    // 新建一个目录对（计入打开数量，全部引用释放时减回）；已达上限时等待
+    std::shared_ptr<DirPair> acquireDirPair() {
+        {
+            std::unique_lock<std::mutex> lock(openDirsMutex);
+            openDirsReleased.wait(lock, [this]() { return openDirs < maxOpenDirs; });
+            openDirs++;
+        }
+        return std::shared_ptr<DirPair>(new DirPair, [this](DirPair* pair) {
+            delete pair;
+            {
+                std::lock_guard<std::mutex> lock(openDirsMutex);
+                openDirs--;
+            }
+            openDirsReleased.notify_one();
+        });
+    }
+
+    void scanDir(const std::shared_ptr<DirPair>& dir, const std::string& dirPath,
+                 std::vector<char>& buffer, std::vector<PendingDir>& stack) {
+        DirReader reader(dir->src.get(), buffer.data(), buffer.size());
+        DirEntryView de;
+        struct stat st;
+        std::vector<char> linkTarget;
+
+        uint64_t seen = 0;
+        while (reader.next(de)) {
+            seen++;
+            if (cancelled()) {
+                break;
+            }
+            std::string path = dirPath.empty() ? std::string(de.name) : dirPath + "/" + de.name;
+            Stats::add(Stats::StatCalls);
+            if (fstatat(dir->src.get(), de.name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                recordError(path, errno);
+                continue;
+            }
+
+            if (S_ISREG(st.st_mode)) {
+                FileJob job;
+                job.dir = dir;
+                job.name.assign(de.name, de.nameLength);
+                job.path = std::move(path);
+                job.mode = st.st_mode;
+                job.size = static_cast<uint64_t>(st.st_size);
+                job.times[0] = st.st_atim;
+                job.times[1] = st.st_mtim;
+                queue.push(std::move(job));
+            } else if (S_ISDIR(st.st_mode)) {
+                // 先以 0700 创建，保证可以写入子项；最终权限在最后设置
+                if (mkdirat(dir->dst.get(), de.name, 0700) != 0) {
+                    recordError(path, errno);
+                    continue;
+                }
+                stats.dirs++;
+                metas.push_back({path, st.st_mode, {st.st_atim, st.st_mtim}});
+                stack.push_back({dir, std::string(de.name, de.nameLength), std::move(path)});
+            } else if (S_ISLNK(st.st_mode)) {
+                linkTarget.resize(static_cast<size_t>(st.st_size) + 1);
+                ssize_t n = readlinkat(dir->src.get(), de.name, linkTarget.data(), linkTarget.size());
+                if (n < 0 || static_cast<size_t>(n) >= linkTarget.size()) {
+                    recordError(path, n < 0 ? errno : ENAMETOOLONG);
+                    continue;
+                }
+                linkTarget[static_cast<size_t>(n)] = '\0';
+                if (symlinkat(linkTarget.data(), dir->dst.get(), de.name) != 0) {
+                    recordError(path, errno);
+                    continue;
+                }
+                struct timespec times[2] = {st.st_atim, st.st_mtim};
+                utimensat(dir->dst.get(), de.name, times, AT_SYMLINK_NOFOLLOW);
+                stats.symlinks++;
+            } else {
+                // 设备文件、FIFO、socket 不复制
+                stats.skipped++;
+            }
+        }
+        if (reader.error() != 0) {
+            recordError(dirPath.empty() ? "." : dirPath, reader.error());
+        }
+        if (options.control != nullptr) {
+            options.control->addEntries(seen);
+        }
+    }
+
+    // 删除没有复制成功的目标文件（否则留下空文件/不完整的文件，O_EXCL 还会让重试失败）
+    void discard(const FileJob& job, UniqueFd& out) {
+        out.reset();
+        unlinkat(job.dir->dst.get(), job.name.c_str(), 0);
+    }
+
+    // 复制完成后设置权限和时间
+    void finishFile(int outFd, const FileJob& job) {
+        fchmod(outFd, job.mode & 07777);
+        futimens(outFd, job.times);
+    }
+
+    // ========== 第二级（普通线程池）：逐个复制文件 ==========
+    void syncWorker() {
+        FileJob job;
+        while (queue.pop(job)) {
+            // 已取消：只把队列取空（让遍历线程不再阻塞），不再复制
+            if (!cancelled()) {
+                copyOne(job, -1, -1);
+            }
+            job = FileJob();
+        }
+    }
+
+    // 复制一个文件；inFd/outFd 为 -1 时自己打开。负责关闭 fd
+    void copyOne(const FileJob& job, int inFd, int outFd) {
+        Stats::add(Stats::OpenCalls, (inFd < 0) + (outFd < 0));
+        UniqueFd in(inFd >= 0 ? inFd : openat(job.dir->src.get(), job.name.c_str(),
+                                               O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+        if (!in) {
+            recordError(job.path, errno);
+            if (outFd >= 0) {
+                UniqueFd out(outFd);
+                discard(job, out);
+            }
+            return;
+        }
+        UniqueFd out(outFd >= 0 ? outFd : openat(job.dir->dst.get(), job.name.c_str(),
+                                                  O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+        if (!out) {
+            recordError(job.path, errno);
+            return;
+        }
+        CopyResult result = copyFileData(in.get(), out.get());
+        if (!result.ok) {
+            recordError(job.path, result.error);
+            discard(job, out);
+            return;
+        }
+        finishFile(out.get(), job);
+        files++;
+        addBytes(result.bytes);
+    }
+
+    // ========== 第二级（io_uring）：一批文件一起打开、读写、关闭 ==========
+    void uringWorker() {
+        IoUring ring;
+        if (!ring.init(static_cast<unsigned>(kBatchSize * 2))) {
+            syncWorker();
+            return;
+        }
+        std::unique_ptr<char[]> buffers(new char[kBatchSize * kSmallFileSize]);
+        std::vector<FileJob> batch;
+        batch.reserve(kBatchSize);
+
+        FileJob job;
+        while (queue.pop(job)) {
+            batch.push_back(std::move(job));
+            while (batch.size() < kBatchSize && queue.tryPop(job)) {
+                batch.push_back(std::move(job));
+            }
+            if (cancelled()) {
+                batch.clear();
+                continue;
+            }
+            if (!processBatch(ring, batch, buffers.get())) {
+                // ring 出错：这一批已经由 processBatch 改用普通方式复制，之后的文件也一样
+                batch.clear();
+                syncWorker();
+                return;
+            }
+            batch.clear();
+        }
+    }
+
+    bool processBatch(IoUring& ring, std::vector<FileJob>& batch, char* buffers) {
+        size_t n = batch.size();
+        std::vector<int> inFds(n, -1);
+        std::vector<int> outFds(n, -1);
+        std::vector<bool> done(n, false);
+
+        // 1. 一次提交所有 openat
+        for (size_t i = 0; i < n; i++) {
+            ring.prepOpenat(batch[i].dir->src.get(), batch[i].name.c_str(),
+                            O_RDONLY | O_NOFOLLOW | O_CLOEXEC, 0, i * 2);
+            ring.prepOpenat(batch[i].dir->dst.get(), batch[i].name.c_str(),
+                            O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600, i * 2 + 1);
+        }
+        Stats::add(Stats::OpenCalls, n * 2);
+        bool submitted = ring.submitAndWait(static_cast<unsigned>(n * 2));
+        uint64_t userData;
+        int32_t res;
+        for (size_t k = 0; k < n * 2 && ring.popCompletion(userData, res); k++) {
+            size_t i = static_cast<size_t>(userData / 2);
+            if (res < 0) {
+                if (!done[i]) {
+                    recordError(batch[i].path, -res);
+                    done[i] = true;
+                }
+            } else if (userData % 2 == 0) {
+                inFds[i] = res;
+            } else {
+                outFds[i] = res;
+            }
+        }
+        if (!submitted) {
+            fallBack(batch, done, inFds, outFds);
+            return false;
+        }
+
+        // 源文件打不开但目标已经创建：删除空的目标文件（目标打开失败时 outFds[i] 为 -1，不会误删已有文件）
+        for (size_t i = 0; i < n; i++) {
+            if (done[i] && outFds[i] >= 0) {
+                UniqueFd out(outFds[i]);
+                outFds[i] = -1;
+                discard(batch[i], out);
+            }
+        }
+
+        // 2. 小文件：读和写链接在一起，一次提交
+        unsigned pairs = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (done[i] || batch[i].size == 0 || batch[i].size > kSmallFileSize) {
+                continue;
+            }
+            char* buffer = buffers + i * kSmallFileSize;
+            unsigned size = static_cast<unsigned>(batch[i].size);
+            ring.prepRead(inFds[i], buffer, size, 0, i * 2, true);
+            ring.prepWrite(outFds[i], buffer, size, 0, i * 2 + 1);
+            pairs++;
+        }
+        std::vector<bool> written(n, false);
+        if (pairs > 0) {
+            if (!ring.submitAndWait(pairs * 2)) {
+                while (ring.popCompletion(userData, res)) {
+                }
+                fallBack(batch, done, inFds, outFds);
+                return false;
+            }
+            for (unsigned k = 0; k < pairs * 2 && ring.popCompletion(userData, res); k++) {
+                size_t i = static_cast<size_t>(userData / 2);
+                if (userData % 2 == 1 && res == static_cast<int32_t>(batch[i].size)) {
+                    written[i] = true;
+                }
+            }
+        }
+
+        // 3. 其余文件（大文件、空文件、读写不完整的小文件）用 CopyEngine 复制，然后设置元数据
+        for (size_t i = 0; i < n; i++) {
+            if (done[i]) {
+                continue;
+            }
+            if (written[i]) {
+                files++;
+                addBytes(batch[i].size);
+                Stats::add(Stats::Bytes, batch[i].size);
+            } else if (batch[i].size > 0) {
+                // 小文件读写可能只完成了一部分（文件在复制期间被修改），从头再来
+                CopyResult result;
+                if (ftruncate(outFds[i], 0) != 0) {
+                    result.error = errno;
+                } else {
+                    result = copyFileData(inFds[i], outFds[i]);
+                }
+                if (!result.ok) {
+                    recordError(batch[i].path, result.error);
+                    UniqueFd out(outFds[i]);
+                    outFds[i] = -1;
+                    discard(batch[i], out);
+                    continue;
+                }
+                files++;
+                addBytes(result.bytes);
+            } else {
+                files++;
+            }
+            finishFile(outFds[i], batch[i]);
+        }
+
+        // 4. 一次提交所有 close
+        closeAll(ring, inFds, outFds);
+        return true;
+    }
+
+    // ring 出错后，这一批还没完成的文件连同已经打开的 fd 交给 copyOne，其余 fd 关闭。
+    // 目标文件已经用 O_EXCL 创建，copyOne 自己再打开会得到 EEXIST；小文件可能已经写了一部分，先清空
+    void fallBack(std::vector<FileJob>& batch, const std::vector<bool>& done, std::vector<int>& inFds,
+                  std::vector<int>& outFds) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (done[i]) {
+                // 已经记录了错误：只关闭打开了的一端，源文件打不开时删除刚创建的目标
+                UniqueFd in(inFds[i]);
+                UniqueFd out(outFds[i]);
+                if (out) {
+                    discard(batch[i], out);
+                }
+            } else if (outFds[i] >= 0 && ftruncate(outFds[i], 0) != 0) {
+                recordError(batch[i].path, errno);
+                UniqueFd in(inFds[i]);
+                UniqueFd out(outFds[i]);
+                discard(batch[i], out);
+            } else {
+                copyOne(batch[i], inFds[i], outFds[i]);
+            }
+            inFds[i] = -1;
+            outFds[i] = -1;
+        }
+    }
+
+    void closeAll(IoUring& ring, std::vector<int>& inFds, std::vector<int>& outFds) {
+        unsigned count = 0;
+        for (std::vector<int>* fds : {&inFds, &outFds}) {
+            for (int& fd : *fds) {
+                if (fd >= 0) {
+                    if (!ring.prepClose(fd, 0)) {
+                        close(fd);
+                    } else {
+                        count++;
+                    }
+                    fd = -1;
+                }
+            }
+        }
+        if (count > 0) {
+            ring.submitAndWait(count);
+            uint64_t userData;
+            int32_t res;
+            while (ring.popCompletion(userData, res)) {
+            }
+        }
+    }
+};
+
+} // namespace
+
+TreeCopyStats copyTree(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst,
+                       const TreeCopyOptions& options) {
+    TreeCopyStats stats;
+    TreeCopyRun run(options, stats);
+    run.run(srcBaseFd, src, dstBaseFd, dst);
+    return stats;
+}
@@ -0,0 +1,89 @@
+#include "../include/TreeRemover.h"
+#include "../include/TreeWalker.h"
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 每个线程的计数，按缓存行对齐，避免伪共享
+struct alignas(64) RemoveCounters {
+    uint64_t files = 0;
+    uint64_t dirs = 0;
+    uint64_t errors = 0;
+};
+
+} // namespace
+
+TreeRemoveStats removeTree(int baseFd, const std::string& root, const TreeRemoveOptions& options) {
+    TreeRemoveStats stats;
+
+    // TreeWalker 允许根目录是符号链接，这里要求根本身就是目录
+    struct stat rootStat;
+    if (fstatat(baseFd, root.c_str(), &rootStat, AT_SYMLINK_NOFOLLOW) != 0) {
+        stats.firstError = root + ": " + std::strerror(errno);
+        stats.errors = 1;
+        return stats;
+    }
+    if (!S_ISDIR(rootStat.st_mode)) {
+        stats.firstError = root + ": " + std::strerror(ENOTDIR);
+        stats.errors = 1;
+        return stats;
+    }
+
+    WalkOptions walkOptions;
+    walkOptions.threads = options.threads;
+    walkOptions.statEntries = false;
+    walkOptions.countHardLinksOnce = false;
+    walkOptions.control = options.control;
+    TreeWalker walker(walkOptions);
+    stats.threads = walker.threadCount();
+
+    std::vector<RemoveCounters> counters(walker.threadCount());
+    std::mutex errorMutex;
+    auto recordError = [&](const WalkEntry &entry, int error) {
+        counters[entry.worker].errors++;
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (stats.firstError.empty()) {
+            std::string path = entry.depth == 0 ? root : entry.relativePath();
+            stats.firstError = path + ": " + std::strerror(error);
+        }
+    };
+
+    // 非目录条目：读取目录时直接删除；目录：等到它的全部内容删除完后再删除
+    WalkStats walkStats = walker.walk(baseFd, root, [&](WalkEntry &entry) {
+        if (entry.isDir) {
+            return true;
+        }
+        if (unlinkat(entry.dirFd, entry.name.data(), 0) == 0) {
+            counters[entry.worker].files++;
+        } else {
+            recordError(entry, errno);
+        }
+        return true;
+    }, [&](WalkEntry &entry) {
+        if (unlinkat(entry.dirFd, entry.name.data(), AT_REMOVEDIR) == 0) {
+            counters[entry.worker].dirs++;
+        } else {
+            recordError(entry, errno);
+        }
+    });
+
+    for (const auto &count : counters) {
+        stats.files += count.files;
+        stats.dirs += count.dirs;
+        stats.errors += count.errors;
+    }
+    // 无法打开/读取的目录（其中的内容没有被删除）
+    stats.errors += walkStats.errors;
+    if (!walkStats.rootOk && stats.firstError.empty()) {
+        stats.firstError = root + ": " + std::strerror(walkStats.rootErrno);
+    }
+    stats.cancelled = walkStats.cancelled;
+    stats.ok = walkStats.rootOk && stats.errors == 0 && !stats.cancelled;
+    return stats;
+}
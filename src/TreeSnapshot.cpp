@@ -0,0 +1,438 @@
+#include "../include/TreeSnapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char kMagic[8] = {'M', 'F', 'E', 'S', 'N', 'P', '1', '\0'};
+const uint32_t kVersion = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t savedAt;
+    uint64_t entryCount;
+    uint64_t rootOffset;
+    uint64_t rootLength;
+    uint64_t recordsOffset;
+    uint64_t recordsBytes;
+};
+
+// ========== varint（LEB128）编码 ==========
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// 有符号数先 zigzag 编码，使绝对值小的负数也只占一两个字节
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+const SnapshotHeader* headerOf(const MappedFile& file) {
+    return reinterpret_cast<const SnapshotHeader*>(file.data());
+}
+
+/**
+ * 顺序解码记录区（快照文件可能被截断或损坏，每一步都检查边界）
+ */
+class RecordReader {
+public:
+    explicit RecordReader(const MappedFile& file) {
+        const SnapshotHeader* header = headerOf(file);
+        p = reinterpret_cast<const unsigned char*>(file.data() + header->recordsOffset);
+        end = p + header->recordsBytes;
+        remaining = header->entryCount;
+    }
+
+    /**
+     * 解码下一条记录到 entry
+     * @return 没有更多记录或记录损坏（failed() 为 true）时返回 false
+     */
+    bool next() {
+        if (remaining == 0) {
+            return false;
+        }
+        uint64_t shared, suffix, mode, mtimeSec, mtimeNsec;
+        if (!varint(shared) || !varint(suffix) || shared > path.size() ||
+            suffix > static_cast<uint64_t>(end - p)) {
+            return fail();
+        }
+        path.resize(shared);
+        path.append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+        if (!varint(mode) || !varint(entry.size) || !varint(mtimeSec) ||
+            !varint(mtimeNsec) || !varint(entry.dev) || !varint(entry.ino)) {
+            return fail();
+        }
+        entry.path = path;
+        entry.mode = static_cast<uint32_t>(mode);
+        entry.mtimeSec = unzigzag(mtimeSec);
+        entry.mtimeNsec = static_cast<int64_t>(mtimeNsec);
+        remaining--;
+        return true;
+    }
+
+    bool failed() const { return corrupt; }
+
+    TreeSnapshot::Entry entry;
+
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+    uint64_t remaining;
+    std::string path;
+    bool corrupt = false;
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            unsigned char byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool fail() {
+        corrupt = true;
+        remaining = 0;
+        return false;
+    }
+};
+
+// 只在一边出现的条目（暂存到最后按 inode 配对）
+struct Unmatched {
+    std::string path;
+    uint32_t mode;
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t dev;
+    uint64_t ino;
+    bool renamed = false;
+
+    explicit Unmatched(const TreeSnapshot::Entry& e)
+        : path(e.path), mode(e.mode), size(e.size), mtimeSec(e.mtimeSec), mtimeNsec(e.mtimeNsec),
+          dev(e.dev), ino(e.ino) {}
+
+    TreeSnapshot::Entry entry() const {
+        TreeSnapshot::Entry e;
+        e.path = path;
+        e.mode = mode;
+        e.size = size;
+        e.mtimeSec = mtimeSec;
+        e.mtimeNsec = mtimeNsec;
+        e.dev = dev;
+        e.ino = ino;
+        return e;
+    }
+
+    // 配对改名的键：同一 inode、同一类型；非目录还要求大小和 mtime 不变
+    // （inode 被删除后立即被新文件重用时，内容几乎总会不同，按删除 + 添加报告）
+    auto inodeKey() const {
+        bool dir = S_ISDIR(mode);
+        return std::make_tuple(dev, ino, mode & S_IFMT, dir ? 0 : size, dir ? 0 : mtimeSec, dir ? 0 : mtimeNsec);
+    }
+};
+
+bool modified(const TreeSnapshot::Entry& a, const TreeSnapshot::Entry& b) {
+    if (a.mode != b.mode) {
+        return true;
+    }
+    // 目录的 mtime 随其中条目的增删变化，这些变化已经逐个报告
+    if (S_ISDIR(a.mode)) {
+        return false;
+    }
+    return a.size != b.size || a.mtimeSec != b.mtimeSec || a.mtimeNsec != b.mtimeNsec ||
+           a.dev != b.dev || a.ino != b.ino;
+}
+
+std::string_view dirName(std::string_view path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? std::string_view() : path.substr(0, slash);
+}
+
+std::string_view baseName(std::string_view path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+std::string pairKey(std::string_view from, std::string_view to) {
+    std::string key(from);
+    key.push_back('\0');
+    key.append(to);
+    return key;
+}
+
+} // namespace
+
+// ========== 保存 ==========
+
+TreeSnapshot::SaveResult TreeSnapshot::save(int baseFd, const std::string& dir, const std::string& root,
+                                            const std::string& file, const WalkOptions& options) {
+    SaveResult result;
+
+    // 每个线程把路径追加到自己的字符串区，记录偏移量，最后统一排序
+    struct Item {
+        uint64_t pathOffset;
+        uint32_t pathLength;
+        uint32_t mode;
+        uint64_t size;
+        int64_t mtimeSec;
+        int64_t mtimeNsec;
+        uint64_t dev;
+        uint64_t ino;
+    };
+    struct alignas(64) Collected {
+        std::string paths;
+        std::vector<Item> items;
+    };
+
+    WalkOptions walkOptions = options;
+    walkOptions.statEntries = true;
+    walkOptions.countHardLinksOnce = false;  // 硬链接的每个路径都要记录
+    TreeWalker walker(walkOptions);
+    std::vector<Collected> collected(walker.threadCount());
+
+    WalkStats stats = walker.walk(baseFd, dir, [&](WalkEntry& entry) {
+        const struct stat* st = entry.stat();
+        Collected& mine = collected[entry.worker];
+        Item item;
+        item.pathOffset = mine.paths.size();
+        entry.appendRelativePath(mine.paths);
+        item.pathLength = static_cast<uint32_t>(mine.paths.size() - item.pathOffset);
+        item.mode = static_cast<uint32_t>(st->st_mode);
+        item.size = static_cast<uint64_t>(st->st_size);
+        item.mtimeSec = static_cast<int64_t>(st->st_mtim.tv_sec);
+        item.mtimeNsec = static_cast<int64_t>(st->st_mtim.tv_nsec);
+        item.dev = static_cast<uint64_t>(st->st_dev);
+        item.ino = static_cast<uint64_t>(st->st_ino);
+        mine.items.push_back(item);
+        return true;
+    });
+
+    result.threads = walker.threadCount();
+    result.errors = stats.errors;
+    if (!stats.rootOk) {
+        result.error = std::strerror(stats.rootErrno);
+        return result;
+    }
+    if (stats.cancelled) {
+        result.cancelled = true;
+        return result;
+    }
+
+    // 按完整路径的字节序排序（diff 按同样的顺序归并）
+    struct Ref {
+        uint32_t worker;
+        uint32_t index;
+    };
+    std::vector<Ref> order;
+    for (size_t w = 0; w < collected.size(); w++) {
+        for (size_t i = 0; i < collected[w].items.size(); i++) {
+            order.push_back({static_cast<uint32_t>(w), static_cast<uint32_t>(i)});
+        }
+    }
+    auto pathOf = [&](const Ref& ref) {
+        const Item& item = collected[ref.worker].items[ref.index];
+        return std::string_view(collected[ref.worker].paths.data() + item.pathOffset, item.pathLength);
+    };
+    std::sort(order.begin(), order.end(), [&](const Ref& a, const Ref& b) { return pathOf(a) < pathOf(b); });
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.savedAt = static_cast<int64_t>(std::time(nullptr));
+    header.entryCount = order.size();
+    header.rootOffset = sizeof(SnapshotHeader);
+    header.rootLength = root.size();
+
+    std::string buffer(sizeof(SnapshotHeader), '\0');
+    buffer.append(root);
+    header.recordsOffset = buffer.size();
+    std::string_view previous;
+    for (const Ref& ref : order) {
+        const Item& item = collected[ref.worker].items[ref.index];
+        std::string_view path = pathOf(ref);
+        size_t shared = 0;
+        size_t limit = std::min(previous.size(), path.size());
+        while (shared < limit && previous[shared] == path[shared]) {
+            shared++;
+        }
+        putVarint(buffer, shared);
+        putVarint(buffer, path.size() - shared);
+        buffer.append(path.data() + shared, path.size() - shared);
+        putVarint(buffer, item.mode);
+        putVarint(buffer, item.size);
+        putVarint(buffer, zigzag(item.mtimeSec));
+        putVarint(buffer, static_cast<uint64_t>(item.mtimeNsec));
+        putVarint(buffer, item.dev);
+        putVarint(buffer, item.ino);
+        previous = path;
+    }
+    header.recordsBytes = buffer.size() - header.recordsOffset;
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    if (!writeFileAtomic(file, buffer.data(), buffer.size())) {
+        result.error = std::string("cannot write snapshot: ") + std::strerror(errno);
+        return result;
+    }
+    result.ok = true;
+    result.entries = order.size();
+    result.bytes = buffer.size();
+    return result;
+}
+
+// ========== 读取 ==========
+
+bool TreeSnapshot::open(const std::string& path) {
+    if (!file.open(path)) {
+        return false;
+    }
+    const SnapshotHeader* header = headerOf(file);
+    size_t size = file.size();
+    if (size < sizeof(SnapshotHeader) || std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->version != kVersion || header->headerSize != sizeof(SnapshotHeader) ||
+        header->rootOffset > size || header->rootLength > size - header->rootOffset ||
+        header->recordsOffset > size || header->recordsBytes > size - header->recordsOffset) {
+        file.close();
+        return false;
+    }
+    // 只顺序读取一遍：让内核加大预读，读过的页面优先回收
+    madvise(const_cast<char*>(file.data()), size, MADV_SEQUENTIAL);
+    return true;
+}
+
+std::string_view TreeSnapshot::root() const {
+    const SnapshotHeader* header = headerOf(file);
+    return std::string_view(file.data() + header->rootOffset, header->rootLength);
+}
+
+uint64_t TreeSnapshot::entryCount() const {
+    return headerOf(file)->entryCount;
+}
+
+int64_t TreeSnapshot::savedAt() const {
+    return headerOf(file)->savedAt;
+}
+
+// ========== 比较 ==========
+
+TreeSnapshot::DiffResult TreeSnapshot::diff(const TreeSnapshot& before, const TreeSnapshot& after,
+                                            const ChangeCallback& onChange) {
+    DiffResult result;
+    result.oldEntries = before.entryCount();
+    result.newEntries = after.entryCount();
+
+    // 两份快照都按路径排序：同时前进，路径相同的比较元数据，其余的暂存
+    RecordReader a(before.file);
+    RecordReader b(after.file);
+    std::vector<Unmatched> removed;
+    std::vector<Unmatched> added;
+    Entry none;
+    bool hasA = a.next();
+    bool hasB = b.next();
+    while (hasA || hasB) {
+        int order = !hasA ? 1 : !hasB ? -1 : a.entry.path.compare(b.entry.path);
+        if (order < 0) {
+            removed.emplace_back(a.entry);
+            hasA = a.next();
+        } else if (order > 0) {
+            added.emplace_back(b.entry);
+            hasB = b.next();
+        } else {
+            if (modified(a.entry, b.entry)) {
+                result.modified++;
+                onChange(Change::Modified, a.entry, b.entry);
+            }
+            hasA = a.next();
+            hasB = b.next();
+        }
+    }
+    if (a.failed() || b.failed()) {
+        result.error = "corrupt snapshot";
+        return result;
+    }
+
+    // ========== 按 inode 配对：改名 ==========
+    auto byInode = [](std::vector<Unmatched>& list) {
+        std::vector<uint32_t> order(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        std::sort(order.begin(), order.end(),
+                  [&](uint32_t x, uint32_t y) { return list[x].inodeKey() < list[y].inodeKey(); });
+        return order;
+    };
+    std::vector<uint32_t> removedOrder = byInode(removed);
+    std::vector<uint32_t> addedOrder = byInode(added);
+    std::vector<std::pair<uint32_t, uint32_t>> renames;  // (removed, added)
+    for (size_t i = 0, j = 0; i < removedOrder.size() && j < addedOrder.size();) {
+        Unmatched& r = removed[removedOrder[i]];
+        Unmatched& n = added[addedOrder[j]];
+        if (r.inodeKey() < n.inodeKey()) {
+            i++;
+        } else if (n.inodeKey() < r.inodeKey()) {
+            j++;
+        } else {
+            r.renamed = n.renamed = true;
+            renames.emplace_back(removedOrder[i], addedOrder[j]);
+            i++;
+            j++;
+        }
+    }
+
+    // 父目录也改了名、且名称不变的条目是随父目录一起移动的，不单独报告
+    std::unordered_set<std::string> renamedPairs;
+    for (const auto& rename : renames) {
+        renamedPairs.insert(pairKey(removed[rename.first].path, added[rename.second].path));
+    }
+    std::sort(renames.begin(), renames.end(),
+              [&](const auto& x, const auto& y) { return added[x.second].path < added[y.second].path; });
+    for (const auto& rename : renames) {
+        std::string_view from = removed[rename.first].path;
+        std::string_view to = added[rename.second].path;
+        if (baseName(from) == baseName(to) && !dirName(from).empty() && !dirName(to).empty() &&
+            renamedPairs.count(pairKey(dirName(from), dirName(to))) > 0) {
+            continue;
+        }
+        result.renamed++;
+        onChange(Change::Renamed, removed[rename.first].entry(), added[rename.second].entry());
+    }
+
+    for (const auto& entry : added) {
+        if (!entry.renamed) {
+            result.added++;
+            onChange(Change::Added, none, entry.entry());
+        }
+    }
+    for (const auto& entry : removed) {
+        if (!entry.renamed) {
+            result.removed++;
+            onChange(Change::Removed, entry.entry(), none);
+        }
+    }
+    result.ok = true;
+    return result;
+}
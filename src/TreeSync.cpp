@@ -0,0 +1,580 @@
+#include "../include/TreeSync.h"
+#include "../include/CopyEngine.h"
+#include "../include/FileUtils.h"
+#include "../include/JobControl.h"
+#include "../include/ParallelFor.h"
+#include "../include/Stats.h"
+#include "../include/TreeWalker.h"
+#include "../include/XxHash64.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 目标文件和源文件都不小于这个大小时才做差异更新，否则直接完整复制
+const uint64_t kDeltaMinSize = 1 << 20;
+
+// 块大小的范围：目标文件大约切成 kTargetBlocks 块，块数多时签名表占用的内存也多
+const size_t kMinBlockSize = 16 * 1024;
+const size_t kMaxBlockSize = 1 << 20;
+const uint64_t kTargetBlocks = 16384;
+
+// 差异更新时读取源文件的窗口大小和写入临时文件的分块大小，不小于 kMaxBlockSize + 1
+const size_t kWindowSize = 4 << 20;
+
+const uint32_t kNone = 0xFFFFFFFFu;
+
+// 一个待同步的普通文件
+struct FileJob {
+    std::string path;          // 相对根的路径
+    mode_t mode;
+    uint64_t size;
+    struct timespec times[2];
+};
+
+// 需要在最后设置的目录元数据
+struct DirMeta {
+    std::string path;
+    int depth;
+    mode_t mode;
+    struct timespec times[2];
+};
+
+// 每个线程的计数，按缓存行对齐
+struct alignas(64) WorkerTotals {
+    std::vector<FileJob> files;
+    std::vector<DirMeta> dirs;
+    uint64_t unchanged = 0;
+    uint64_t copied = 0;
+    uint64_t patched = 0;
+    uint64_t created = 0;
+    uint64_t symlinks = 0;
+    uint64_t skipped = 0;
+    uint64_t copiedBytes = 0;
+    uint64_t literalBytes = 0;
+    uint64_t reusedBytes = 0;
+};
+
+// 差异更新的一段输出：从目标文件（旧内容）的 basisOffset 复制，或 basisOffset 为 -1 时从源文件同一位置写入
+struct DeltaOp {
+    uint64_t offset;
+    uint64_t length;
+    int64_t basisOffset;
+};
+
+// ========== 滚动校验和（rsync 的弱校验和） ==========
+//   a = Σ x[i]，b = Σ (n - i) · x[i]，各取低 16 位
+// 窗口右移一个字节只需 O(1) 更新，因此可以在源文件的每个位置计算
+
+struct RollingSum {
+    uint32_t a = 0;
+    uint32_t b = 0;
+
+    void init(const unsigned char* data, size_t length) {
+        a = b = 0;
+        for (size_t i = 0; i < length; i++) {
+            a += data[i];
+            b += a;
+        }
+    }
+
+    void roll(unsigned char out, unsigned char in, size_t length) {
+        a += static_cast<uint32_t>(in) - out;
+        b += a - static_cast<uint32_t>(length) * out;
+    }
+
+    uint32_t value() const { return (a & 0xFFFF) | (b << 16); }
+};
+
+size_t chooseBlockSize(uint64_t basisSize) {
+    size_t block = kMinBlockSize;
+    while (block < kMaxBlockSize && basisSize / block > kTargetBlocks) {
+        block *= 2;
+    }
+    return block;
+}
+
+bool writeAll(int fd, const char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// 从 offset 开始读满 length 字节；文件在此期间变短时也按出错处理（errno 为 EIO）
+bool readAll(int fd, char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, data, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// 源文件的读取窗口：滑动匹配只会向后移动，按大块 pread 读入，需要的范围超出缓冲区时从该位置重新读
+class ReadWindow {
+public:
+    ReadWindow(int fd, uint64_t length) : fd(fd), length(length), buffer(kWindowSize) {}
+
+    // 返回 [offset, offset + count) 的数据，读取失败时返回 nullptr
+    const unsigned char* fetch(uint64_t offset, size_t count) {
+        if (offset < start || offset + count > start + filled) {
+            size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), length - offset));
+            if (!readAll(fd, buffer.data(), want, offset)) {
+                return nullptr;
+            }
+            start = offset;
+            filled = want;
+        }
+        return reinterpret_cast<const unsigned char*>(buffer.data()) + (offset - start);
+    }
+
+private:
+    int fd;
+    uint64_t length;
+    std::vector<char> buffer;
+    uint64_t start = 0;
+    size_t filled = 0;
+};
+
+class TreeSyncRun {
+public:
+    TreeSyncRun(const TreeSyncOptions& options, TreeSyncStats& stats) : options(options), stats(stats) {}
+
+    void run(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst) {
+        // ========== 打开源目录，准备目标根目录 ==========
+        Stats::add(Stats::OpenCalls);
+        srcRoot.reset(openat(srcBaseFd, src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        struct stat rootStat;
+        if (!srcRoot || fstat(srcRoot.get(), &rootStat) != 0) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        bool createdRoot = mkdirat(dstBaseFd, dst.c_str(), 0700) == 0;
+        if (!createdRoot && errno != EEXIST) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        Stats::add(Stats::OpenCalls);
+        dstRoot.reset(openat(dstBaseFd, dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (!dstRoot) {
+            stats.error = std::strerror(errno);
+            return;
+        }
+        stats.ok = true;
+
+        // ========== 第 1 步：并行遍历源目录 ==========
+        WalkOptions walkOptions;
+        walkOptions.threads = options.threads;
+        walkOptions.statEntries = true;
+        walkOptions.countHardLinksOnce = false;
+        walkOptions.control = options.control;
+        TreeWalker walker(walkOptions);
+        std::vector<WorkerTotals> walkTotals(walker.threadCount());
+        WalkStats walkStats = walker.walk(srcRoot.get(), ".", [&](WalkEntry& entry) {
+            return visit(entry, walkTotals[entry.worker]);
+        });
+        errors += walkStats.errors;
+
+        std::vector<FileJob> files;
+        std::vector<DirMeta> dirs;
+        for (auto& mine : walkTotals) {
+            std::move(mine.files.begin(), mine.files.end(), std::back_inserter(files));
+            std::move(mine.dirs.begin(), mine.dirs.end(), std::back_inserter(dirs));
+        }
+        stats.files = files.size();
+
+        // ========== 第 2 步：并行处理文件 ==========
+        std::vector<WorkerTotals> fileTotals(parallelThreadCount(files.size(), options.threads));
+        if (!cancelled()) {
+            stats.threads = parallelFor(files.size(), options.threads, [&](unsigned worker, size_t i) {
+                if (!cancelled()) {
+                    syncFile(files[i], fileTotals[worker]);
+                }
+            });
+        }
+        stats.threads = std::max(stats.threads, walker.threadCount());
+
+        // ========== 第 3 步：目录的权限和时间（从最深的目录开始） ==========
+        std::sort(dirs.begin(), dirs.end(), [](const DirMeta& a, const DirMeta& b) { return a.depth > b.depth; });
+        for (const auto& dir : dirs) {
+            fchmodat(dstRoot.get(), dir.path.c_str(), dir.mode & 07777, 0);
+            utimensat(dstRoot.get(), dir.path.c_str(), dir.times, 0);
+        }
+        struct timespec rootTimes[2] = {rootStat.st_atim, rootStat.st_mtim};
+        fchmod(dstRoot.get(), rootStat.st_mode & 07777);
+        futimens(dstRoot.get(), rootTimes);
+
+        for (const auto* list : {&walkTotals, &fileTotals}) {
+            for (const auto& t : *list) {
+                stats.unchanged += t.unchanged;
+                stats.copied += t.copied;
+                stats.patched += t.patched;
+                stats.dirs += t.created;
+                stats.symlinks += t.symlinks;
+                stats.skipped += t.skipped;
+                stats.copiedBytes += t.copiedBytes;
+                stats.literalBytes += t.literalBytes;
+                stats.reusedBytes += t.reusedBytes;
+            }
+        }
+        stats.dirs += createdRoot ? 1 : 0;
+        stats.errors = errors.load();
+        stats.cancelled = cancelled() || walkStats.cancelled;
+    }
+
+private:
+    const TreeSyncOptions& options;
+    TreeSyncStats& stats;
+    UniqueFd srcRoot;
+    UniqueFd dstRoot;
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> tempSequence{0};
+    std::mutex errorMutex;
+
+    bool cancelled() const {
+        return options.control != nullptr && options.control->isCancelled();
+    }
+
+    void recordError(const std::string& path, int error) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (stats.firstError.empty()) {
+            stats.firstError = path + ": " + std::strerror(error);
+        }
+    }
+
+    // 与 path 同一目录的临时文件名
+    std::string tempPathFor(const std::string& path) {
+        size_t slash = path.rfind('/');
+        std::string temp = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        temp += ".sync-" + std::to_string(getpid()) + "-" +
+                std::to_string(tempSequence.fetch_add(1, std::memory_order_relaxed));
+        return temp;
+    }
+
+    // 遍历回调：目录和符号链接直接处理，普通文件留到第 2 步
+    bool visit(WalkEntry& entry, WorkerTotals& mine) {
+        const struct stat* st = entry.stat();
+        std::string path = entry.relativePath();
+
+        if (S_ISDIR(st->st_mode)) {
+            if (mkdirat(dstRoot.get(), path.c_str(), 0700) == 0) {
+                mine.created++;
+            } else {
+                struct stat existing;
+                int error = errno;
+                Stats::add(Stats::StatCalls);
+                if (error != EEXIST || fstatat(dstRoot.get(), path.c_str(), &existing, AT_SYMLINK_NOFOLLOW) != 0 ||
+                    !S_ISDIR(existing.st_mode)) {
+                    // 目标中同名的不是目录：不替换（可能是用户的数据），整个子树跳过
+                    recordError(path, error == EEXIST ? ENOTDIR : error);
+                    return false;
+                }
+            }
+            mine.dirs.push_back({path, entry.depth, st->st_mode, {st->st_atim, st->st_mtim}});
+            return true;
+        }
+
+        if (S_ISLNK(st->st_mode)) {
+            syncSymlink(entry, path, mine);
+        } else if (S_ISREG(st->st_mode)) {
+            mine.files.push_back({std::move(path), st->st_mode, static_cast<uint64_t>(st->st_size),
+                                  {st->st_atim, st->st_mtim}});
+        } else {
+            mine.skipped++;
+        }
+        return true;
+    }
+
+    void syncSymlink(const WalkEntry& entry, const std::string& path, WorkerTotals& mine) {
+        char target[PATH_MAX];
+        char existing[PATH_MAX];
+        ssize_t length = readlinkat(entry.dirFd, std::string(entry.name).c_str(), target, sizeof(target));
+        if (length < 0) {
+            recordError(path, errno);
+            return;
+        }
+        ssize_t existingLength = readlinkat(dstRoot.get(), path.c_str(), existing, sizeof(existing));
+        if (existingLength == length && std::memcmp(target, existing, static_cast<size_t>(length)) == 0) {
+            return;
+        }
+        std::string linkTarget(target, static_cast<size_t>(length));
+        std::string temp = tempPathFor(path);
+        if (symlinkat(linkTarget.c_str(), dstRoot.get(), temp.c_str()) != 0) {
+            recordError(path, errno);
+            return;
+        }
+        if (renameat(dstRoot.get(), temp.c_str(), dstRoot.get(), path.c_str()) != 0) {
+            recordError(path, errno);
+            unlinkat(dstRoot.get(), temp.c_str(), 0);
+            return;
+        }
+        mine.symlinks++;
+    }
+
+    // ========== 单个文件 ==========
+    void syncFile(const FileJob& file, WorkerTotals& mine) {
+        struct stat existing;
+        Stats::add(Stats::StatCalls);
+        bool exists = fstatat(dstRoot.get(), file.path.c_str(), &existing, AT_SYMLINK_NOFOLLOW) == 0;
+        if (exists && S_ISDIR(existing.st_mode)) {
+            recordError(file.path, EISDIR);
+            return;
+        }
+        bool regular = exists && S_ISREG(existing.st_mode);
+        if (regular && static_cast<uint64_t>(existing.st_size) == file.size &&
+            existing.st_mtim.tv_sec == file.times[1].tv_sec && existing.st_mtim.tv_nsec == file.times[1].tv_nsec) {
+            if ((existing.st_mode & 07777) != (file.mode & 07777)) {
+                fchmodat(dstRoot.get(), file.path.c_str(), file.mode & 07777, 0);
+            }
+            mine.unchanged++;
+            return;
+        }
+
+        Stats::add(Stats::OpenCalls);
+        UniqueFd srcFd(openat(srcRoot.get(), file.path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+        if (!srcFd) {
+            recordError(file.path, errno);
+            return;
+        }
+        UniqueFd basisFd;
+        if (regular && static_cast<uint64_t>(existing.st_size) >= kDeltaMinSize && file.size >= kDeltaMinSize) {
+            Stats::add(Stats::OpenCalls);
+            basisFd.reset(openat(dstRoot.get(), file.path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+        }
+
+        std::string temp = tempPathFor(file.path);
+        Stats::add(Stats::OpenCalls);
+        UniqueFd tempFd(openat(dstRoot.get(), temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+        if (!tempFd) {
+            recordError(file.path, errno);
+            return;
+        }
+
+        // 差异更新只在临时文件能 reflink 目标文件时才划算：位置没有变化的块与旧文件共享，不需要写；
+        // 否则每一块都要写一遍，不如直接完整复制，省去读取目标文件和计算签名
+        if (basisFd && reflinkFile(basisFd.get(), tempFd.get()) != 0) {
+            basisFd.reset();
+        }
+
+        int error = 0;
+        if (basisFd) {
+            error = patch(srcFd.get(), basisFd.get(), tempFd.get(), mine);
+            if (error == 0) {
+                mine.patched++;
+            }
+        } else {
+            CopyResult result = copyFileData(srcFd.get(), tempFd.get());
+            error = result.ok ? 0 : result.error;
+            if (result.ok) {
+                mine.copied++;
+                mine.copiedBytes += result.bytes;
+                if (options.control != nullptr) {
+                    options.control->addBytes(result.bytes);
+                }
+            }
+        }
+        if (error == 0 && (fchmod(tempFd.get(), file.mode & 07777) != 0 || futimens(tempFd.get(), file.times) != 0)) {
+            error = errno;
+        }
+        tempFd.reset();
+        if (error == 0 && renameat(dstRoot.get(), temp.c_str(), dstRoot.get(), file.path.c_str()) != 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            unlinkat(dstRoot.get(), temp.c_str(), 0);
+            recordError(file.path, error);
+        }
+    }
+
+    // ========== 差异更新 ==========
+    // 返回 0 或 errno；tempFd 已经 reflink 了 basisFd，只写入内容或位置有变化的部分
+    int patch(int srcFd, int basisFd, int tempFd, WorkerTotals& mine) {
+        // 两个文件都可能在同步期间被其他程序截断，用 pread 读取而不映射（访问映射中被截掉的部分会收到 SIGBUS）
+        struct stat srcStat;
+        struct stat basisStat;
+        if (fstat(srcFd, &srcStat) != 0 || fstat(basisFd, &basisStat) != 0) {
+            return errno;
+        }
+        uint64_t length = static_cast<uint64_t>(srcStat.st_size);
+        uint64_t basisSize = static_cast<uint64_t>(basisStat.st_size);
+        posix_fadvise(srcFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        // 目标文件（旧内容）每个完整块的签名；结尾不足一块的部分不参与匹配
+        size_t blockSize = chooseBlockSize(basisSize);
+        uint32_t blocks = static_cast<uint32_t>(basisSize / blockSize);
+        std::vector<uint32_t> weak(blocks);
+        std::vector<uint64_t> strong(blocks);
+        size_t tableSize = 1;
+        while (tableSize < 2 * static_cast<size_t>(blocks)) {
+            tableSize *= 2;
+        }
+        std::vector<uint32_t> head(tableSize, kNone);
+        std::vector<uint32_t> next(blocks, kNone);
+        auto bucket = [tableSize](uint32_t value) {
+            return static_cast<size_t>((value * 0x9E3779B1u) >> 7) & (tableSize - 1);
+        };
+        std::vector<char> chunk(kWindowSize);
+        const unsigned char* block = reinterpret_cast<const unsigned char*>(chunk.data());
+        RollingSum sum;
+        for (uint32_t k = 0; k < blocks; k++) {
+            if (!readAll(basisFd, chunk.data(), blockSize, static_cast<uint64_t>(k) * blockSize)) {
+                return errno;
+            }
+            sum.init(block, blockSize);
+            weak[k] = sum.value();
+            strong[k] = XxHash64::hash(block, blockSize);
+            size_t slot = bucket(weak[k]);
+            next[k] = head[slot];
+            head[slot] = k;
+        }
+
+        // 在源文件上滑动窗口：优先尝试紧接上一个匹配的块（原位修改时几乎总是命中），
+        // 再查签名表；弱校验和相同时才计算 XXH64
+        ReadWindow window(srcFd, length);
+        std::vector<DeltaOp> ops;
+        auto emit = [&ops](uint64_t offset, uint64_t count, int64_t basisOffset) {
+            if (count == 0) {
+                return;
+            }
+            if (!ops.empty()) {
+                DeltaOp& last = ops.back();
+                bool contiguous = last.offset + last.length == offset &&
+                    (basisOffset < 0 ? last.basisOffset < 0
+                                     : last.basisOffset >= 0 &&
+                                           last.basisOffset + static_cast<int64_t>(last.length) == basisOffset);
+                if (contiguous) {
+                    last.length += count;
+                    return;
+                }
+            }
+            ops.push_back({offset, count, basisOffset});
+        };
+
+        uint64_t pos = 0;
+        uint64_t literalStart = 0;
+        uint32_t expected = 0;
+        bool fresh = true;
+        uint32_t steps = 0;
+        while (blocks > 0 && pos + blockSize <= length) {
+            if ((++steps & 0xFFFF) == 0 && cancelled()) {
+                return ECANCELED;
+            }
+            // 当前窗口，以及没有匹配时滚动移入的下一个字节
+            size_t need = pos + blockSize < length ? blockSize + 1 : blockSize;
+            const unsigned char* data = window.fetch(pos, need);
+            if (data == nullptr) {
+                return errno;
+            }
+            if (fresh) {
+                sum.init(data, blockSize);
+                fresh = false;
+            }
+            uint32_t value = sum.value();
+            uint32_t match = kNone;
+            bool hashed = false;
+            uint64_t hash = 0;
+            auto strongEquals = [&](uint32_t k) {
+                if (!hashed) {
+                    hash = XxHash64::hash(data, blockSize);
+                    hashed = true;
+                }
+                return strong[k] == hash;
+            };
+            if (expected < blocks && weak[expected] == value && strongEquals(expected)) {
+                match = expected;
+            } else {
+                for (uint32_t k = head[bucket(value)]; k != kNone; k = next[k]) {
+                    if (weak[k] == value && strongEquals(k)) {
+                        match = k;
+                        break;
+                    }
+                }
+            }
+
+            if (match != kNone) {
+                emit(literalStart, pos - literalStart, -1);
+                emit(pos, blockSize, static_cast<int64_t>(match) * static_cast<int64_t>(blockSize));
+                pos += blockSize;
+                literalStart = pos;
+                expected = match + 1;
+                fresh = true;
+            } else {
+                if (pos + blockSize < length) {
+                    sum.roll(data[0], data[blockSize], blockSize);
+                }
+                pos++;
+            }
+        }
+        emit(literalStart, length - literalStart, -1);
+
+        uint64_t written = 0;
+        uint64_t shared = 0;
+        for (const DeltaOp& op : ops) {
+            if (op.basisOffset >= 0 && static_cast<uint64_t>(op.basisOffset) == op.offset) {
+                shared += op.length;
+                continue;
+            }
+            written += op.length;
+            int fromFd = op.basisOffset >= 0 ? basisFd : srcFd;
+            uint64_t from = op.basisOffset >= 0 ? static_cast<uint64_t>(op.basisOffset) : op.offset;
+            for (uint64_t done = 0; done < op.length;) {
+                size_t count = static_cast<size_t>(std::min<uint64_t>(chunk.size(), op.length - done));
+                if (!readAll(fromFd, chunk.data(), count, from + done) ||
+                    !writeAll(tempFd, chunk.data(), count, op.offset + done)) {
+                    return errno != 0 ? errno : EIO;
+                }
+                done += count;
+            }
+        }
+        if (ftruncate(tempFd, static_cast<off_t>(length)) != 0) {
+            return errno;
+        }
+        mine.literalBytes += written;
+        mine.reusedBytes += shared;
+        if (options.control != nullptr) {
+            options.control->addBytes(length);
+        }
+        return 0;
+    }
+};
+
+} // namespace
+
+TreeSyncStats syncTree(int srcBaseFd, const std::string& src, int dstBaseFd, const std::string& dst,
+                       const TreeSyncOptions& options) {
+    TreeSyncStats stats;
+    TreeSyncRun run(options, stats);
+    run.run(srcBaseFd, src, dstBaseFd, dst);
+    return stats;
+}
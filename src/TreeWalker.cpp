@@ -0,0 +1,402 @@
+#include "../include/TreeWalker.h"
+#include "../include/FileUtils.h"
+#include "../include/JobControl.h"
+#include "../include/Stats.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const struct stat *WalkEntry::stat() {
+    if (statState == 0) {
+        Stats::add(Stats::StatCalls);
+        // name 后面紧跟 '\0'，可以直接作为 C 字符串使用
+        statState = fstatat(dirFd, name.data(), statBuffer, AT_SYMLINK_NOFOLLOW) == 0 ? 1 : -1;
+        if (statState > 0) {
+            type = static_cast<unsigned char>(IFTODT(statBuffer->st_mode));
+        }
+    }
+    return statState > 0 ? statBuffer : nullptr;
+}
+
+std::string WalkEntry::relativePath() const {
+    std::string path;
+    path.reserve(parentPath.size() + 1 + name.size());
+    appendRelativePath(path);
+    return path;
+}
+
+void WalkEntry::appendRelativePath(std::string& out) const {
+    if (!parentPath.empty()) {
+        out.append(parentPath);
+        out.push_back('/');
+    }
+    out.append(name);
+}
+
+namespace {
+
+// 打开的目录：子目录任务持有它的 shared_ptr，
+// 这样在所有子目录都 openat 完成之前父目录的 fd 不会被关闭
+struct DirHandle {
+    UniqueFd fd;
+
+    explicit DirHandle(int fd) : fd(fd) {}
+};
+
+// 后序回调所需的目录状态：remaining 为本目录自身（1）加上尚未完成的子目录数，
+// 降为 0 时本目录完成，调用 leave 后再让父目录的计数减一
+struct DirNode {
+    std::shared_ptr<DirNode> parent;
+    std::shared_ptr<DirHandle> parentHandle;  // 完成之前父目录 fd 保持打开
+    int parentFd;
+    std::string name;
+    std::string parentPath;
+    int depth;
+    uint64_t tag;
+    std::atomic<size_t> remaining{1};
+
+    DirNode(std::shared_ptr<DirNode> parent, std::shared_ptr<DirHandle> parentHandle, int parentFd,
+            std::string name, std::string parentPath, int depth, uint64_t tag)
+        : parent(std::move(parent)), parentHandle(std::move(parentHandle)), parentFd(parentFd),
+          name(std::move(name)), parentPath(std::move(parentPath)), depth(depth), tag(tag) {}
+};
+
+// 一个待遍历的目录
+struct DirTask {
+    std::shared_ptr<DirHandle> parent;  // 父目录（根任务为空）
+    int parentFd;                       // 父目录 fd（根任务为 baseFd）
+    std::string name;                   // 相对父目录的名字（根任务为 root 路径）
+    std::string path;                   // 相对遍历根的路径
+    int depth;                          // 本目录的深度，根为 0
+    uint64_t tag;                       // 传给子项的标记
+    std::shared_ptr<DirNode> node;      // 后序回调的状态（没有 leave 时为空）
+};
+
+// 每个线程一个任务队列；按缓存行对齐，避免伪共享
+struct alignas(64) WorkerQueue {
+    std::mutex mutex;
+    std::deque<DirTask> tasks;
+};
+
+// 每个线程的统计和目录读取缓冲区，同样按缓存行对齐
+struct alignas(64) WorkerCounters {
+    uint64_t files = 0;
+    uint64_t dirs = 0;
+    uint64_t errors = 0;
+    std::vector<char> buffer;
+};
+
+// 文件唯一标识 (设备号, inode)，用于硬链接去重
+struct FileId {
+    dev_t dev;
+    ino_t ino;
+    bool operator==(const FileId& other) const { return dev == other.dev && ino == other.ino; }
+};
+
+struct FileIdHash {
+    size_t operator()(const FileId& id) const {
+        uint64_t h = static_cast<uint64_t>(id.ino) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (static_cast<uint64_t>(id.dev) + (h >> 29)));
+    }
+};
+
+// 分片的硬链接集合，减少锁竞争
+struct alignas(64) LinkShard {
+    std::mutex mutex;
+    std::unordered_set<FileId, FileIdHash> seen;
+};
+
+const size_t kLinkShards = 64;
+
+class WalkRun {
+public:
+    WalkRun(const WalkOptions& options, unsigned threads, const TreeWalker::Visitor& visit,
+            const TreeWalker::Leaver* leave)
+        : options(options), threads(threads), visit(visit), leave(leave),
+          queues(threads), counters(threads), linkShards(kLinkShards) {}
+
+    void start(int baseFd, const std::string& root) {
+        DirTask task{nullptr, baseFd, root, std::string(), 0, 0, nullptr};
+        if (leave != nullptr) {
+            task.node = std::make_shared<DirNode>(nullptr, nullptr, baseFd, root, std::string(), 0, 0);
+        }
+        push(0, std::move(task));
+
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; i++) {
+            pool.emplace_back([this, i]() { workerLoop(i); });
+        }
+        workerLoop(0);
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+
+    WalkStats result() const {
+        WalkStats stats;
+        stats.rootOk = rootOk;
+        stats.rootErrno = rootErrno;
+        stats.cancelled = options.control != nullptr && options.control->isCancelled();
+        for (const auto& c : counters) {
+            stats.files += c.files;
+            stats.dirs += c.dirs;
+            stats.errors += c.errors;
+        }
+        return stats;
+    }
+
+private:
+    const WalkOptions& options;
+    unsigned threads;
+    const TreeWalker::Visitor& visit;
+    const TreeWalker::Leaver* leave;
+
+    std::vector<WorkerQueue> queues;
+    std::vector<WorkerCounters> counters;
+    std::vector<LinkShard> linkShards;
+
+    // 已入队但尚未处理完的目录数；降为 0 表示遍历结束
+    std::atomic<size_t> pending{0};
+    std::atomic<unsigned> idle{0};
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+
+    dev_t rootDev = 0;
+    bool rootOk = false;
+    int rootErrno = 0;
+
+    void push(unsigned worker, DirTask&& task) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            queues[worker].tasks.push_back(std::move(task));
+        }
+        if (idle.load(std::memory_order_relaxed) > 0) {
+            idleCv.notify_one();
+        }
+    }
+
+    // 先从自己队列尾部取（深度优先，限制同时打开的 fd 数），
+    // 取不到再从其他线程队列头部偷（偷到的是较浅、较大的子树）
+    bool pop(unsigned worker, DirTask& out) {
+        {
+            WorkerQueue& own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                out = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned i = 1; i < threads; i++) {
+            WorkerQueue& victim = queues[(worker + i) % threads];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                out = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned worker) {
+        DirTask task;
+        while (true) {
+            if (pop(worker, task)) {
+                processDir(worker, task);
+                if (task.node != nullptr) {
+                    complete(worker, std::move(task.node));
+                }
+                task = DirTask();
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    idleCv.notify_all();
+                    return;
+                }
+                continue;
+            }
+            if (pending.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idle.fetch_add(1, std::memory_order_relaxed);
+            idleCv.wait_for(lock, std::chrono::milliseconds(2));
+            idle.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 目录自身处理完（或某个子目录完成）：计数降为 0 的目录依次向上完成
+    void complete(unsigned worker, std::shared_ptr<DirNode> node) {
+        while (node != nullptr && node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (!cancelled()) {
+                struct stat st;
+                WalkEntry entry{node->parentFd, node->name, node->parentPath, node->depth, worker,
+                                true, DT_DIR, true, node->tag, &st, 0};
+                (*leave)(entry);
+            }
+            node = std::move(node->parent);
+        }
+    }
+
+    bool firstSighting(const struct stat& st) {
+        FileId id{st.st_dev, st.st_ino};
+        LinkShard& shard = linkShards[FileIdHash()(id) % kLinkShards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.seen.insert(id).second;
+    }
+
+    bool cancelled() const {
+        return options.control != nullptr && options.control->isCancelled();
+    }
+
+    void reportDirError(uint64_t tag, int error) {
+        if (options.dirError) {
+            options.dirError(tag, error);
+        }
+    }
+
+    void processDir(unsigned worker, DirTask& task) {
+        WorkerCounters& count = counters[worker];
+
+        // 已取消：剩下的目录出队后直接丢弃，所有线程很快就会结束
+        if (cancelled()) {
+            if (task.depth == 0) {
+                rootErrno = ECANCELED;
+            }
+            return;
+        }
+
+        // 根目录允许是符号链接，子目录不跟随符号链接
+        int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+        if (task.depth > 0) {
+            flags |= O_NOFOLLOW;
+        }
+        Stats::add(Stats::OpenCalls);
+        int fd = openat(task.parentFd, task.name.c_str(), flags);
+        if (fd < 0) {
+            if (task.depth == 0) {
+                rootErrno = errno;
+            }
+            count.errors++;
+            reportDirError(task.tag, errno);
+            return;
+        }
+        auto handle = std::make_shared<DirHandle>(fd);
+
+        // 本目录已打开，不再需要父目录
+        task.parent.reset();
+
+        if (task.depth == 0) {
+            struct stat rootStat;
+            if (fstat(fd, &rootStat) != 0) {
+                rootErrno = errno;
+                count.errors++;
+                reportDirError(task.tag, errno);
+                return;
+            }
+            rootDev = rootStat.st_dev;
+            rootOk = true;
+        }
+
+        if (count.buffer.empty()) {
+            count.buffer.resize(DirReader::kBufferSize);
+        }
+        DirReader reader(fd, count.buffer.data(), count.buffer.size());
+
+        struct stat st;
+        DirEntryView de;
+        uint64_t seen = 0;
+        while (reader.next(de)) {
+            if ((++seen & 1023) == 0 && cancelled()) {
+                break;
+            }
+            WalkEntry entry{fd, std::string_view(de.name, de.nameLength), task.path,
+                            task.depth + 1, worker, de.type == DT_DIR, de.type, true, task.tag, &st, 0};
+
+            // 需要 stat 的情况：要求预先 stat、d_type 未知、或需要判断目录是否跨文件系统
+            if (options.statEntries || de.type == DT_UNKNOWN ||
+                (options.oneFileSystem && de.type == DT_DIR)) {
+                if (entry.stat() == nullptr) {
+                    count.errors++;
+                    reportDirError(task.tag, errno);
+                    continue;
+                }
+                entry.isDir = S_ISDIR(st.st_mode);
+            }
+
+            if (entry.isDir) {
+                count.dirs++;
+            } else {
+                count.files++;
+                if (entry.statState > 0 && options.countHardLinksOnce && st.st_nlink > 1) {
+                    entry.firstLink = firstSighting(st);
+                }
+            }
+
+            bool descend = visit(entry);
+            if (!entry.isDir || !descend) {
+                continue;
+            }
+            if (options.maxDepth >= 0 && entry.depth >= options.maxDepth) {
+                continue;
+            }
+            if (options.oneFileSystem && st.st_dev != rootDev) {
+                continue;
+            }
+            DirTask child{handle, fd, std::string(entry.name), entry.relativePath(), entry.depth, entry.tag, nullptr};
+            if (task.node != nullptr) {
+                task.node->remaining.fetch_add(1, std::memory_order_relaxed);
+                child.node = std::make_shared<DirNode>(task.node, handle, fd, child.name, std::string(task.path),
+                                                       entry.depth, entry.tag);
+            }
+            push(worker, std::move(child));
+        }
+        if (reader.error() != 0) {
+            count.errors++;
+            reportDirError(task.tag, reader.error());
+            // 根目录没能读完：结果缺了一部分子树，按根目录失败报告
+            if (task.depth == 0) {
+                rootOk = false;
+                rootErrno = reader.error();
+            }
+        }
+        if (options.control != nullptr) {
+            options.control->addEntries(seen);
+        }
+    }
+};
+
+} // namespace
+
+TreeWalker::TreeWalker(const WalkOptions& options) : options(options) {
+    threads = options.threads;
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+}
+
+WalkStats TreeWalker::walk(int baseFd, const std::string& root, const Visitor& visit) const {
+    WalkRun run(options, threads, visit, nullptr);
+    run.start(baseFd, root);
+    return run.result();
+}
+
+WalkStats TreeWalker::walk(int baseFd, const std::string& root, const Visitor& visit, const Leaver& leave) const {
+    WalkRun run(options, threads, visit, &leave);
+    run.start(baseFd, root);
+    return run.result();
+}
@@ -0,0 +1,145 @@
+#include "../include/WorkingDirectory.h"
+#include "../include/Stats.h"
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+// 没有 O_PATH 的平台退回到只读打开（仍然可以作为 *at() 的起点）
+#ifdef O_PATH
+#define WORKDIR_OPEN_FLAGS (O_PATH | O_DIRECTORY | O_CLOEXEC)
+#else
+#define WORKDIR_OPEN_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#endif
+
+namespace {
+
+// 去掉末尾多余的 '/'（根目录除外），"a/b/" 与 "a/b" 使用同一个缓存项
+void trimTrailingSlash(std::string& path) {
+    while (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+}
+
+// fd 指向的目录的真实路径；/proc 不可用时返回空字符串
+std::string pathOfFd(int fd) {
+#ifdef __linux__
+    char link[32];
+    char buffer[PATH_MAX];
+    std::snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t length = readlink(link, buffer, sizeof(buffer));
+    if (length > 0 && static_cast<size_t>(length) < sizeof(buffer) && buffer[0] == '/') {
+        return std::string(buffer, static_cast<size_t>(length));
+    }
+#else
+    (void)fd;
+#endif
+    return std::string();
+}
+
+} // namespace
+
+int WorkingDirectory::open(const std::string& path) {
+    std::error_code ec;
+    std::string lexical = std::filesystem::absolute(path, ec).lexically_normal().string();
+    if (ec) {
+        return ec.value();
+    }
+    trimTrailingSlash(lexical);
+
+    Stats::add(Stats::OpenCalls);
+    UniqueFd fd(::open(path.c_str(), WORKDIR_OPEN_FLAGS));
+    if (!fd) {
+        return errno;
+    }
+    return adopt(std::move(fd), lexical);
+}
+
+int WorkingDirectory::change(std::string_view target) {
+    if (target.empty()) {
+        return ENOENT;
+    }
+    std::string name(target);
+    std::string lexical = (std::filesystem::path(current) / name).lexically_normal().string();
+    trimTrailingSlash(lexical);
+
+    // 相对路径只解析用户输入的部分；绝对路径 openat 会忽略 dirFd
+    Stats::add(Stats::OpenCalls);
+    UniqueFd fd(openat(dirFd.get(), name.c_str(), WORKDIR_OPEN_FLAGS));
+    if (!fd) {
+        return errno;
+    }
+    return adopt(std::move(fd), lexical);
+}
+
+int WorkingDirectory::adopt(UniqueFd fd, const std::string& lexical) {
+    struct stat st;
+    Stats::add(Stats::StatCalls);
+    if (fstat(fd.get(), &st) != 0) {
+        return errno;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return ENOTDIR;
+    }
+
+    // 缓存命中且仍是同一个目录：不需要再解析路径
+    auto it = cache.find(lexical);
+    if (it != cache.end() && it->second.dev == st.st_dev && it->second.ino == st.st_ino) {
+        it->second.lastUse = ++useCounter;
+        current = it->second.canonical;
+        dirFd = std::move(fd);
+        return 0;
+    }
+
+    std::string canonical = pathOfFd(fd.get());
+    if (canonical.empty()) {
+        std::error_code ec;
+        canonical = std::filesystem::canonical(lexical, ec).string();
+        if (ec) {
+            canonical = lexical;
+        }
+    }
+    remember(lexical, canonical, st.st_dev, st.st_ino);
+    // 规范化路径本身也是一个键：之后 cd 到显示出来的路径同样能命中
+    if (canonical != lexical) {
+        remember(canonical, canonical, st.st_dev, st.st_ino);
+    }
+    current = std::move(canonical);
+    dirFd = std::move(fd);
+    return 0;
+}
+
+void WorkingDirectory::remember(const std::string& lexical, const std::string& canonical, dev_t dev, ino_t ino) {
+    if (cache.size() >= kCacheCapacity && cache.find(lexical) == cache.end()) {
+        // 淘汰最久未使用的一项（容量很小，线性查找即可）
+        auto oldest = cache.begin();
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) {
+                oldest = it;
+            }
+        }
+        cache.erase(oldest);
+    }
+    CacheEntry& entry = cache[lexical];
+    entry.canonical = canonical;
+    entry.dev = dev;
+    entry.ino = ino;
+    entry.lastUse = ++useCounter;
+}
+
+WorkingDirectory WorkingDirectory::clone() const {
+    WorkingDirectory copy;
+    if (dirFd) {
+        copy.dirFd.reset(fcntl(dirFd.get(), F_DUPFD_CLOEXEC, 0));
+        copy.current = current;
+    }
+    return copy;
+}
@@ -0,0 +1,136 @@
+#include "../include/XxHash64.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// 按小端读取（与 XXH64 的定义一致；memcpy 不要求对齐）
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline uint64_t mixRound(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t value) {
+    acc ^= mixRound(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+// 处理若干个完整的 32 字节块，返回处理到的位置
+inline const unsigned char* consumeStripes(uint64_t acc[4], const unsigned char* p, const unsigned char* end) {
+    while (end - p >= 32) {
+        acc[0] = mixRound(acc[0], read64(p));
+        acc[1] = mixRound(acc[1], read64(p + 8));
+        acc[2] = mixRound(acc[2], read64(p + 16));
+        acc[3] = mixRound(acc[3], read64(p + 24));
+        p += 32;
+    }
+    return p;
+}
+
+} // namespace
+
+XxHash64::XxHash64(uint64_t seed) : seed(seed) {
+    acc[0] = seed + kPrime1 + kPrime2;
+    acc[1] = seed + kPrime2;
+    acc[2] = seed;
+    acc[3] = seed - kPrime1;
+}
+
+void XxHash64::update(const void* data, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    totalLength += length;
+
+    // 先补满上次剩下的尾部
+    if (pendingSize > 0) {
+        size_t take = std::min(length, sizeof(pending) - pendingSize);
+        std::memcpy(pending + pendingSize, p, take);
+        pendingSize += take;
+        p += take;
+        if (pendingSize < sizeof(pending)) {
+            return;
+        }
+        consumeStripes(acc, pending, pending + sizeof(pending));
+        pendingSize = 0;
+    }
+
+    p = consumeStripes(acc, p, end);
+    pendingSize = static_cast<size_t>(end - p);
+    std::memcpy(pending, p, pendingSize);
+}
+
+uint64_t XxHash64::digest() const {
+    uint64_t h;
+    if (totalLength >= 32) {
+        h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+        h = mergeRound(h, acc[0]);
+        h = mergeRound(h, acc[1]);
+        h = mergeRound(h, acc[2]);
+        h = mergeRound(h, acc[3]);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += totalLength;
+
+    // 尾部：8 字节、4 字节、单字节依次混入
+    const unsigned char* p = pending;
+    const unsigned char* end = pending + pendingSize;
+    while (end - p >= 8) {
+        h ^= mixRound(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<uint64_t>(*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+        p++;
+    }
+
+    // 最终混合
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t XxHash64::hash(const void* data, size_t length, uint64_t seed) {
+    XxHash64 hasher(seed);
+    hasher.update(data, length);
+    return hasher.digest();
+}
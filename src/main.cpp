@@ -1,6 +1,38 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <cstring>
 #include "../include/MiniFileExplorer.h"
+#include "../include/Stats.h"
+
+/**
+ * 批处理模式：依次执行 -c 的命令和 -f 的脚本
+ * @return 退出码
+ */
+static int runBatchMode(MiniFileExplorer& explorer, const std::string& commands, const std::string& scriptFile,
+                        bool stopOnError) {
+    // 批处理模式：不需要与 C stdio 同步
+    std::ios::sync_with_stdio(false);
+    int status = 0;
+    if (!commands.empty()) {
+        std::istringstream script(commands);
+        status = explorer.runBatch(script, stopOnError);
+    }
+    if (!scriptFile.empty() && (status == 0 || !stopOnError)) {
+        if (scriptFile == "-") {
+            status |= explorer.runBatch(std::cin, stopOnError);
+        } else {
+            std::ifstream script(scriptFile);
+            if (!script) {
+                std::cerr << "Cannot open script: " << scriptFile << '\n';
+                return 2;
+            }
+            status |= explorer.runBatch(script, stopOnError);
+        }
+    }
+    return status;
+}
 
 /**
  * 程序入口点
@@ -8,15 +40,71 @@
  * 用法:
  *   ./MiniFileExplorer              - 使用当前工作目录
  *   ./MiniFileExplorer /path/to/dir - 使用指定目录
+ *
+ * 批处理模式（不显示提示符，输出批量写出）:
+ *   ./MiniFileExplorer -c "mkdir a; cd a; touch b"  - 执行 ';' 分隔的命令
+ *   ./MiniFileExplorer -f script.txt                - 执行脚本文件中的命令（"-" 表示标准输入）
+ *   选项: -e (遇到第一个错误就退出), -y (所有确认都回答 y)
+ *
+ * 统计（交互和批处理模式都可以用）:
+ *   ./MiniFileExplorer -S stats.json  - 打开 stats 统计，退出时把结果以 JSON 写入文件
+ *
+ * 退出码: 有命令失败时为 1，参数错误时为 2，否则为 0
  */
 int main(int argc, char* argv[]) {
+    std::string initialPath;
+    std::string commands;
+    std::string scriptFile;
+    bool batch = false;
+    bool stopOnError = false;
+    bool assumeYes = false;
+    std::string statsFile;
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-c") == 0 || std::strcmp(argv[i], "-f") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing argument for " << argv[i] << '\n';
+                return 2;
+            }
+            (argv[i][1] == 'c' ? commands : scriptFile) = argv[i + 1];
+            batch = true;
+            i++;
+        } else if (std::strcmp(argv[i], "-S") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing argument for -S\n";
+                return 2;
+            }
+            statsFile = argv[++i];
+        } else if (std::strcmp(argv[i], "-e") == 0) {
+            stopOnError = true;
+        } else if (std::strcmp(argv[i], "-y") == 0) {
+            assumeYes = true;
+        } else if (initialPath.empty()) {
+            initialPath = argv[i];
+        } else {
+            std::cerr << "Usage: MiniFileExplorer [-c commands | -f script] [-e] [-y] [-S stats.json] [dir]\n";
+            return 2;
+        }
+    }
+
     // 创建文件管理器实例
-    // 如果提供了命令行参数，使用指定的目录；否则使用当前工作目录
-    MiniFileExplorer explorer(argc > 1 ? std::string(argv[1]) : std::string());
-    
-    // 运行主循环
-    explorer.run();
-    
-    return 0;
-}
+    // 如果提供了目录参数，使用指定的目录；否则使用当前工作目录
+    MiniFileExplorer explorer(initialPath);
+    explorer.setAssumeYes(assumeYes);
+    if (!statsFile.empty()) {
+        Stats::setEnabled(true);
+    }
 
+    int status = batch ? runBatchMode(explorer, commands, scriptFile, stopOnError) : explorer.run();
+
+    // 退出时输出统计
+    if (!statsFile.empty()) {
+        std::ofstream out(statsFile);
+        Stats::writeJson(out);
+        if (!out) {
+            std::cerr << "Cannot write stats to " << statsFile << '\n';
+        }
+    }
+    return status;
+}